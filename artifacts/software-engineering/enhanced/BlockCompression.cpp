@@ -0,0 +1,466 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompression.cpp
+// ============
+// CPU encoders for the BC1, BC3 and BC7 GPU texture block formats
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // 16 pixels of one 4x4 block, always expanded to RGBA
+    struct PIXEL_BLOCK
+    {
+        alignas(16) unsigned char rgba[64];
+    };
+
+    // writes little-endian bit fields, as used by the BC7 block layout
+    struct BIT_WRITER
+    {
+        unsigned char* pOutput;
+        int bitPosition;
+
+        void Write(uint32_t value, int bitCount)
+        {
+            for (int i = 0; i < bitCount; i++)
+            {
+                if ((value >> i) & 1u)
+                {
+                    pOutput[bitPosition >> 3] |= static_cast<unsigned char>(1u << (bitPosition & 7));
+                }
+                bitPosition++;
+            }
+        }
+    };
+
+    // BC7 4-bit index interpolation weights, out of 64
+    const int g_BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    /***********************************************************
+     *  LoadBlock()
+     *
+     *  Copies one 4x4 block out of the image, repeating the
+     *  last row and column for blocks that hang over the edge.
+     ***********************************************************/
+    void LoadBlock(const unsigned char* pixels, int width, int height, int colorChannels,
+        int blockX, int blockY, PIXEL_BLOCK& block)
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            int sourceY = std::min(blockY * 4 + y, height - 1);
+            for (int x = 0; x < 4; x++)
+            {
+                int sourceX = std::min(blockX * 4 + x, width - 1);
+                const unsigned char* pSource = pixels + (static_cast<size_t>(sourceY) * width + sourceX) * colorChannels;
+                unsigned char* pTarget = block.rgba + (y * 4 + x) * 4;
+
+                pTarget[0] = pSource[0];
+                pTarget[1] = pSource[1];
+                pTarget[2] = pSource[2];
+                pTarget[3] = (colorChannels == 4) ? pSource[3] : 255;
+            }
+        }
+    }
+
+    /***********************************************************
+     *  GetBlockBounds()
+     *
+     *  Finds the per-channel minimum and maximum of a block.
+     ***********************************************************/
+    void GetBlockBounds(const PIXEL_BLOCK& block, unsigned char minColor[4], unsigned char maxColor[4])
+    {
+#ifdef BLOCK_COMPRESSION_SSE2
+        const __m128i* pRows = reinterpret_cast<const __m128i*>(block.rgba);
+        __m128i row0 = _mm_load_si128(pRows + 0);
+        __m128i row1 = _mm_load_si128(pRows + 1);
+        __m128i row2 = _mm_load_si128(pRows + 2);
+        __m128i row3 = _mm_load_si128(pRows + 3);
+
+        __m128i minimum = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+        __m128i maximum = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+
+        // fold the four pixels of each register down to one
+        minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 8));
+        minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 4));
+        maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 8));
+        maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 4));
+
+        uint32_t packedMin = static_cast<uint32_t>(_mm_cvtsi128_si32(minimum));
+        uint32_t packedMax = static_cast<uint32_t>(_mm_cvtsi128_si32(maximum));
+        std::memcpy(minColor, &packedMin, 4);
+        std::memcpy(maxColor, &packedMax, 4);
+#else
+        for (int c = 0; c < 4; c++)
+        {
+            minColor[c] = 255;
+            maxColor[c] = 0;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                minColor[c] = std::min(minColor[c], block.rgba[i * 4 + c]);
+                maxColor[c] = std::max(maxColor[c], block.rgba[i * 4 + c]);
+            }
+        }
+#endif
+    }
+
+    /***********************************************************
+     *  ProjectBlock()
+     *
+     *  Projects every pixel onto the segment that starts at
+     *  'start' and runs along 'axis', and returns its position
+     *  scaled to 0..steps and rounded to the nearest step.
+     ***********************************************************/
+    void ProjectBlock(const PIXEL_BLOCK& block, const int start[4], const int axis[4], int steps, int positions[16])
+    {
+        int lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+        if (lengthSquared == 0)
+        {
+            std::fill(positions, positions + 16, 0);
+            return;
+        }
+        float scale = static_cast<float>(steps) / static_cast<float>(lengthSquared);
+
+#ifdef BLOCK_COMPRESSION_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i start16 = _mm_setr_epi16(
+            static_cast<short>(start[0]), static_cast<short>(start[1]), static_cast<short>(start[2]), static_cast<short>(start[3]),
+            static_cast<short>(start[0]), static_cast<short>(start[1]), static_cast<short>(start[2]), static_cast<short>(start[3]));
+        const __m128i axis16 = _mm_setr_epi16(
+            static_cast<short>(axis[0]), static_cast<short>(axis[1]), static_cast<short>(axis[2]), static_cast<short>(axis[3]),
+            static_cast<short>(axis[0]), static_cast<short>(axis[1]), static_cast<short>(axis[2]), static_cast<short>(axis[3]));
+        const __m128 scale4 = _mm_set1_ps(scale);
+
+        for (int row = 0; row < 4; row++)
+        {
+            __m128i pixels = _mm_load_si128(reinterpret_cast<const __m128i*>(block.rgba) + row);
+
+            // widen to 16 bits, offset by the start and take r*ar+g*ag and b*ab+a*aa
+            __m128i low = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(pixels, zero), start16), axis16);
+            __m128i high = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(pixels, zero), start16), axis16);
+
+            // add the two halves of each pixel, leaving the dot products in lanes 0 and 2
+            low = _mm_add_epi32(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+            high = _mm_add_epi32(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+            __m128 dots = _mm_shuffle_ps(_mm_cvtepi32_ps(low), _mm_cvtepi32_ps(high), _MM_SHUFFLE(2, 0, 2, 0));
+
+            __m128i rounded = _mm_cvtps_epi32(_mm_mul_ps(dots, scale4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(positions + row * 4), rounded);
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            positions[i] = std::min(std::max(positions[i], 0), steps);
+        }
+#else
+        for (int i = 0; i < 16; i++)
+        {
+            int dot = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                dot += (block.rgba[i * 4 + c] - start[c]) * axis[c];
+            }
+            int position = static_cast<int>(static_cast<float>(dot) * scale + 0.5f);
+            positions[i] = std::min(std::max(position, 0), steps);
+        }
+#endif
+    }
+
+    uint16_t PackRGB565(const int color[3])
+    {
+        int r = (color[0] * 31 + 127) / 255;
+        int g = (color[1] * 63 + 127) / 255;
+        int b = (color[2] * 31 + 127) / 255;
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void UnpackRGB565(uint16_t packed, int color[4])
+    {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+        color[3] = 0;
+    }
+
+    void WriteLittleEndian16(unsigned char* pOutput, uint16_t value)
+    {
+        pOutput[0] = static_cast<unsigned char>(value & 0xFF);
+        pOutput[1] = static_cast<unsigned char>(value >> 8);
+    }
+
+    /***********************************************************
+     *  EncodeColorBlock()
+     *
+     *  Encodes the RGB part of a block as two RGB565 endpoints
+     *  on the (slightly inset) bounding box diagonal, with the
+     *  four-color palette. Shared by BC1 and BC3.
+     ***********************************************************/
+    void EncodeColorBlock(const PIXEL_BLOCK& block, const unsigned char minColor[4], const unsigned char maxColor[4],
+        unsigned char* pOutput)
+    {
+        int low[3];
+        int high[3];
+        for (int c = 0; c < 3; c++)
+        {
+            // pull the endpoints in by 1/16 of the range, which lowers the
+            // average error of the interpolated colors
+            int inset = (maxColor[c] - minColor[c]) >> 4;
+            low[c] = minColor[c] + inset;
+            high[c] = maxColor[c] - inset;
+        }
+
+        // every field of 'high' is >= the one of 'low', so color0 >= color1
+        uint16_t color0 = PackRGB565(high);
+        uint16_t color1 = PackRGB565(low);
+        WriteLittleEndian16(pOutput + 0, color0);
+        WriteLittleEndian16(pOutput + 2, color1);
+
+        uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            int endpoint0[4];
+            int endpoint1[4];
+            UnpackRGB565(color0, endpoint0);
+            UnpackRGB565(color1, endpoint1);
+
+            int axis[4] = { endpoint0[0] - endpoint1[0], endpoint0[1] - endpoint1[1], endpoint0[2] - endpoint1[2], 0 };
+            int positions[16];
+            ProjectBlock(block, endpoint1, axis, 3, positions);
+
+            // position 0 is color1, 3 is color0, 1 and 2 the interpolated colors
+            static const uint32_t g_PositionToIndex[4] = { 1, 3, 2, 0 };
+            for (int i = 0; i < 16; i++)
+            {
+                indices |= g_PositionToIndex[positions[i]] << (i * 2);
+            }
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            pOutput[4 + i] = static_cast<unsigned char>((indices >> (i * 8)) & 0xFF);
+        }
+    }
+
+    /***********************************************************
+     *  EncodeAlphaBlock()
+     *
+     *  Encodes the alpha of a block with the eight-value BC3
+     *  palette between the minimum and maximum alpha.
+     ***********************************************************/
+    void EncodeAlphaBlock(const PIXEL_BLOCK& block, unsigned char minAlpha, unsigned char maxAlpha,
+        unsigned char* pOutput)
+    {
+        pOutput[0] = maxAlpha;
+        pOutput[1] = minAlpha;
+
+        uint64_t indices = 0;
+        if (maxAlpha != minAlpha)
+        {
+            int start[4] = { 0, 0, 0, minAlpha };
+            int axis[4] = { 0, 0, 0, maxAlpha - minAlpha };
+            int positions[16];
+            ProjectBlock(block, start, axis, 7, positions);
+
+            // position 7 is alpha0, 0 is alpha1, the rest are interpolated in reverse order
+            for (int i = 0; i < 16; i++)
+            {
+                uint64_t index = (positions[i] == 7) ? 0 : (positions[i] == 0) ? 1 : static_cast<uint64_t>(8 - positions[i]);
+                indices |= index << (i * 3);
+            }
+        }
+
+        for (int i = 0; i < 6; i++)
+        {
+            pOutput[2 + i] = static_cast<unsigned char>((indices >> (i * 8)) & 0xFF);
+        }
+    }
+
+    /***********************************************************
+     *  QuantizeBC7Endpoint()
+     *
+     *  Reduces an RGBA endpoint to 7 bits per channel plus the
+     *  shared p-bit that gives the lowest error.
+     ***********************************************************/
+    void QuantizeBC7Endpoint(const int color[4], int quantized[4], int& pBit)
+    {
+        int bestError = -1;
+        for (int p = 0; p < 2; p++)
+        {
+            int candidate[4];
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                candidate[c] = std::min(std::max((color[c] - p + 1) >> 1, 0), 127);
+                int difference = ((candidate[c] << 1) | p) - color[c];
+                error += difference * difference;
+            }
+
+            if (bestError < 0 || error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                std::memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    /***********************************************************
+     *  EncodeBC7Block()
+     *
+     *  Encodes a block in BC7 mode 6: one subset, RGBA 7.7.7.7
+     *  endpoints with a p-bit each, and 4-bit indices.
+     ***********************************************************/
+    void EncodeBC7Block(const PIXEL_BLOCK& block, unsigned char* pOutput)
+    {
+        unsigned char minColor[4];
+        unsigned char maxColor[4];
+        GetBlockBounds(block, minColor, maxColor);
+
+        int low[4];
+        int high[4];
+        for (int c = 0; c < 4; c++)
+        {
+            int inset = (maxColor[c] - minColor[c]) >> 5;
+            low[c] = minColor[c] + inset;
+            high[c] = maxColor[c] - inset;
+        }
+
+        int quantized[2][4];
+        int pBits[2];
+        QuantizeBC7Endpoint(low, quantized[0], pBits[0]);
+        QuantizeBC7Endpoint(high, quantized[1], pBits[1]);
+
+        int endpoint0[4];
+        int axis[4];
+        for (int c = 0; c < 4; c++)
+        {
+            endpoint0[c] = (quantized[0][c] << 1) | pBits[0];
+            axis[c] = ((quantized[1][c] << 1) | pBits[1]) - endpoint0[c];
+        }
+
+        int positions[16];
+        ProjectBlock(block, endpoint0, axis, 15, positions);
+
+        // the first index is stored with an implicit zero top bit, so swap
+        // the endpoints when it would need the upper half of the palette
+        if (positions[0] >= 8)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                std::swap(quantized[0][c], quantized[1][c]);
+            }
+            std::swap(pBits[0], pBits[1]);
+            for (int i = 0; i < 16; i++)
+            {
+                positions[i] = 15 - positions[i];
+            }
+        }
+
+        std::memset(pOutput, 0, BlockCompression::BC7_BLOCK_BYTES);
+        BIT_WRITER writer = { pOutput, 0 };
+
+        writer.Write(1u << 6, 7);   // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            writer.Write(static_cast<uint32_t>(quantized[0][c]), 7);
+            writer.Write(static_cast<uint32_t>(quantized[1][c]), 7);
+        }
+        writer.Write(static_cast<uint32_t>(pBits[0]), 1);
+        writer.Write(static_cast<uint32_t>(pBits[1]), 1);
+
+        writer.Write(static_cast<uint32_t>(positions[0]), 3);
+        for (int i = 1; i < 16; i++)
+        {
+            writer.Write(static_cast<uint32_t>(positions[i]), 4);
+        }
+    }
+}
+
+/***********************************************************
+ *  GetEncodedSize()
+ *
+ *  Partial blocks at the edges still take a whole block.
+ ***********************************************************/
+size_t BlockCompression::GetEncodedSize(int width, int height, size_t blockBytes)
+{
+    size_t blocksX = static_cast<size_t>((width + 3) / 4);
+    size_t blocksY = static_cast<size_t>((height + 3) / 4);
+    return blocksX * blocksY * blockBytes;
+}
+
+/***********************************************************
+ *  EncodeBC1()
+ ***********************************************************/
+void BlockCompression::EncodeBC1(const unsigned char* pixels, int width, int height, int colorChannels, unsigned char* blocks)
+{
+    PIXEL_BLOCK block;
+    unsigned char minColor[4];
+    unsigned char maxColor[4];
+
+    for (int blockY = 0; blockY < (height + 3) / 4; blockY++)
+    {
+        for (int blockX = 0; blockX < (width + 3) / 4; blockX++)
+        {
+            LoadBlock(pixels, width, height, colorChannels, blockX, blockY, block);
+            GetBlockBounds(block, minColor, maxColor);
+            EncodeColorBlock(block, minColor, maxColor, blocks);
+            blocks += BC1_BLOCK_BYTES;
+        }
+    }
+}
+
+/***********************************************************
+ *  EncodeBC3()
+ ***********************************************************/
+void BlockCompression::EncodeBC3(const unsigned char* pixels, int width, int height, int colorChannels, unsigned char* blocks)
+{
+    PIXEL_BLOCK block;
+    unsigned char minColor[4];
+    unsigned char maxColor[4];
+
+    for (int blockY = 0; blockY < (height + 3) / 4; blockY++)
+    {
+        for (int blockX = 0; blockX < (width + 3) / 4; blockX++)
+        {
+            LoadBlock(pixels, width, height, colorChannels, blockX, blockY, block);
+            GetBlockBounds(block, minColor, maxColor);
+            EncodeAlphaBlock(block, minColor[3], maxColor[3], blocks);
+            EncodeColorBlock(block, minColor, maxColor, blocks + 8);
+            blocks += BC3_BLOCK_BYTES;
+        }
+    }
+}
+
+/***********************************************************
+ *  EncodeBC7()
+ ***********************************************************/
+void BlockCompression::EncodeBC7(const unsigned char* pixels, int width, int height, int colorChannels, unsigned char* blocks)
+{
+    PIXEL_BLOCK block;
+
+    for (int blockY = 0; blockY < (height + 3) / 4; blockY++)
+    {
+        for (int blockX = 0; blockX < (width + 3) / 4; blockX++)
+        {
+            LoadBlock(pixels, width, height, colorChannels, blockX, blockY, block);
+            EncodeBC7Block(block, blocks);
+            blocks += BC7_BLOCK_BYTES;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompression.h
+// ============
+// CPU encoders for the BC1, BC3 and BC7 GPU texture block formats
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  BlockCompression
+ *
+ *  These functions encode an image into 4x4 pixel blocks
+ *  that the GPU samples directly. Input is tightly packed
+ *  RGB or RGBA, 8 bits per channel; partial blocks at the
+ *  right and top edges repeat the last row and column. The
+ *  bounding box and index selection use SSE2 where the
+ *  compiler targets it. The functions keep no state and are
+ *  safe to call from several threads at once.
+ ***********************************************************/
+namespace BlockCompression
+{
+    // Bytes of one encoded 4x4 block
+    const size_t BC1_BLOCK_BYTES = 8;
+    const size_t BC3_BLOCK_BYTES = 16;
+    const size_t BC7_BLOCK_BYTES = 16;
+
+    // Bytes needed to encode an image of the given size
+    size_t GetEncodedSize(int width, int height, size_t blockBytes);
+
+    // Opaque color, 4 bits per pixel
+    void EncodeBC1(const unsigned char* pixels, int width, int height, int colorChannels, unsigned char* blocks);
+    // Color plus interpolated alpha, 8 bits per pixel
+    void EncodeBC3(const unsigned char* pixels, int width, int height, int colorChannels, unsigned char* blocks);
+    // Higher quality color and alpha (mode 6 only), 8 bits per pixel
+    void EncodeBC7(const unsigned char* pixels, int width, int height, int colorChannels, unsigned char* blocks);
+}
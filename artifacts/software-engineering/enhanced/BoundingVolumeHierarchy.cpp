@@ -0,0 +1,769 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumehierarchy.cpp
+// ============
+// bounding volume hierarchy over scene object boxes for culling and picking
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BoundingVolumeHierarchy.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+namespace
+{
+    // centroid bins tried per axis when looking for the cheapest split
+    const int g_BinCount = 16;
+    // nodes with this few objects are never split
+    const int g_MinLeafObjects = 2;
+    // nodes with more objects than this are split even when the heuristic prefers a leaf
+    const int g_MaxLeafObjects = 8;
+    // cost of visiting a node, relative to testing one object box
+    const float g_TraversalCost = 1.0f;
+
+    const float g_Infinity = std::numeric_limits<float>::infinity();
+
+    Culling::AABB EmptyBox()
+    {
+        Culling::AABB box;
+        box.minimum = glm::vec3(g_Infinity, g_Infinity, g_Infinity);
+        box.maximum = glm::vec3(-g_Infinity, -g_Infinity, -g_Infinity);
+        return box;
+    }
+
+    void GrowBox(Culling::AABB& box, const Culling::AABB& other)
+    {
+        box.minimum = glm::min(box.minimum, other.minimum);
+        box.maximum = glm::max(box.maximum, other.maximum);
+    }
+
+    float SurfaceArea(const Culling::AABB& box)
+    {
+        glm::vec3 size = box.maximum - box.minimum;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    bool BoxesOverlap(const Culling::AABB& a, const Culling::AABB& b)
+    {
+        return a.minimum.x <= b.maximum.x && a.maximum.x >= b.minimum.x &&
+            a.minimum.y <= b.maximum.y && a.maximum.y >= b.minimum.y &&
+            a.minimum.z <= b.maximum.z && a.maximum.z >= b.minimum.z;
+    }
+
+    bool BoxContains(const Culling::AABB& outer, const Culling::AABB& inner)
+    {
+        return outer.minimum.x <= inner.minimum.x && outer.maximum.x >= inner.maximum.x &&
+            outer.minimum.y <= inner.minimum.y && outer.maximum.y >= inner.maximum.y &&
+            outer.minimum.z <= inner.minimum.z && outer.maximum.z >= inner.maximum.z;
+    }
+
+    float PlaneDistance(const glm::vec4& plane, float x, float y, float z)
+    {
+        return plane.x * x + plane.y * y + plane.z * z + plane.w;
+    }
+
+    // signed distance of the box corner farthest along the plane normal
+    float FarCornerDistance(const glm::vec4& plane, const Culling::AABB& box)
+    {
+        return PlaneDistance(plane,
+            plane.x >= 0.0f ? box.maximum.x : box.minimum.x,
+            plane.y >= 0.0f ? box.maximum.y : box.minimum.y,
+            plane.z >= 0.0f ? box.maximum.z : box.minimum.z);
+    }
+
+    // signed distance of the box corner farthest against the plane normal
+    float NearCornerDistance(const glm::vec4& plane, const Culling::AABB& box)
+    {
+        return PlaneDistance(plane,
+            plane.x >= 0.0f ? box.minimum.x : box.maximum.x,
+            plane.y >= 0.0f ? box.minimum.y : box.maximum.y,
+            plane.z >= 0.0f ? box.minimum.z : box.maximum.z);
+    }
+
+    // slab test: the distance along the ray where it enters the box, if it
+    // does so before maxDistance
+    bool IntersectRayBox(
+        const glm::vec3& origin,
+        const glm::vec3& inverseDirection,
+        const Culling::AABB& box,
+        float maxDistance,
+        float& entryDistance)
+    {
+        float nearest = 0.0f;
+        float farthest = maxDistance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float t0 = (box.minimum[axis] - origin[axis]) * inverseDirection[axis];
+            float t1 = (box.maximum[axis] - origin[axis]) * inverseDirection[axis];
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+            nearest = std::max(nearest, t0);
+            farthest = std::min(farthest, t1);
+        }
+        entryDistance = nearest;
+        return nearest <= farthest;
+    }
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the
+ *  passed in object boxes. Nodes are split from the root
+ *  down with an explicit stack, so a badly clustered scene
+ *  cannot overflow the call stack. A node's two children
+ *  are stored next to each other after it, which keeps
+ *  every parent ahead of its children for Refit().
+ ***********************************************************/
+void BoundingVolumeHierarchy::Build(const std::vector<Culling::AABB>& objectBoxes)
+{
+    m_objectBoxes = objectBoxes;
+    m_nodes.clear();
+    m_objectIndices.resize(objectBoxes.size());
+    m_centroids.resize(objectBoxes.size());
+    if (objectBoxes.empty())
+    {
+        return;
+    }
+
+    BVH_NODE root;
+    root.box = EmptyBox();
+    for (size_t i = 0; i < objectBoxes.size(); i++)
+    {
+        m_objectIndices[i] = static_cast<int>(i);
+        m_centroids[i] = (objectBoxes[i].minimum + objectBoxes[i].maximum) * 0.5f;
+        GrowBox(root.box, objectBoxes[i]);
+    }
+    root.firstChildOrObject = 0;
+    root.objectCount = static_cast<int32_t>(objectBoxes.size());
+
+    m_nodes.reserve(2 * objectBoxes.size() / g_MinLeafObjects + 1);
+    m_nodes.push_back(root);
+
+    std::vector<int> pendingNodes(1, 0);
+    while (!pendingNodes.empty())
+    {
+        int node = pendingNodes.back();
+        pendingNodes.pop_back();
+        if (SplitNode(node))
+        {
+            pendingNodes.push_back(m_nodes[node].firstChildOrObject);
+            pendingNodes.push_back(m_nodes[node].firstChildOrObject + 1);
+        }
+    }
+
+    std::vector<glm::vec3>().swap(m_centroids);
+}
+
+/***********************************************************
+ *  SplitNode()
+ *
+ *  This method is used for splitting a node in two. The
+ *  object centers are sorted into bins along each axis, and
+ *  every boundary between bins is priced by the surface
+ *  area heuristic: the chance a ray or query reaching the
+ *  node also reaches a child is the ratio of their surface
+ *  areas, times the objects it would then test. The node
+ *  stays a leaf when no split beats testing its objects
+ *  directly, unless it holds too many objects.
+ ***********************************************************/
+bool BoundingVolumeHierarchy::SplitNode(int node)
+{
+    const BVH_NODE current = m_nodes[node];
+    const int first = current.firstChildOrObject;
+    const int count = current.objectCount;
+    if (count <= g_MinLeafObjects)
+    {
+        return false;
+    }
+
+    Culling::AABB centroidBox = EmptyBox();
+    for (int i = first; i < first + count; i++)
+    {
+        const glm::vec3& centroid = m_centroids[m_objectIndices[i]];
+        centroidBox.minimum = glm::min(centroidBox.minimum, centroid);
+        centroidBox.maximum = glm::max(centroidBox.maximum, centroid);
+    }
+
+    float bestCost = g_Infinity;
+    int bestAxis = -1;
+    int bestBoundary = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float extent = centroidBox.maximum[axis] - centroidBox.minimum[axis];
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        Culling::AABB binBoxes[g_BinCount];
+        int binCounts[g_BinCount] = {};
+        for (Culling::AABB& binBox : binBoxes)
+        {
+            binBox = EmptyBox();
+        }
+        float binScale = g_BinCount / extent;
+        for (int i = first; i < first + count; i++)
+        {
+            int object = m_objectIndices[i];
+            int bin = std::min(g_BinCount - 1, static_cast<int>((m_centroids[object][axis] - centroidBox.minimum[axis]) * binScale));
+            binCounts[bin]++;
+            GrowBox(binBoxes[bin], m_objectBoxes[object]);
+        }
+
+        // sweep from the right first, then price each boundary sweeping from the left
+        float rightCosts[g_BinCount];
+        int rightCounts[g_BinCount];
+        Culling::AABB sweepBox = EmptyBox();
+        int sweepCount = 0;
+        for (int bin = g_BinCount - 1; bin > 0; bin--)
+        {
+            GrowBox(sweepBox, binBoxes[bin]);
+            sweepCount += binCounts[bin];
+            rightCounts[bin] = sweepCount;
+            rightCosts[bin] = (sweepCount > 0) ? SurfaceArea(sweepBox) * sweepCount : 0.0f;
+        }
+        sweepBox = EmptyBox();
+        sweepCount = 0;
+        for (int boundary = 1; boundary < g_BinCount; boundary++)
+        {
+            GrowBox(sweepBox, binBoxes[boundary - 1]);
+            sweepCount += binCounts[boundary - 1];
+            if (sweepCount == 0 || rightCounts[boundary] == 0)
+            {
+                continue;
+            }
+            float cost = SurfaceArea(sweepBox) * sweepCount + rightCosts[boundary];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBoundary = boundary;
+            }
+        }
+    }
+
+    float nodeArea = SurfaceArea(current.box);
+    float leafCost = nodeArea * count;
+    float splitCost = g_TraversalCost * nodeArea + bestCost;
+    if (splitCost >= leafCost && count <= g_MaxLeafObjects)
+    {
+        return false;
+    }
+
+    int middle;
+    if (bestAxis < 0)
+    {
+        // every center is in the same place, so any split is as good as another
+        middle = first + count / 2;
+    }
+    else
+    {
+        float binScale = g_BinCount / (centroidBox.maximum[bestAxis] - centroidBox.minimum[bestAxis]);
+        float minimum = centroidBox.minimum[bestAxis];
+        int* pMiddle = std::partition(m_objectIndices.data() + first, m_objectIndices.data() + first + count,
+            [&](int object)
+            {
+                int bin = std::min(g_BinCount - 1, static_cast<int>((m_centroids[object][bestAxis] - minimum) * binScale));
+                return bin < bestBoundary;
+            });
+        middle = static_cast<int>(pMiddle - m_objectIndices.data());
+    }
+
+    int firstChild = static_cast<int>(m_nodes.size());
+    const int childFirst[2] = { first, middle };
+    const int childCount[2] = { middle - first, first + count - middle };
+    for (int child = 0; child < 2; child++)
+    {
+        BVH_NODE childNode;
+        childNode.box = EmptyBox();
+        for (int i = childFirst[child]; i < childFirst[child] + childCount[child]; i++)
+        {
+            GrowBox(childNode.box, m_objectBoxes[m_objectIndices[i]]);
+        }
+        childNode.firstChildOrObject = childFirst[child];
+        childNode.objectCount = childCount[child];
+        m_nodes.push_back(childNode);
+    }
+
+    m_nodes[node].firstChildOrObject = firstChild;
+    m_nodes[node].objectCount = 0;
+    return true;
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for bringing the node boxes up to
+ *  date after objects moved. Children are always stored
+ *  after their parent, so one backward pass over the nodes
+ *  sees every child before its parent.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Refit(const std::vector<Culling::AABB>& objectBoxes)
+{
+    if (objectBoxes.size() != m_objectBoxes.size())
+    {
+        Build(objectBoxes);
+        return;
+    }
+
+    m_objectBoxes = objectBoxes;
+    for (size_t node = m_nodes.size(); node-- > 0; )
+    {
+        BVH_NODE& current = m_nodes[node];
+        Culling::AABB box = EmptyBox();
+        if (current.objectCount > 0)
+        {
+            for (int i = current.firstChildOrObject; i < current.firstChildOrObject + current.objectCount; i++)
+            {
+                GrowBox(box, m_objectBoxes[m_objectIndices[i]]);
+            }
+        }
+        else
+        {
+            GrowBox(box, m_nodes[current.firstChildOrObject].box);
+            GrowBox(box, m_nodes[current.firstChildOrObject + 1].box);
+        }
+        current.box = box;
+    }
+}
+
+/***********************************************************
+ *  CollectSubtree()
+ *
+ *  This method is used for appending every object under a
+ *  node. The objects of a subtree are one run of the object
+ *  index array, from its leftmost leaf to its rightmost, so
+ *  no node inside it is visited.
+ ***********************************************************/
+void BoundingVolumeHierarchy::CollectSubtree(int node, std::vector<int>& objects) const
+{
+    int leftmost = node;
+    while (m_nodes[leftmost].objectCount == 0)
+    {
+        leftmost = m_nodes[leftmost].firstChildOrObject;
+    }
+    int rightmost = node;
+    while (m_nodes[rightmost].objectCount == 0)
+    {
+        rightmost = m_nodes[rightmost].firstChildOrObject + 1;
+    }
+
+    const int* pFirst = m_objectIndices.data() + m_nodes[leftmost].firstChildOrObject;
+    const int* pLast = m_objectIndices.data() + m_nodes[rightmost].firstChildOrObject + m_nodes[rightmost].objectCount;
+    objects.insert(objects.end(), pFirst, pLast);
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for finding the objects that may be
+ *  visible. Each node carries a mask of the planes its
+ *  parent was not already entirely inside of; a node inside
+ *  every plane takes its whole subtree without further
+ *  tests, and a node outside any plane drops it.
+ ***********************************************************/
+void BoundingVolumeHierarchy::QueryFrustum(const Culling::FRUSTUM& frustum, std::vector<int>& objects) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    struct PENDING_NODE
+    {
+        int node;
+        int planeMask;
+    };
+    PENDING_NODE stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = { 0, 0x3F };
+
+    while (stackSize > 0)
+    {
+        PENDING_NODE pending = stack[--stackSize];
+        const BVH_NODE& current = m_nodes[pending.node];
+
+        bool bOutside = false;
+        int planeMask = pending.planeMask;
+        for (int plane = 0; plane < 6 && !bOutside; plane++)
+        {
+            if ((planeMask & (1 << plane)) == 0)
+            {
+                continue;
+            }
+            if (FarCornerDistance(frustum.planes[plane], current.box) < 0.0f)
+            {
+                bOutside = true;
+            }
+            else if (NearCornerDistance(frustum.planes[plane], current.box) >= 0.0f)
+            {
+                planeMask &= ~(1 << plane);
+            }
+        }
+
+        if (bOutside)
+        {
+            continue;
+        }
+        if (planeMask == 0)
+        {
+            CollectSubtree(pending.node, objects);
+            continue;
+        }
+
+        if (current.objectCount > 0)
+        {
+            for (int i = current.firstChildOrObject; i < current.firstChildOrObject + current.objectCount; i++)
+            {
+                int object = m_objectIndices[i];
+                bool bVisible = true;
+                for (int plane = 0; plane < 6 && bVisible; plane++)
+                {
+                    bVisible = (planeMask & (1 << plane)) == 0 ||
+                        FarCornerDistance(frustum.planes[plane], m_objectBoxes[object]) >= 0.0f;
+                }
+                if (bVisible)
+                {
+                    objects.push_back(object);
+                }
+            }
+        }
+        else if (stackSize + 2 <= 64)
+        {
+            stack[stackSize++] = { current.firstChildOrObject, planeMask };
+            stack[stackSize++] = { current.firstChildOrObject + 1, planeMask };
+        }
+        else
+        {
+            // deeper than the stack: take the subtree rather than miss anything
+            CollectSubtree(pending.node, objects);
+        }
+    }
+}
+
+/***********************************************************
+ *  QueryRay()
+ *
+ *  This method is used for picking: it finds the object
+ *  whose box the ray enters first. The nearer child is
+ *  visited first, and a node the ray enters beyond the best
+ *  hit so far is skipped, so most of the tree is never
+ *  touched. Returns NO_HIT when the ray hits nothing.
+ ***********************************************************/
+int BoundingVolumeHierarchy::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const
+{
+    hitDistance = maxDistance;
+    if (m_nodes.empty())
+    {
+        return NO_HIT;
+    }
+
+    glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float entry;
+    if (!IntersectRayBox(origin, inverseDirection, m_nodes[0].box, maxDistance, entry))
+    {
+        return NO_HIT;
+    }
+
+    struct PENDING_NODE
+    {
+        int node;
+        float entryDistance;
+    };
+    std::vector<PENDING_NODE> stack;
+    stack.push_back({ 0, entry });
+
+    int hitObject = NO_HIT;
+    while (!stack.empty())
+    {
+        PENDING_NODE pending = stack.back();
+        stack.pop_back();
+        if (pending.entryDistance > hitDistance)
+        {
+            continue;
+        }
+
+        const BVH_NODE& current = m_nodes[pending.node];
+        if (current.objectCount > 0)
+        {
+            for (int i = current.firstChildOrObject; i < current.firstChildOrObject + current.objectCount; i++)
+            {
+                int object = m_objectIndices[i];
+                if (IntersectRayBox(origin, inverseDirection, m_objectBoxes[object], hitDistance, entry) &&
+                    (hitObject == NO_HIT || entry < hitDistance))
+                {
+                    hitDistance = entry;
+                    hitObject = object;
+                }
+            }
+            continue;
+        }
+
+        int nearChild = current.firstChildOrObject;
+        int farChild = nearChild + 1;
+        float nearEntry;
+        float farEntry;
+        bool bNearHit = IntersectRayBox(origin, inverseDirection, m_nodes[nearChild].box, hitDistance, nearEntry);
+        bool bFarHit = IntersectRayBox(origin, inverseDirection, m_nodes[farChild].box, hitDistance, farEntry);
+        if (bNearHit && bFarHit && farEntry < nearEntry)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearEntry, farEntry);
+        }
+        else if (!bNearHit)
+        {
+            nearChild = farChild;
+            nearEntry = farEntry;
+            bNearHit = bFarHit;
+            bFarHit = false;
+        }
+
+        // pushed far first so the near child is popped next
+        if (bFarHit)
+        {
+            stack.push_back({ farChild, farEntry });
+        }
+        if (bNearHit)
+        {
+            stack.push_back({ nearChild, nearEntry });
+        }
+    }
+    return hitObject;
+}
+
+/***********************************************************
+ *  QueryRange()
+ *
+ *  This method is used for finding the objects whose boxes
+ *  overlap a box. A node entirely inside the range takes
+ *  its whole subtree without testing it.
+ ***********************************************************/
+void BoundingVolumeHierarchy::QueryRange(const Culling::AABB& range, std::vector<int>& objects) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    std::vector<int> stack(1, 0);
+    while (!stack.empty())
+    {
+        int node = stack.back();
+        stack.pop_back();
+        const BVH_NODE& current = m_nodes[node];
+        if (!BoxesOverlap(current.box, range))
+        {
+            continue;
+        }
+        if (BoxContains(range, current.box))
+        {
+            CollectSubtree(node, objects);
+            continue;
+        }
+
+        if (current.objectCount > 0)
+        {
+            for (int i = current.firstChildOrObject; i < current.firstChildOrObject + current.objectCount; i++)
+            {
+                if (BoxesOverlap(m_objectBoxes[m_objectIndices[i]], range))
+                {
+                    objects.push_back(m_objectIndices[i]);
+                }
+            }
+        }
+        else
+        {
+            stack.push_back(current.firstChildOrObject);
+            stack.push_back(current.firstChildOrObject + 1);
+        }
+    }
+}
+
+/***********************************************************
+ *  GetCost()
+ *
+ *  This method is used for measuring the tree by the same
+ *  heuristic it was built with: the expected node visits
+ *  and object tests of a query reaching the root. It grows
+ *  as refits stretch the boxes, which tells when a rebuild
+ *  would pay off.
+ ***********************************************************/
+float BoundingVolumeHierarchy::GetCost() const
+{
+    if (m_nodes.empty())
+    {
+        return 0.0f;
+    }
+
+    double cost = 0.0;
+    for (const BVH_NODE& node : m_nodes)
+    {
+        double area = SurfaceArea(node.box);
+        cost += (node.objectCount > 0) ? area * node.objectCount : area * g_TraversalCost;
+    }
+    return static_cast<float>(cost / SurfaceArea(m_nodes[0].box));
+}
+
+/***********************************************************
+ *  RunBenchmark()
+ *
+ *  Generates a scene of randomly placed boxes at a fixed
+ *  density, builds the tree, moves every box and refits,
+ *  then runs frustum, ray and range queries through the
+ *  tree and as linear scans over every box, printing the
+ *  time of each and whether their results agree.
+ ***********************************************************/
+void BoundingVolumeHierarchy::RunBenchmark(size_t objectCount)
+{
+    const int queryCount = 100;
+
+    // the scene grows with the object count so its density stays the same
+    float sceneSize = 4.0f * std::cbrt(static_cast<float>(objectCount));
+    std::mt19937 random(499);
+    std::uniform_real_distribution<float> positionRange(-0.5f * sceneSize, 0.5f * sceneSize);
+    std::uniform_real_distribution<float> sizeRange(0.25f, 1.0f);
+    std::uniform_real_distribution<float> jitterRange(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> directionRange(-1.0f, 1.0f);
+
+    std::vector<Culling::AABB> boxes(objectCount);
+    for (Culling::AABB& box : boxes)
+    {
+        glm::vec3 center(positionRange(random), positionRange(random), positionRange(random));
+        glm::vec3 halfSize(sizeRange(random), sizeRange(random), sizeRange(random));
+        box.minimum = center - halfSize;
+        box.maximum = center + halfSize;
+    }
+
+    auto milliseconds = [](std::chrono::steady_clock::duration elapsed)
+    {
+        return std::chrono::duration<double, std::milli>(elapsed).count();
+    };
+    auto microsecondsPerQuery = [queryCount](std::chrono::steady_clock::duration elapsed)
+    {
+        return std::chrono::duration<double, std::micro>(elapsed).count() / queryCount;
+    };
+
+    BoundingVolumeHierarchy bvh;
+    auto startTime = std::chrono::steady_clock::now();
+    bvh.Build(boxes);
+    auto buildTime = std::chrono::steady_clock::now();
+    float builtCost = bvh.GetCost();
+
+    for (Culling::AABB& box : boxes)
+    {
+        glm::vec3 offset(jitterRange(random), jitterRange(random), jitterRange(random));
+        box.minimum += offset;
+        box.maximum += offset;
+    }
+    auto refitStartTime = std::chrono::steady_clock::now();
+    bvh.Refit(boxes);
+    auto refitTime = std::chrono::steady_clock::now();
+
+    // frustum: a camera at the edge of the scene looking at its center
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, sceneSize);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.5f * sceneSize), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Culling::FRUSTUM frustum = Culling::ExtractFrustum(projection * view);
+    std::vector<int> visible;
+    auto frustumStartTime = std::chrono::steady_clock::now();
+    for (int query = 0; query < queryCount; query++)
+    {
+        visible.clear();
+        bvh.QueryFrustum(frustum, visible);
+    }
+    auto frustumTime = std::chrono::steady_clock::now();
+    size_t linearVisible = 0;
+    for (int query = 0; query < queryCount; query++)
+    {
+        linearVisible = 0;
+        for (const Culling::AABB& box : boxes)
+        {
+            linearVisible += Culling::IsOutsideFrustum(frustum, box) ? 0 : 1;
+        }
+    }
+    auto linearFrustumTime = std::chrono::steady_clock::now();
+
+    // rays: random origins and directions, as long as the scene
+    std::vector<glm::vec3> rayOrigins(queryCount);
+    std::vector<glm::vec3> rayDirections(queryCount);
+    for (int query = 0; query < queryCount; query++)
+    {
+        rayOrigins[query] = glm::vec3(positionRange(random), positionRange(random), positionRange(random));
+        rayDirections[query] = glm::normalize(glm::vec3(directionRange(random), directionRange(random), directionRange(random)));
+    }
+    int rayHits = 0;
+    std::vector<float> rayDistances(queryCount);
+    auto rayStartTime = std::chrono::steady_clock::now();
+    for (int query = 0; query < queryCount; query++)
+    {
+        rayHits += (bvh.QueryRay(rayOrigins[query], rayDirections[query], sceneSize, rayDistances[query]) != NO_HIT) ? 1 : 0;
+    }
+    auto rayTime = std::chrono::steady_clock::now();
+    int rayMismatches = 0;
+    for (int query = 0; query < queryCount; query++)
+    {
+        glm::vec3 inverseDirection(1.0f / rayDirections[query].x, 1.0f / rayDirections[query].y, 1.0f / rayDirections[query].z);
+        float nearest = sceneSize;
+        for (const Culling::AABB& box : boxes)
+        {
+            float entry;
+            if (IntersectRayBox(rayOrigins[query], inverseDirection, box, nearest, entry))
+            {
+                nearest = std::min(nearest, entry);
+            }
+        }
+        rayMismatches += (nearest != rayDistances[query]) ? 1 : 0;
+    }
+    auto linearRayTime = std::chrono::steady_clock::now();
+
+    // ranges: boxes ten units across at random places
+    std::vector<Culling::AABB> ranges(queryCount);
+    for (Culling::AABB& range : ranges)
+    {
+        glm::vec3 center(positionRange(random), positionRange(random), positionRange(random));
+        range.minimum = center - glm::vec3(5.0f, 5.0f, 5.0f);
+        range.maximum = center + glm::vec3(5.0f, 5.0f, 5.0f);
+    }
+    std::vector<int> found;
+    size_t rangeResults = 0;
+    auto rangeStartTime = std::chrono::steady_clock::now();
+    for (const Culling::AABB& range : ranges)
+    {
+        found.clear();
+        bvh.QueryRange(range, found);
+        rangeResults += found.size();
+    }
+    auto rangeTime = std::chrono::steady_clock::now();
+    size_t linearRangeResults = 0;
+    for (const Culling::AABB& range : ranges)
+    {
+        for (const Culling::AABB& box : boxes)
+        {
+            linearRangeResults += BoxesOverlap(box, range) ? 1 : 0;
+        }
+    }
+    auto linearRangeTime = std::chrono::steady_clock::now();
+
+    std::cout << "INFO: BVH benchmark, " << objectCount << " objects, " << bvh.GetNodeCount() << " nodes" << std::endl;
+    std::cout << "INFO:   build " << milliseconds(buildTime - startTime) << " ms, refit "
+        << milliseconds(refitTime - refitStartTime) << " ms, SAH cost " << builtCost << " -> " << bvh.GetCost()
+        << " after refit" << std::endl;
+    std::cout << "INFO:   frustum " << microsecondsPerQuery(frustumTime - frustumStartTime) << " us/query vs linear "
+        << microsecondsPerQuery(linearFrustumTime - frustumTime) << " us, " << visible.size() << " visible"
+        << (visible.size() == linearVisible ? "" : " (MISMATCH)") << std::endl;
+    std::cout << "INFO:   ray     " << microsecondsPerQuery(rayTime - rayStartTime) << " us/query vs linear "
+        << microsecondsPerQuery(linearRayTime - rayTime) << " us, " << rayHits << " hits, "
+        << rayMismatches << " mismatches" << std::endl;
+    std::cout << "INFO:   range   " << microsecondsPerQuery(rangeTime - rangeStartTime) << " us/query vs linear "
+        << microsecondsPerQuery(linearRangeTime - rangeTime) << " us, " << rangeResults << " results"
+        << (rangeResults == linearRangeResults ? "" : " (MISMATCH)") << std::endl;
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumehierarchy.h
+// ============
+// bounding volume hierarchy over scene object boxes for culling and picking
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Culling.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+/***********************************************************
+ *  BoundingVolumeHierarchy
+ *
+ *  This class indexes a set of objects by their world boxes
+ *  in a binary tree of boxes. The tree is built top down,
+ *  splitting each node where the surface area heuristic
+ *  predicts the cheapest traversal, so frustum, ray and
+ *  range queries only visit the parts of the scene they
+ *  can touch. When objects move, Refit() grows and shrinks
+ *  the node boxes in place without changing the tree; a
+ *  rebuild is only worth it once objects have moved far
+ *  from where the tree was built. Objects are identified by
+ *  their index in the box array passed in.
+ ***********************************************************/
+class BoundingVolumeHierarchy
+{
+public:
+    // Returned by QueryRay() when nothing is hit
+    static const int NO_HIT = -1;
+
+    // Build the tree over the boxes of every object
+    void Build(const std::vector<Culling::AABB>& objectBoxes);
+    // Update the object boxes, same count and order as the build, and refit the nodes
+    void Refit(const std::vector<Culling::AABB>& objectBoxes);
+
+    // Append the objects whose box is not entirely outside the frustum
+    void QueryFrustum(const Culling::FRUSTUM& frustum, std::vector<int>& objects) const;
+    // Nearest object whose box the ray enters within maxDistance - returns NO_HIT if none
+    int QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const;
+    // Append the objects whose box overlaps the range box
+    void QueryRange(const Culling::AABB& range, std::vector<int>& objects) const;
+
+    size_t GetObjectCount() const { return m_objectBoxes.size(); }
+    size_t GetNodeCount() const { return m_nodes.size(); }
+    // Expected traversal cost of the tree by the surface area heuristic
+    float GetCost() const;
+
+    // Time building, refitting and querying generated scenes against linear scans
+    static void RunBenchmark(size_t objectCount);
+
+private:
+    // A leaf holds objectCount objects starting at firstObject in
+    // m_objectIndices; an inner node has objectCount 0 and its two
+    // children at firstChild and firstChild + 1
+    struct BVH_NODE
+    {
+        Culling::AABB box;
+        int32_t firstChildOrObject;
+        int32_t objectCount;
+    };
+
+    // Split the objects of a node at the cheapest bin boundary - false if a leaf is cheaper
+    bool SplitNode(int node);
+    // Append the objects of a subtree without testing them
+    void CollectSubtree(int node, std::vector<int>& objects) const;
+
+    std::vector<BVH_NODE> m_nodes;
+    // object indices, grouped so every leaf's objects are contiguous
+    std::vector<int> m_objectIndices;
+    std::vector<Culling::AABB> m_objectBoxes;
+    // box centers used while building
+    std::vector<glm::vec3> m_centroids;
+};
@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+// culling.cpp
+// ============
+// bounding volumes and view-frustum tests
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    float PlaneDistance(const glm::vec4& plane, const glm::vec3& point)
+    {
+        return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+    }
+
+    // the corner of a box farthest along the plane normal; if even that
+    // corner is behind the plane, the whole box is
+    bool IsBoxBehindPlane(const glm::vec4& plane, const Culling::AABB& box)
+    {
+        glm::vec3 corner(
+            plane.x >= 0.0f ? box.maximum.x : box.minimum.x,
+            plane.y >= 0.0f ? box.maximum.y : box.minimum.y,
+            plane.z >= 0.0f ? box.maximum.z : box.minimum.z);
+        return PlaneDistance(plane, corner) < 0.0f;
+    }
+}
+
+/***********************************************************
+ *  ComputeBox()
+ *
+ *  This method is used for finding the local bounding box
+ *  of a mesh from its vertex positions.
+ ***********************************************************/
+Culling::AABB Culling::ComputeBox(const float* pPositions, size_t vertexCount, size_t floatStride)
+{
+    AABB box;
+    box.minimum = glm::vec3(0.0f, 0.0f, 0.0f);
+    box.maximum = glm::vec3(0.0f, 0.0f, 0.0f);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const float* pPosition = pPositions + i * floatStride;
+        glm::vec3 position(pPosition[0], pPosition[1], pPosition[2]);
+        box.minimum = (i == 0) ? position : glm::min(box.minimum, position);
+        box.maximum = (i == 0) ? position : glm::max(box.maximum, position);
+    }
+    return box;
+}
+
+/***********************************************************
+ *  TransformBounds()
+ *
+ *  This method is used for finding the world bounds of a
+ *  mesh from its local box and model matrix. The box's
+ *  half extents are projected onto the world axes through
+ *  the absolute matrix, which gives the tightest world
+ *  aligned box around the transformed box without
+ *  transforming its eight corners. The sphere is the
+ *  smaller of the one around that box and the one around
+ *  the local box scaled by the largest axis scale.
+ ***********************************************************/
+Culling::WORLD_BOUNDS Culling::TransformBounds(const AABB& localBox, const glm::mat4& model)
+{
+    glm::vec3 localCenter = (localBox.minimum + localBox.maximum) * 0.5f;
+    glm::vec3 localExtent = (localBox.maximum - localBox.minimum) * 0.5f;
+
+    glm::vec3 center(model[3].x, model[3].y, model[3].z);
+    glm::vec3 extent(0.0f, 0.0f, 0.0f);
+    float maxScaleSquared = 0.0f;
+    for (int column = 0; column < 3; column++)
+    {
+        glm::vec3 axis(model[column].x, model[column].y, model[column].z);
+        center += axis * localCenter[column];
+        extent += glm::vec3(std::fabs(axis.x), std::fabs(axis.y), std::fabs(axis.z)) * localExtent[column];
+        maxScaleSquared = std::max(maxScaleSquared, axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+    }
+
+    WORLD_BOUNDS bounds;
+    bounds.box.minimum = center - extent;
+    bounds.box.maximum = center + extent;
+    bounds.center = center;
+    float boxRadius = std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+    float localRadius = std::sqrt(localExtent.x * localExtent.x + localExtent.y * localExtent.y + localExtent.z * localExtent.z);
+    bounds.radius = std::min(boxRadius, localRadius * std::sqrt(maxScaleSquared));
+    return bounds;
+}
+
+/***********************************************************
+ *  ExtractFrustum()
+ *
+ *  This method is used for reading the frustum planes out
+ *  of a view-projection matrix: a clip space point is
+ *  inside when -w <= x, y, z <= w, and each of those six
+ *  inequalities is a plane in world space made of the
+ *  matrix rows.
+ ***********************************************************/
+Culling::FRUSTUM Culling::ExtractFrustum(const glm::mat4& viewProjection)
+{
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; row++)
+    {
+        rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+    }
+
+    FRUSTUM frustum;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        frustum.planes[axis * 2] = rows[3] + rows[axis];
+        frustum.planes[axis * 2 + 1] = rows[3] - rows[axis];
+    }
+
+    for (glm::vec4& plane : frustum.planes)
+    {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0.0f)
+        {
+            plane = plane * (1.0f / length);
+        }
+    }
+    return frustum;
+}
+
+/***********************************************************
+ *  IsOutsideFrustum()
+ *
+ *  This method is used for rejecting an object that cannot
+ *  be seen. The sphere settles most planes with one dot
+ *  product; only a plane cutting through the sphere needs
+ *  the box test. The test is conservative: an object near
+ *  a frustum corner may be kept, but a visible one is never
+ *  rejected.
+ ***********************************************************/
+bool Culling::IsOutsideFrustum(const FRUSTUM& frustum, const WORLD_BOUNDS& bounds)
+{
+    for (const glm::vec4& plane : frustum.planes)
+    {
+        float distance = PlaneDistance(plane, bounds.center);
+        if (distance < -bounds.radius)
+        {
+            return true;
+        }
+        if (distance < bounds.radius && IsBoxBehindPlane(plane, bounds.box))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/***********************************************************
+ *  IsOutsideFrustum()
+ *
+ *  This method is used for rejecting a box that is entirely
+ *  behind one of the frustum planes.
+ ***********************************************************/
+bool Culling::IsOutsideFrustum(const FRUSTUM& frustum, const AABB& box)
+{
+    for (const glm::vec4& plane : frustum.planes)
+    {
+        if (IsBoxBehindPlane(plane, box))
+        {
+            return true;
+        }
+    }
+    return false;
+}
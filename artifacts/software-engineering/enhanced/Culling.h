@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+// culling.h
+// ============
+// bounding volumes and view-frustum tests
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  Culling
+ *
+ *  These functions carry a mesh's local bounding box into
+ *  world space and test world bounds against the view
+ *  frustum. The frustum planes come straight from a
+ *  view-projection matrix, so perspective and orthographic
+ *  projections are handled the same way. The functions keep
+ *  no state and are safe to call from several threads.
+ ***********************************************************/
+namespace Culling
+{
+    // Axis-aligned box given by its corners
+    struct AABB
+    {
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+    };
+
+    // World bounds of an object: a box, and a sphere around it for the quick test
+    struct WORLD_BOUNDS
+    {
+        AABB box;
+        glm::vec3 center;
+        float radius;
+    };
+
+    // Six planes facing into the frustum: left, right, bottom, top, near, far.
+    // A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+    struct FRUSTUM
+    {
+        glm::vec4 planes[6];
+    };
+
+    // Box around the positions of interleaved vertices, floatStride floats apart
+    AABB ComputeBox(const float* pPositions, size_t vertexCount, size_t floatStride);
+
+    // Bounds of a local box placed by a model matrix
+    WORLD_BOUNDS TransformBounds(const AABB& localBox, const glm::mat4& model);
+
+    // Frustum of a view-projection matrix, with normalized planes
+    FRUSTUM ExtractFrustum(const glm::mat4& viewProjection);
+
+    // True if the bounds are entirely outside the frustum
+    bool IsOutsideFrustum(const FRUSTUM& frustum, const WORLD_BOUNDS& bounds);
+    bool IsOutsideFrustum(const FRUSTUM& frustum, const AABB& box);
+}
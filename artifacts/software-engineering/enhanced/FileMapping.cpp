@@ -0,0 +1,236 @@
+///////////////////////////////////////////////////////////////////////////////
+// filemapping.cpp
+// ============
+// read-only memory mapping of a whole file (mmap / CreateFileMapping)
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileMapping.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************
+ *  FileMapping()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileMapping::FileMapping()
+{
+    m_pData = NULL;
+    m_size = 0;
+#ifdef _WIN32
+    m_fileHandle = INVALID_HANDLE_VALUE;
+    m_mappingHandle = NULL;
+#else
+    m_fileDescriptor = -1;
+#endif
+}
+
+/***********************************************************
+ *  ~FileMapping()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FileMapping::~FileMapping()
+{
+    Close();
+}
+
+FileMapping::FileMapping(FileMapping&& other) noexcept
+    : FileMapping()
+{
+    MoveFrom(other);
+}
+
+FileMapping& FileMapping::operator=(FileMapping&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        MoveFrom(other);
+    }
+    return *this;
+}
+
+/***********************************************************
+ *  MoveFrom()
+ *
+ *  This method is used for taking ownership of the handles
+ *  and mapped view of another object, leaving it empty.
+ ***********************************************************/
+void FileMapping::MoveFrom(FileMapping& other)
+{
+    m_pData = other.m_pData;
+    m_size = other.m_size;
+    other.m_pData = NULL;
+    other.m_size = 0;
+#ifdef _WIN32
+    m_fileHandle = other.m_fileHandle;
+    m_mappingHandle = other.m_mappingHandle;
+    other.m_fileHandle = INVALID_HANDLE_VALUE;
+    other.m_mappingHandle = NULL;
+#else
+    m_fileDescriptor = other.m_fileDescriptor;
+    other.m_fileDescriptor = -1;
+#endif
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping the passed in file into
+ *  memory. Any previous mapping is released first. A file
+ *  that will be read front to back gets the read-ahead
+ *  hint; one only partly read, like an image header, must
+ *  not, or all of it is read in anyway.
+ ***********************************************************/
+bool FileMapping::Open(const char* filename, bool bSequential)
+{
+    Close();
+
+    if (filename == NULL)
+    {
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | (bSequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0), NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle == NULL)
+    {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    void* pView = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (pView == NULL)
+    {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    m_fileHandle = fileHandle;
+    m_mappingHandle = mappingHandle;
+    m_pData = static_cast<const unsigned char*>(pView);
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fileDescriptor = open(filename, O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat fileInfo;
+    if (fstat(fileDescriptor, &fileInfo) != 0 || fileInfo.st_size <= 0)
+    {
+        close(fileDescriptor);
+        return false;
+    }
+
+    void* pView = mmap(NULL, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (pView == MAP_FAILED)
+    {
+        close(fileDescriptor);
+        return false;
+    }
+
+    m_fileDescriptor = fileDescriptor;
+    m_pData = static_cast<const unsigned char*>(pView);
+    m_size = static_cast<size_t>(fileInfo.st_size);
+
+    if (bSequential)
+    {
+        AdviseSequential();
+    }
+#endif
+
+    return true;
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the file and closing
+ *  its handles. It is safe to call when nothing is mapped.
+ ***********************************************************/
+void FileMapping::Close()
+{
+#ifdef _WIN32
+    if (m_pData != NULL)
+    {
+        UnmapViewOfFile(m_pData);
+    }
+    if (m_mappingHandle != NULL)
+    {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = NULL;
+    }
+    if (m_fileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_pData != NULL)
+    {
+        munmap(const_cast<unsigned char*>(m_pData), m_size);
+    }
+    if (m_fileDescriptor >= 0)
+    {
+        close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+    }
+#endif
+
+    m_pData = NULL;
+    m_size = 0;
+}
+
+/***********************************************************
+ *  AdviseSequential()
+ *
+ *  This method is used for telling the kernel the mapping
+ *  is about to be read from start to end, so it reads ahead
+ *  aggressively and drops pages behind the reader. Windows
+ *  gets the same hint from FILE_FLAG_SEQUENTIAL_SCAN when
+ *  Open() creates the file handle.
+ ***********************************************************/
+void FileMapping::AdviseSequential() const
+{
+#ifndef _WIN32
+    if (m_pData != NULL)
+    {
+        void* pView = const_cast<unsigned char*>(m_pData);
+        madvise(pView, m_size, MADV_SEQUENTIAL);
+        madvise(pView, m_size, MADV_WILLNEED);
+    }
+#endif
+}
@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+// filemapping.h
+// ============
+// read-only memory mapping of a whole file (mmap / CreateFileMapping)
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  FileMapping
+ *
+ *  This class maps a file into the address space read-only
+ *  and unmaps it when destroyed. It is movable but not
+ *  copyable, so the mapping always has a single owner.
+ ***********************************************************/
+class FileMapping
+{
+public:
+    // Constructor
+    FileMapping();
+    // Destructor
+    ~FileMapping();
+
+    FileMapping(FileMapping&& other) noexcept;
+    FileMapping& operator=(FileMapping&& other) noexcept;
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+
+    // Map the whole file, hinting a front to back read if bSequential -
+    // returns false if it cannot be opened or is empty
+    bool Open(const char* filename, bool bSequential);
+    // Unmap the file and release the handles
+    void Close();
+
+    // Mapped bytes, or NULL when nothing is mapped
+    const unsigned char* GetData() const { return m_pData; }
+    // Number of mapped bytes
+    size_t GetSize() const { return m_size; }
+    // Check if a file is currently mapped
+    bool IsOpen() const { return m_pData != NULL; }
+
+private:
+    // Take over the mapping owned by another object
+    void MoveFrom(FileMapping& other);
+    // Hint that the mapping will be read once, front to back
+    void AdviseSequential() const;
+
+    const unsigned char* m_pData;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_fileHandle;
+    void* m_mappingHandle;
+#else
+    int m_fileDescriptor;
+#endif
+};
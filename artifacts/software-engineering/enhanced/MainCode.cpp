@@ -14,6 +14,7 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -27,6 +28,8 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "TransformKernel.h"
+#include "BoundingVolumeHierarchy.h"
 
 // Namespace for declaring global variables
 namespace
@@ -48,6 +51,24 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+    // --benchmark-transforms times the model matrix kernels and exits
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-transforms") == 0)
+    {
+        TransformKernel::RunBenchmark(1000);
+        TransformKernel::RunBenchmark(10000);
+        TransformKernel::RunBenchmark(100000);
+        return EXIT_SUCCESS;
+    }
+
+    // --benchmark-bvh times the scene hierarchy against linear scans and exits
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-bvh") == 0)
+    {
+        BoundingVolumeHierarchy::RunBenchmark(10000);
+        BoundingVolumeHierarchy::RunBenchmark(100000);
+        BoundingVolumeHierarchy::RunBenchmark(1000000);
+        return EXIT_SUCCESS;
+    }
+
     // Defensive check: GLFW initialization
     if (!InitializeGLFW())
     {
@@ -84,6 +105,16 @@ int main(int argc, char* argv[])
 
     // Load 3D scene
     g_SceneManager = new SceneManager(g_ShaderManager);
+    // --occlusion-culling skips the objects hidden behind the large ones
+    if (argc > 1 && std::strcmp(argv[1], "--occlusion-culling") == 0)
+    {
+        g_SceneManager->SetOcclusionCulling(true);
+    }
+    // --benchmark-texture-load times the old serial texture load against the pooled one
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-texture-load") == 0)
+    {
+        g_SceneManager->SetSerialTextureBenchmark(true);
+    }
     g_SceneManager->PrepareScene();
 
     std::cout << "\n*** KEY FUNCTIONS: ***\n";
@@ -103,6 +134,8 @@ int main(int argc, char* argv[])
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         g_ViewManager->PrepareSceneView();
+        g_SceneManager->SetViewPosition(g_ViewManager->GetCameraPosition());
+        g_SceneManager->SetViewProjection(g_ViewManager->GetViewProjection());
         g_SceneManager->RenderScene();
 
         glfwSwapBuffers(g_Window);
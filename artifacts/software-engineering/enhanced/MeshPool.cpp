@@ -0,0 +1,267 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshpool.cpp
+// ============
+// basic shape meshes packed into one shared vertex and index buffer
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshPool.h"
+
+#include <iostream>
+
+namespace
+{
+    // the streamed buffers grow in steps of this many elements
+    const size_t g_StreamCapacityStep = 64;
+
+    // orphan a streamed buffer, growing it when needed, and upload into it;
+    // a draw still reading the old storage on the GPU never stalls the upload
+    void StreamBuffer(GLenum target, GLuint buffer, size_t& capacity, size_t elementSize, const void* pData, size_t count)
+    {
+        if (count > capacity)
+        {
+            capacity = (count + g_StreamCapacityStep - 1) / g_StreamCapacityStep * g_StreamCapacityStep;
+        }
+        glBindBuffer(target, buffer);
+        glBufferData(target, elementSize * capacity, NULL, GL_STREAM_DRAW);
+        glBufferSubData(target, 0, elementSize * count, pData);
+    }
+
+    // turn the per-instance attributes of the bound vertex array on or off
+    void EnableInstanceAttributes(bool bEnable)
+    {
+        for (GLuint location = MeshPool::INSTANCE_ATTRIBUTE; location < MeshPool::INSTANCE_ATTRIBUTE + 5; location++)
+        {
+            if (bEnable)
+                glEnableVertexAttribArray(location);
+            else
+                glDisableVertexAttribArray(location);
+        }
+    }
+}
+
+/***********************************************************
+ *  MeshPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshPool::MeshPool()
+{
+    m_vao = 0;
+    m_vertexBuffer = 0;
+    m_indexBuffer = 0;
+    m_instanceBuffer = 0;
+    m_indirectBuffer = 0;
+    m_drawBuffer = 0;
+    m_instanceCapacity = 0;
+    m_drawCapacity = 0;
+    m_bMultiDrawSupported = false;
+}
+
+/***********************************************************
+ *  ~MeshPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshPool::~MeshPool()
+{
+    if (m_vao != 0)
+    {
+        glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+
+    GLuint buffers[5] = { m_vertexBuffer, m_indexBuffer, m_instanceBuffer, m_indirectBuffer, m_drawBuffer };
+    glDeleteBuffers(5, buffers);
+    m_vertexBuffer = 0;
+    m_indexBuffer = 0;
+    m_instanceBuffer = 0;
+    m_indirectBuffer = 0;
+    m_drawBuffer = 0;
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for appending a mesh to the pool.
+ *  Its indices are kept relative to its own first vertex;
+ *  the base vertex recorded for it offsets them at draw
+ *  time, so no index is rewritten.
+ ***********************************************************/
+int MeshPool::AddMesh(const ShapeGeometry::MESH_DATA& mesh)
+{
+    MESH_RANGE range;
+    range.firstIndex = static_cast<GLuint>(m_indices.size());
+    range.indexCount = static_cast<GLuint>(mesh.indices.size());
+    range.baseVertex = static_cast<GLint>(m_vertices.size() / ShapeGeometry::FLOATS_PER_VERTEX);
+    m_ranges.push_back(range);
+
+    m_vertices.insert(m_vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    m_indices.insert(m_indices.end(), mesh.indices.begin(), mesh.indices.end());
+    return static_cast<int>(m_ranges.size()) - 1;
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for creating the vertex array with
+ *  every mesh's vertices and indices, and the per-instance
+ *  attributes: a mat4 takes four vec4 locations, and the
+ *  material index and layer are read as integers. The
+ *  instance attributes stay disabled outside an instanced
+ *  draw, since the instance buffer has no storage before
+ *  the first one. The CPU copies are released once the GPU
+ *  has them.
+ ***********************************************************/
+bool MeshPool::Upload()
+{
+    if (m_vao != 0 || m_ranges.empty())
+    {
+        return IsLoaded();
+    }
+
+    const GLsizei vertexStride = sizeof(float) * ShapeGeometry::FLOATS_PER_VERTEX;
+    const GLsizei instanceStride = sizeof(MESH_INSTANCE);
+
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+
+    glGenBuffers(1, &m_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(float) * 3));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(float) * 6));
+
+    glGenBuffers(1, &m_indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * m_indices.size(), m_indices.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        GLuint location = INSTANCE_ATTRIBUTE + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, instanceStride,
+            (void*)(offsetof(MESH_INSTANCE, model) + sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(location, 1);
+    }
+    glVertexAttribIPointer(INSTANCE_ATTRIBUTE + 4, 2, GL_INT, instanceStride,
+        (void*)offsetof(MESH_INSTANCE, materialIndex));
+    glVertexAttribDivisor(INSTANCE_ATTRIBUTE + 4, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // gl_DrawID is core from OpenGL 4.6; older contexts draw one command at a time
+    GLint majorVersion = 0;
+    GLint minorVersion = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+    m_bMultiDrawSupported = (majorVersion > 4) || (majorVersion == 4 && minorVersion >= 6);
+    if (m_bMultiDrawSupported)
+    {
+        glGenBuffers(1, &m_indirectBuffer);
+        glGenBuffers(1, &m_drawBuffer);
+    }
+
+    std::cout << "INFO: Mesh pool holds " << m_ranges.size() << " meshes, "
+        << m_vertices.size() / ShapeGeometry::FLOATS_PER_VERTEX << " vertices and "
+        << m_indices.size() << " indices in one vertex array (multi-draw "
+        << (m_bMultiDrawSupported ? "on" : "off") << ")" << std::endl;
+
+    std::vector<float>().swap(m_vertices);
+    std::vector<uint32_t>().swap(m_indices);
+    return IsLoaded();
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the shared vertex array.
+ *  Every mesh draws through it, so it is bound once for a
+ *  whole frame of draws.
+ ***********************************************************/
+void MeshPool::Bind() const
+{
+    glBindVertexArray(m_vao);
+}
+
+/***********************************************************
+ *  Unbind()
+ *
+ *  This method is used for unbinding the shared vertex
+ *  array after the frame's draws.
+ ***********************************************************/
+void MeshPool::Unbind() const
+{
+    glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing a single mesh from its
+ *  range of the shared buffers.
+ ***********************************************************/
+void MeshPool::DrawMesh(int mesh) const
+{
+    const MESH_RANGE& range = m_ranges[mesh];
+    glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+        (void*)(sizeof(uint32_t) * range.firstIndex), range.baseVertex);
+}
+
+/***********************************************************
+ *  DrawInstances()
+ *
+ *  This method is used for drawing every passed in instance
+ *  of a mesh with one call. The instance attributes are
+ *  enabled only for this draw, so the other draws of the
+ *  shared vertex array never fetch from the instance buffer.
+ ***********************************************************/
+void MeshPool::DrawInstances(int mesh, const MESH_INSTANCE* pInstances, size_t instanceCount)
+{
+    if (m_vao == 0 || instanceCount == 0)
+    {
+        return;
+    }
+
+    StreamBuffer(GL_ARRAY_BUFFER, m_instanceBuffer, m_instanceCapacity, sizeof(MESH_INSTANCE), pInstances, instanceCount);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const MESH_RANGE& range = m_ranges[mesh];
+    EnableInstanceAttributes(true);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+        (void*)(sizeof(uint32_t) * range.firstIndex), static_cast<GLsizei>(instanceCount), range.baseVertex);
+    EnableInstanceAttributes(false);
+}
+
+/***********************************************************
+ *  MultiDraw()
+ *
+ *  This method is used for submitting a whole list of draws
+ *  with one call. The commands go into the indirect buffer
+ *  and the per-draw data into the shader storage buffer the
+ *  shader indexes with gl_DrawID. The commands run in list
+ *  order, so blended draws still land back to front.
+ ***********************************************************/
+void MeshPool::MultiDraw(const DRAW_ELEMENTS_INDIRECT_COMMAND* pCommands, const MESH_DRAW* pDraws, size_t drawCount)
+{
+    if (!m_bMultiDrawSupported || drawCount == 0)
+    {
+        return;
+    }
+
+    // both buffers hold drawCount elements, so they share one capacity
+    size_t drawCapacity = m_drawCapacity;
+    StreamBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer, drawCapacity, sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND), pCommands, drawCount);
+    StreamBuffer(GL_SHADER_STORAGE_BUFFER, m_drawBuffer, m_drawCapacity, sizeof(MESH_DRAW), pDraws, drawCount);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BUFFER_BINDING, m_drawBuffer);
+
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, static_cast<GLsizei>(drawCount), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshpool.h
+// ============
+// basic shape meshes packed into one shared vertex and index buffer
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeGeometry.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  MESH_INSTANCE
+ *
+ *  Per-instance data read by the vertex shader from the
+ *  instance buffer: the model matrix in attributes 3-6, and
+ *  the material index and texture array layer in the
+ *  integer attribute 7.
+ ***********************************************************/
+struct MESH_INSTANCE
+{
+    glm::mat4 model;
+    int32_t materialIndex;
+    int32_t textureLayer;
+    int32_t padding[2];
+};
+
+/***********************************************************
+ *  MESH_DRAW
+ *
+ *  Per-draw data of a multi-draw, in the std430 layout of
+ *  the shader storage block read as draws[gl_DrawID]. The
+ *  texture array is not part of it: the sampler is one
+ *  uniform, set for each multi-draw of a run of draws from
+ *  the same array.
+ ***********************************************************/
+struct MESH_DRAW
+{
+    glm::mat4 model;
+    glm::vec4 color;        // used when bUseTexture is 0
+    glm::vec2 UVscale;
+    int32_t materialIndex;
+    int32_t textureLayer;
+    int32_t bUseTexture;
+    int32_t padding[3];
+};
+static_assert(sizeof(MESH_DRAW) == 112, "MESH_DRAW must match the std430 layout");
+
+// Where a mesh lives in the shared buffers
+struct MESH_RANGE
+{
+    GLuint firstIndex;
+    GLuint indexCount;
+    GLint baseVertex;
+};
+
+// Layout of one command in the GL_DRAW_INDIRECT_BUFFER
+struct DRAW_ELEMENTS_INDIRECT_COMMAND
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+/***********************************************************
+ *  MeshPool
+ *
+ *  This class packs any number of meshes into one vertex
+ *  buffer and one index buffer behind a single vertex array,
+ *  with the same vertex layout as ShapeMeshes - position at
+ *  location 0, normal at 1 and texture coordinate at 2. A
+ *  mesh is a range of the index buffer plus the base vertex
+ *  its indices count from, so moving from one mesh to the
+ *  next never binds another vertex array. The pool draws a
+ *  mesh on its own, many instances of a mesh in one call,
+ *  or a whole list of draws with one
+ *  glMultiDrawElementsIndirect() call.
+ ***********************************************************/
+class MeshPool
+{
+public:
+    // First vertex attribute location used by the instance data
+    static const GLuint INSTANCE_ATTRIBUTE = 3;
+    // Shader storage binding of the per-draw data of a multi-draw
+    static const GLuint DRAW_BUFFER_BINDING = 1;
+
+    // Constructor
+    MeshPool();
+    // Destructor
+    ~MeshPool();
+
+    // Append a mesh before Upload() - returns its ID
+    int AddMesh(const ShapeGeometry::MESH_DATA& mesh);
+    // Create the GL buffers of every added mesh - GL thread only
+    bool Upload();
+    bool IsLoaded() const { return m_vao != 0; }
+    // True if the context can submit a multi-draw that reads gl_DrawID
+    bool IsMultiDrawSupported() const { return m_bMultiDrawSupported; }
+
+    const MESH_RANGE& GetRange(int mesh) const { return m_ranges[mesh]; }
+    size_t GetMeshCount() const { return m_ranges.size(); }
+
+    // Bind the shared vertex array before drawing, and unbind it after
+    void Bind() const;
+    void Unbind() const;
+
+    // Draw one mesh - the pool must be bound
+    void DrawMesh(int mesh) const;
+    // Upload the instances and draw them all in one call - the pool must be bound
+    void DrawInstances(int mesh, const MESH_INSTANCE* pInstances, size_t instanceCount);
+    // Upload the commands and their per-draw data and submit them in one call - the pool must be bound
+    void MultiDraw(const DRAW_ELEMENTS_INDIRECT_COMMAND* pCommands, const MESH_DRAW* pDraws, size_t drawCount);
+
+private:
+    // Vertices and indices waiting for Upload()
+    std::vector<float> m_vertices;
+    std::vector<uint32_t> m_indices;
+    std::vector<MESH_RANGE> m_ranges;
+
+    GLuint m_vao;
+    GLuint m_vertexBuffer;
+    GLuint m_indexBuffer;
+    GLuint m_instanceBuffer;
+    GLuint m_indirectBuffer;
+    GLuint m_drawBuffer;
+    // instances, and multi-draw commands, the streamed buffers have room for
+    size_t m_instanceCapacity;
+    size_t m_drawCapacity;
+    bool m_bMultiDrawSupported;
+};
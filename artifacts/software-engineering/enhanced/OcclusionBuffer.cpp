@@ -0,0 +1,424 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionbuffer.cpp
+// ============
+// low-resolution software depth buffer for occlusion culling on the CPU
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <thread>
+
+// the AVX2 path multiplies and adds separately, since AVX2 alone does
+// not imply FMA
+#if defined(__AVX2__)
+#define OCCLUSION_BUFFER_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_BUFFER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // rows per band handed to one thread at a time
+    const int g_BandHeight = 16;
+    const int g_BandCount = OcclusionBuffer::HEIGHT / g_BandHeight;
+
+    // vertices closer to the eye than this clip space w are treated as
+    // crossing the near plane
+    const float g_MinimumW = 1e-5f;
+
+    // depth of an empty pixel: the far plane in normalized device coordinates
+    const float g_FarDepth = 1.0f;
+
+    // depth of a pixel corner no occluder triangle covers; farther than
+    // anything, so a pixel with such a corner is never filled
+    const float g_UncoveredDepth = std::numeric_limits<float>::infinity();
+
+    // floats per row of pixel corners: WIDTH + 1 corners, padded so the
+    // vector paths can start on a multiple of 8 and never leave the row
+    const int g_CornerStride = OcclusionBuffer::WIDTH + 8;
+
+    // the triangles of one occluder and the pixel corners they can cover
+    struct OCCLUDER_RANGE
+    {
+        size_t firstTriangle;
+        size_t endTriangle;
+        int minX;
+        int maxX;
+        int minY;
+        int maxY;
+    };
+
+    // the triangles of one frame and the bands still to be filled; shared
+    // with the worker tasks so a task that starts after the frame is done
+    // finds no band left and never touches the buffer
+    struct RASTER_JOB
+    {
+        std::vector<OcclusionBuffer::SCREEN_TRIANGLE> triangles;
+        std::vector<OCCLUDER_RANGE> occluders;
+        float* pDepth;
+        std::atomic<int> nextBand;
+        std::atomic<int> finishedBands;
+    };
+
+    // fill the pixel corners of one row of a triangle, keeping the nearer depth
+    void RasterizeRow(const OcclusionBuffer::SCREEN_TRIANGLE& triangle, int y, float* pRow)
+    {
+        float cornerY = static_cast<float>(y);
+        float rowE0 = triangle.edgeB[0] * cornerY + triangle.edgeC[0];
+        float rowE1 = triangle.edgeB[1] * cornerY + triangle.edgeC[1];
+        float rowE2 = triangle.edgeB[2] * cornerY + triangle.edgeC[2];
+        float rowZ = triangle.zY * cornerY + triangle.zC;
+        int x = triangle.minX;
+
+#if defined(OCCLUSION_BUFFER_AVX2)
+        // 8 corners at a time; the padded row stride is a multiple of 8, so
+        // starting on a multiple of 8 never reads or writes past the row
+        x &= ~7;
+        const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        const __m256 zero = _mm256_setzero_ps();
+        for (; x <= triangle.maxX; x += 8)
+        {
+            __m256 cornerX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane);
+            __m256 e0 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edgeA[0]), cornerX), _mm256_set1_ps(rowE0));
+            __m256 e1 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edgeA[1]), cornerX), _mm256_set1_ps(rowE1));
+            __m256 e2 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edgeA[2]), cornerX), _mm256_set1_ps(rowE2));
+            __m256 inside = _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+                _mm256_and_ps(_mm256_cmp_ps(e1, zero, _CMP_GE_OQ), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ)));
+            if (_mm256_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+            __m256 depth = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.zX), cornerX), _mm256_set1_ps(rowZ));
+            __m256 stored = _mm256_loadu_ps(pRow + x);
+            _mm256_storeu_ps(pRow + x, _mm256_blendv_ps(stored, _mm256_min_ps(stored, depth), inside));
+        }
+#elif defined(OCCLUSION_BUFFER_SSE2)
+        x &= ~3;
+        const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        const __m128 zero = _mm_setzero_ps();
+        for (; x <= triangle.maxX; x += 4)
+        {
+            __m128 cornerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[0]), cornerX), _mm_set1_ps(rowE0));
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[1]), cornerX), _mm_set1_ps(rowE1));
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[2]), cornerX), _mm_set1_ps(rowE2));
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+            if (_mm_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+            __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.zX), cornerX), _mm_set1_ps(rowZ));
+            __m128 stored = _mm_loadu_ps(pRow + x);
+            __m128 nearer = _mm_min_ps(stored, depth);
+            _mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+        }
+#else
+        for (; x <= triangle.maxX; x++)
+        {
+            float cornerX = static_cast<float>(x);
+            if (triangle.edgeA[0] * cornerX + rowE0 >= 0.0f &&
+                triangle.edgeA[1] * cornerX + rowE1 >= 0.0f &&
+                triangle.edgeA[2] * cornerX + rowE2 >= 0.0f)
+            {
+                pRow[x] = std::min(pRow[x], triangle.zX * cornerX + rowZ);
+            }
+        }
+#endif
+    }
+
+    // claim bands until none are left, clearing and filling each one. Each
+    // occluder is sampled at the corners of the band's pixels on its own,
+    // and a pixel takes the farthest of its four corner depths, only if the
+    // occluder covers all four of them
+    void RasterizeBands(RASTER_JOB& job)
+    {
+        std::vector<float> corners((g_BandHeight + 1) * g_CornerStride, g_UncoveredDepth);
+
+        for (int band = job.nextBand.fetch_add(1); band < g_BandCount; band = job.nextBand.fetch_add(1))
+        {
+            int firstRow = band * g_BandHeight;
+            int endRow = firstRow + g_BandHeight;
+            float* pBand = job.pDepth + firstRow * OcclusionBuffer::WIDTH;
+            std::fill(pBand, pBand + g_BandHeight * OcclusionBuffer::WIDTH, g_FarDepth);
+
+            for (const OCCLUDER_RANGE& occluder : job.occluders)
+            {
+                // corner rows firstRow to endRow bound the band's pixel rows
+                int cornerStart = std::max(occluder.minY, firstRow);
+                int cornerEnd = std::min(occluder.maxY, endRow);
+                if (cornerStart >= cornerEnd || occluder.minX >= occluder.maxX)
+                {
+                    continue;
+                }
+
+                for (int y = cornerStart; y <= cornerEnd; y++)
+                {
+                    float* pCorners = corners.data() + (y - firstRow) * g_CornerStride;
+                    std::fill(pCorners + occluder.minX, pCorners + occluder.maxX + 1, g_UncoveredDepth);
+                }
+
+                for (size_t i = occluder.firstTriangle; i < occluder.endTriangle; i++)
+                {
+                    const OcclusionBuffer::SCREEN_TRIANGLE& triangle = job.triangles[i];
+                    int rowStart = std::max(triangle.minY, cornerStart);
+                    int rowEnd = std::min(triangle.maxY, cornerEnd);
+                    for (int y = rowStart; y <= rowEnd; y++)
+                    {
+                        RasterizeRow(triangle, y, corners.data() + (y - firstRow) * g_CornerStride);
+                    }
+                }
+
+                for (int y = cornerStart; y < cornerEnd; y++)
+                {
+                    const float* pTop = corners.data() + (y - firstRow) * g_CornerStride;
+                    const float* pBottom = pTop + g_CornerStride;
+                    float* pRow = job.pDepth + y * OcclusionBuffer::WIDTH;
+                    for (int x = occluder.minX; x < occluder.maxX; x++)
+                    {
+                        float farthest = std::max(std::max(pTop[x], pTop[x + 1]), std::max(pBottom[x], pBottom[x + 1]));
+                        pRow[x] = std::min(pRow[x], farthest);
+                    }
+                }
+            }
+            job.finishedBands.fetch_add(1);
+        }
+    }
+
+    // project a point to buffer pixels and depth - false if it is at or
+    // behind the eye
+    bool ProjectPoint(const glm::mat4& transform, const glm::vec3& point, glm::vec3& screen)
+    {
+        glm::vec4 clip = transform * glm::vec4(point.x, point.y, point.z, 1.0f);
+        if (clip.w < g_MinimumW)
+        {
+            return false;
+        }
+        float inverseW = 1.0f / clip.w;
+        screen.x = (clip.x * inverseW * 0.5f + 0.5f) * OcclusionBuffer::WIDTH;
+        screen.y = (clip.y * inverseW * 0.5f + 0.5f) * OcclusionBuffer::HEIGHT;
+        screen.z = clip.z * inverseW;
+        return true;
+    }
+}
+
+/***********************************************************
+ *  OcclusionBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionBuffer::OcclusionBuffer()
+{
+    m_depth.assign(WIDTH * HEIGHT, g_FarDepth);
+    m_viewProjection = glm::mat4(1.0f);
+    m_rasterMilliseconds = 0.0;
+}
+
+/***********************************************************
+ *  Rasterize()
+ *
+ *  This method is used for building the frame's depth
+ *  buffer. The occluder triangles are projected and set up
+ *  once on the calling thread; back facing ones, ones
+ *  covering no pixel corner and ones crossing the near
+ *  plane are dropped.
+ *  The bands are then filled by the calling thread and as
+ *  many pool workers as are free. The calling thread never
+ *  waits on a task that has not started, so a pool busy
+ *  with other work only means it fills more bands itself.
+ ***********************************************************/
+void OcclusionBuffer::Rasterize(const std::vector<OCCLUDER>& occluders, const glm::mat4& viewProjection, ThreadPool* pThreadPool)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    m_viewProjection = viewProjection;
+
+    std::shared_ptr<RASTER_JOB> job = std::make_shared<RASTER_JOB>();
+    job->pDepth = m_depth.data();
+    job->nextBand = 0;
+    job->finishedBands = 0;
+
+    std::vector<glm::vec3> screen;
+    std::vector<uint8_t> bProjected;
+    for (const OCCLUDER& occluder : occluders)
+    {
+        OCCLUDER_RANGE range;
+        range.firstTriangle = job->triangles.size();
+        range.minX = WIDTH;
+        range.maxX = 0;
+        range.minY = HEIGHT;
+        range.maxY = 0;
+
+        const ShapeGeometry::MESH_DATA& mesh = *occluder.pMesh;
+        glm::mat4 transform = viewProjection * occluder.model;
+
+        screen.resize(mesh.GetVertexCount());
+        bProjected.resize(mesh.GetVertexCount());
+        for (size_t i = 0; i < mesh.GetVertexCount(); i++)
+        {
+            const float* pPosition = mesh.vertices.data() + i * ShapeGeometry::FLOATS_PER_VERTEX;
+            bProjected[i] = ProjectPoint(transform, glm::vec3(pPosition[0], pPosition[1], pPosition[2]), screen[i]) ? 1 : 0;
+        }
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            uint32_t a = mesh.indices[i];
+            uint32_t b = mesh.indices[i + 1];
+            uint32_t c = mesh.indices[i + 2];
+            if (!bProjected[a] || !bProjected[b] || !bProjected[c])
+            {
+                continue;
+            }
+            const glm::vec3& p0 = screen[a];
+            const glm::vec3& p1 = screen[b];
+            const glm::vec3& p2 = screen[c];
+
+            // counterclockwise on screen is front facing, as in OpenGL
+            float area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+            if (area <= 0.0f)
+            {
+                continue;
+            }
+
+            // the pixel corners, 0 to WIDTH by 0 to HEIGHT, the triangle can cover
+            SCREEN_TRIANGLE triangle;
+            triangle.minX = std::max(0, static_cast<int>(std::ceil(std::min(p0.x, std::min(p1.x, p2.x)))));
+            triangle.maxX = std::min(WIDTH, static_cast<int>(std::floor(std::max(p0.x, std::max(p1.x, p2.x)))));
+            triangle.minY = std::max(0, static_cast<int>(std::ceil(std::min(p0.y, std::min(p1.y, p2.y)))));
+            triangle.maxY = std::min(HEIGHT, static_cast<int>(std::floor(std::max(p0.y, std::max(p1.y, p2.y)))));
+            if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+            {
+                continue;
+            }
+
+            // a point is inside when it is to the left of every edge. An
+            // edge is always set up from the same end, whichever triangle it
+            // belongs to, so the two triangles sharing it get exactly negated
+            // values and no pixel corner on it falls through both
+            const glm::vec3* corners[3] = { &p0, &p1, &p2 };
+            for (int edge = 0; edge < 3; edge++)
+            {
+                const glm::vec3* pFrom = corners[edge];
+                const glm::vec3* pTo = corners[(edge + 1) % 3];
+                bool bSwapped = (pTo->x < pFrom->x) || (pTo->x == pFrom->x && pTo->y < pFrom->y);
+                if (bSwapped)
+                {
+                    std::swap(pFrom, pTo);
+                }
+                float sign = bSwapped ? -1.0f : 1.0f;
+                float a = pFrom->y - pTo->y;
+                float b = pTo->x - pFrom->x;
+                triangle.edgeA[edge] = sign * a;
+                triangle.edgeB[edge] = sign * b;
+                triangle.edgeC[edge] = sign * -(a * pFrom->x + b * pFrom->y);
+            }
+
+            // normalized device depth is linear in screen space, so it is a plane
+            float dx1 = p1.x - p0.x;
+            float dy1 = p1.y - p0.y;
+            float dx2 = p2.x - p0.x;
+            float dy2 = p2.y - p0.y;
+            float dz1 = p1.z - p0.z;
+            float dz2 = p2.z - p0.z;
+            triangle.zX = (dz1 * dy2 - dz2 * dy1) / area;
+            triangle.zY = (dz2 * dx1 - dz1 * dx2) / area;
+            triangle.zC = p0.z - triangle.zX * p0.x - triangle.zY * p0.y;
+            job->triangles.push_back(triangle);
+
+            range.minX = std::min(range.minX, triangle.minX);
+            range.maxX = std::max(range.maxX, triangle.maxX);
+            range.minY = std::min(range.minY, triangle.minY);
+            range.maxY = std::max(range.maxY, triangle.maxY);
+        }
+
+        range.endTriangle = job->triangles.size();
+        if (range.endTriangle > range.firstTriangle)
+        {
+            job->occluders.push_back(range);
+        }
+    }
+
+    if (pThreadPool != NULL)
+    {
+        unsigned int helpers = std::min(pThreadPool->GetThreadCount(), static_cast<unsigned int>(g_BandCount - 1));
+        for (unsigned int i = 0; i < helpers; i++)
+        {
+            pThreadPool->Submit([job]() { RasterizeBands(*job); });
+        }
+    }
+    RasterizeBands(*job);
+    while (job->finishedBands.load() < g_BandCount)
+    {
+        std::this_thread::yield();
+    }
+
+    m_triangles.swap(job->triangles);
+    m_rasterMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+/***********************************************************
+ *  IsHidden()
+ *
+ *  This method is used for testing a box against the depth
+ *  buffer. The box's eight corners give the screen
+ *  rectangle it can cover and its nearest depth; it is
+ *  hidden only if the occluders are nearer than that at
+ *  every pixel of the rectangle. A box reaching behind the
+ *  eye, or off the screen, is never hidden.
+ ***********************************************************/
+bool OcclusionBuffer::IsHidden(const Culling::AABB& box) const
+{
+    float minX = static_cast<float>(WIDTH);
+    float maxX = 0.0f;
+    float minY = static_cast<float>(HEIGHT);
+    float maxY = 0.0f;
+    float nearestDepth = g_FarDepth;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 point(
+            (corner & 1) ? box.maximum.x : box.minimum.x,
+            (corner & 2) ? box.maximum.y : box.minimum.y,
+            (corner & 4) ? box.maximum.z : box.minimum.z);
+        glm::vec3 screen;
+        if (!ProjectPoint(m_viewProjection, point, screen))
+        {
+            return false;
+        }
+        minX = std::min(minX, screen.x);
+        maxX = std::max(maxX, screen.x);
+        minY = std::min(minY, screen.y);
+        maxY = std::max(maxY, screen.y);
+        nearestDepth = std::min(nearestDepth, screen.z);
+    }
+
+    if (minX < 0.0f || minY < 0.0f || maxX >= WIDTH || maxY >= HEIGHT)
+    {
+        return false;
+    }
+
+    int firstX = static_cast<int>(minX);
+    int lastX = static_cast<int>(maxX);
+    int firstY = static_cast<int>(minY);
+    int lastY = static_cast<int>(maxY);
+    for (int y = firstY; y <= lastY; y++)
+    {
+        const float* pRow = m_depth.data() + y * WIDTH;
+        for (int x = firstX; x <= lastX; x++)
+        {
+            if (pRow[x] >= nearestDepth)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
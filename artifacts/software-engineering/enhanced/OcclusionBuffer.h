@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionbuffer.h
+// ============
+// low-resolution software depth buffer for occlusion culling on the CPU
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Culling.h"
+#include "ShapeGeometry.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/***********************************************************
+ *  OcclusionBuffer
+ *
+ *  This class rasterizes the triangles of a few large
+ *  occluders into a small depth buffer on the CPU, then
+ *  tests the bounding boxes of other objects against it.
+ *  An object whose box is behind the occluders at every
+ *  pixel it covers cannot be seen and need not be drawn.
+ *  The buffer is split into bands of rows, and the calling
+ *  thread and the pool's workers each take whole bands, so
+ *  no two threads ever write the same pixel. The test is
+ *  conservative. Each occluder is sampled at the corners
+ *  of the pixels, and a pixel only takes its depth when all
+ *  four corners are covered, keeping the farthest of them.
+ *  For a convex occluder that bounds its surface over the
+ *  whole pixel, so a box that pokes out past an edge or
+ *  sits in front of a sloped part is never hidden by it.
+ *  Triangles crossing the near plane are left out, and a
+ *  box is only hidden when every pixel under it is, so a
+ *  visible object is never rejected as long as the
+ *  occluders are convex and their meshes lie inside what
+ *  is drawn.
+ ***********************************************************/
+class OcclusionBuffer
+{
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+
+    // A mesh drawn as an occluder, placed by its model matrix
+    struct OCCLUDER
+    {
+        const ShapeGeometry::MESH_DATA* pMesh;
+        glm::mat4 model;
+    };
+
+    // Constructor
+    OcclusionBuffer();
+
+    // Clear the buffer and rasterize the occluders seen through the view-projection
+    void Rasterize(const std::vector<OCCLUDER>& occluders, const glm::mat4& viewProjection, ThreadPool* pThreadPool);
+    // True if the box is behind the occluders everywhere it covers the screen
+    bool IsHidden(const Culling::AABB& box) const;
+
+    // Front facing triangles rasterized by the last Rasterize()
+    int GetTriangleCount() const { return static_cast<int>(m_triangles.size()); }
+    double GetRasterMilliseconds() const { return m_rasterMilliseconds; }
+
+    // One triangle in buffer pixels, with the edge functions and depth
+    // plane used to fill it: an edge function is A * x + B * y + C and is
+    // non-negative inside, the depth is zX * x + zY * y + zC. The bounds are
+    // the pixel corners it can cover, from 0 to WIDTH and HEIGHT
+    struct SCREEN_TRIANGLE
+    {
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        float zX;
+        float zY;
+        float zC;
+        int minX;
+        int maxX;
+        int minY;
+        int maxY;
+    };
+
+private:
+    std::vector<float> m_depth;
+    glm::mat4 m_viewProjection;
+    std::vector<SCREEN_TRIANGLE> m_triangles;
+    double m_rasterMilliseconds;
+};
@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// parent/child transform hierarchy with dirty-flag world matrix updates
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+#include "TransformKernel.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  CreateNode()
+ *
+ *  This method is used for adding a node to the graph. The
+ *  parent must already exist, which keeps every parent
+ *  ahead of its children in the arrays. The world matrix is
+ *  filled in by the next UpdateWorldTransforms().
+ ***********************************************************/
+int SceneGraph::CreateNode(
+    int parent,
+    const glm::vec3& scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    const glm::vec3& positionXYZ)
+{
+    int node = static_cast<int>(m_parents.size());
+    if (parent >= node)
+    {
+        parent = NO_PARENT;
+    }
+
+    LOCAL_TRANSFORM transform = { scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ };
+    m_localTransforms.push_back(transform);
+    m_parents.push_back(parent);
+    m_worldMatrices.push_back(glm::mat4(1.0f));
+    m_dirty.push_back(1);
+    m_bAnyDirty = true;
+    return node;
+}
+
+/***********************************************************
+ *  SetLocalTransform()
+ *
+ *  This method is used for replacing the local transform of
+ *  a node and flagging it, and so its subtree, for update.
+ ***********************************************************/
+void SceneGraph::SetLocalTransform(
+    int node,
+    const glm::vec3& scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    const glm::vec3& positionXYZ)
+{
+    LOCAL_TRANSFORM& transform = m_localTransforms[node];
+    transform.scaleXYZ = scaleXYZ;
+    transform.XrotationDegrees = XrotationDegrees;
+    transform.YrotationDegrees = YrotationDegrees;
+    transform.ZrotationDegrees = ZrotationDegrees;
+    transform.positionXYZ = positionXYZ;
+    m_dirty[node] = 1;
+    m_bAnyDirty = true;
+}
+
+/***********************************************************
+ *  SetLocalPosition()
+ *
+ *  This method is used for moving a node, and everything
+ *  under it, relative to its parent.
+ ***********************************************************/
+void SceneGraph::SetLocalPosition(int node, const glm::vec3& positionXYZ)
+{
+    m_localTransforms[node].positionXYZ = positionXYZ;
+    m_dirty[node] = 1;
+    m_bAnyDirty = true;
+}
+
+/***********************************************************
+ *  UpdateWorldTransforms()
+ *
+ *  This method is used for bringing the world matrices up
+ *  to date. Walking the nodes in handle order visits every
+ *  parent before its children, so a node is recomputed if
+ *  it is dirty or its parent was recomputed in this pass;
+ *  the dirty flags double as that "recomputed" mark. The
+ *  local matrices of all recomputed nodes are composed in
+ *  one batch by the SIMD kernel, then multiplied by their
+ *  parents' world matrices, again in handle order. A frame
+ *  where nothing moved returns straight away.
+ ***********************************************************/
+int SceneGraph::UpdateWorldTransforms()
+{
+    if (!m_bAnyDirty)
+    {
+        return 0;
+    }
+
+    m_batchNodes.clear();
+    for (size_t node = 0; node < m_parents.size(); node++)
+    {
+        int parent = m_parents[node];
+        if (parent != NO_PARENT && m_dirty[parent] != 0)
+        {
+            m_dirty[node] = 1;
+        }
+        if (m_dirty[node] != 0)
+        {
+            m_batchNodes.push_back(static_cast<int>(node));
+        }
+    }
+
+    size_t count = m_batchNodes.size();
+    m_batchComponents.resize(count * 9);
+    m_batchMatrices.resize(count);
+    float* pComponents = m_batchComponents.data();
+    for (size_t i = 0; i < count; i++)
+    {
+        const LOCAL_TRANSFORM& transform = m_localTransforms[m_batchNodes[i]];
+        pComponents[i] = transform.scaleXYZ.x;
+        pComponents[count + i] = transform.scaleXYZ.y;
+        pComponents[count * 2 + i] = transform.scaleXYZ.z;
+        pComponents[count * 3 + i] = transform.XrotationDegrees;
+        pComponents[count * 4 + i] = transform.YrotationDegrees;
+        pComponents[count * 5 + i] = transform.ZrotationDegrees;
+        pComponents[count * 6 + i] = transform.positionXYZ.x;
+        pComponents[count * 7 + i] = transform.positionXYZ.y;
+        pComponents[count * 8 + i] = transform.positionXYZ.z;
+    }
+
+    TransformKernel::TRANSFORM_BATCH batch = {
+        pComponents, pComponents + count, pComponents + count * 2,
+        pComponents + count * 3, pComponents + count * 4, pComponents + count * 5,
+        pComponents + count * 6, pComponents + count * 7, pComponents + count * 8,
+        count };
+    TransformKernel::ComposeTransforms(batch, m_batchMatrices.data(), NULL);
+
+    // a parent is recomputed before its children, so its world matrix is current
+    for (size_t i = 0; i < count; i++)
+    {
+        int node = m_batchNodes[i];
+        int parent = m_parents[node];
+        m_worldMatrices[node] = (parent != NO_PARENT) ? m_worldMatrices[parent] * m_batchMatrices[i] : m_batchMatrices[i];
+    }
+    int recomputed = static_cast<int>(count);
+
+    // the flags had to stay set for the whole pass so children could see them
+    std::fill(m_dirty.begin(), m_dirty.end(), static_cast<uint8_t>(0));
+    m_bAnyDirty = false;
+    return recomputed;
+}
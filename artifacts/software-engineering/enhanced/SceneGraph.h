@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// parent/child transform hierarchy with dirty-flag world matrix updates
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class holds scene nodes in flat arrays indexed by
+ *  node handle. A node has a local scale, X/Y/Z rotation
+ *  and position relative to its parent; its world matrix is
+ *  the parent's world matrix times its local matrix. A
+ *  parent is always created before its children, so one
+ *  pass in handle order updates every dirty subtree, and
+ *  nodes nothing changed under are never recomputed.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+    // Handle passed as the parent of a root node
+    static const int NO_PARENT = -1;
+
+    // Add a node under a parent, or as a root - returns its handle
+    int CreateNode(
+        int parent,
+        const glm::vec3& scaleXYZ,
+        float XrotationDegrees,
+        float YrotationDegrees,
+        float ZrotationDegrees,
+        const glm::vec3& positionXYZ);
+
+    // Replace the local transform of a node; its subtree updates on the next pass
+    void SetLocalTransform(
+        int node,
+        const glm::vec3& scaleXYZ,
+        float XrotationDegrees,
+        float YrotationDegrees,
+        float ZrotationDegrees,
+        const glm::vec3& positionXYZ);
+    // Move a node relative to its parent, keeping its scale and rotation
+    void SetLocalPosition(int node, const glm::vec3& positionXYZ);
+
+    // Recompute the world matrices of dirty subtrees - returns how many were recomputed
+    int UpdateWorldTransforms();
+
+    // World matrix of a node as of the last update
+    const glm::mat4& GetWorldMatrix(int node) const { return m_worldMatrices[node]; }
+    int GetParent(int node) const { return m_parents[node]; }
+    size_t GetNodeCount() const { return m_parents.size(); }
+
+private:
+    // Local transform of a node, relative to its parent
+    struct LOCAL_TRANSFORM
+    {
+        glm::vec3 scaleXYZ;
+        float XrotationDegrees;
+        float YrotationDegrees;
+        float ZrotationDegrees;
+        glm::vec3 positionXYZ;
+    };
+
+    std::vector<LOCAL_TRANSFORM> m_localTransforms;
+    std::vector<int> m_parents;
+    // world matrices stay contiguous so they can be uploaded or copied as one block
+    std::vector<glm::mat4> m_worldMatrices;
+    // nodes whose local transform changed since the last update
+    std::vector<uint8_t> m_dirty;
+    bool m_bAnyDirty = false;
+
+    // dirty nodes of an update, their local transforms as nine runs of one
+    // component each, and their local matrices; kept to reuse the memory
+    std::vector<int> m_batchNodes;
+    std::vector<float> m_batchComponents;
+    std::vector<glm::mat4> m_batchMatrices;
+};
@@ -21,16 +21,311 @@
 #include "stb_image.h"
 #endif
 
+#include "TransformKernel.h"
+
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 // declaration of global variables
 namespace
 {
     const char* g_ModelName = "model";
     const char* g_ColorValueName = "objectColor";
+    // sampler2DArray objectTextureArray / int objectTextureLayer - the texture
+    // array unit and the layer used by a draw, from OpenGL 4.3
+    const char* g_TextureArrayName = "objectTextureArray";
+    const char* g_TextureLayerName = "objectTextureLayer";
+    // sampler2D objectTexture - the texture unit used by a draw on older contexts
     const char* g_TextureValueName = "objectTexture";
     const char* g_UseTextureName = "bUseTexture";
     const char* g_UseLightingName = "bUseLighting";
+    // bool bInstanced - model, materialIndex and objectTextureLayer come
+    // from the instance attributes instead of the uniforms
+    const char* g_InstancedName = "bInstanced";
+    // bool bMultiDraw - every per-draw value comes from draws[gl_DrawID] in
+    // layout(std430, binding = 1) buffer DrawBlock { MeshDraw draws[]; }
+    const char* g_MultiDrawName = "bMultiDraw";
+    const char* g_UVScaleName = "UVscale";
+    // layout(std140) uniform MaterialBlock { Material materials[256]; } and
+    // int materialIndex - the material used by a draw
+    const char* g_MaterialBlockName = "MaterialBlock";
+    const char* g_MaterialIndexName = "materialIndex";
+    const GLuint g_MaterialBlockBinding = 0;
+    // struct Material material - the values of the draw's material, set per
+    // draw when the shader has no MaterialBlock
+    const char* g_MaterialDiffuseName = "material.diffuseColor";
+    const char* g_MaterialSpecularName = "material.specularColor";
+    const char* g_MaterialShininessName = "material.shininess";
+    // 256 materials of 32 bytes stay well inside the 16 KB minimum block size
+    const size_t g_MaxMaterials = 256;
+
+    // one material in the std140 layout: each vec3 is padded to 16 bytes,
+    // and the float that follows it fills the padding
+    struct GPU_MATERIAL
+    {
+        float diffuseColor[3];
+        float shininess;
+        float specularColor[3];
+        float padding;
+    };
+    static_assert(sizeof(GPU_MATERIAL) == 32, "GPU_MATERIAL must match the std140 layout");
+
+    // texture arrays are bound to units 0..N-1, so N is limited by the
+    // minimum GL_MAX_TEXTURE_IMAGE_UNITS guaranteed by OpenGL
+    const size_t g_MaxTextureArrays = 16;
+
+    // layout of the 64-bit draw sort key, most significant field first:
+    //   opaque:      0 | program:7 | mesh:8 | texture:16 | material:16 | index:16
+    //   translucent: 1 | unused:15 | far-to-near depth:32 | index:16
+    // the low 16 bits index the draw command, so sorting the keys alone is enough
+    const uint64_t g_DrawKeyTranslucentBit = 1ull << 63;
+    const int g_DrawKeyProgramShift = 56;
+    const int g_DrawKeyMeshShift = 48;
+    const int g_DrawKeyTextureShift = 32;
+    const int g_DrawKeyMaterialShift = 16;
+    const int g_DrawKeyDepthShift = 16;
+    const uint64_t g_DrawKeyIndexMask = 0xFFFF;
+    const uint64_t g_DrawKeyTextureMask = 0xFFFF;
+    const uint64_t g_DrawKeyMeshMask = 0xFF;
+
+    // most instances drawn by one instanced call
+    const size_t g_MaxInstancesPerDraw = 1024;
+
+    // slices around the round shapes at each tessellation level; full
+    // detail stays at the single tessellation's 36 slices, and each count -
+    // and half of it, the sphere and torus tube stacks - is a multiple of
+    // the next, so the vertices of a coarser level all lie on every finer
+    // one and it stays inside them; the occluders, drawn at the coarsest
+    // level, depend on that
+    const int g_LodSlices[SceneManager::SHAPE_LOD_COUNT] = { 36, 18, 6 };
+    // fraction of the view height a draw's bounding sphere must cover to
+    // use a level rather than the next coarser one
+    const float g_LodScreenSizes[SceneManager::SHAPE_LOD_COUNT - 1] = { 0.2f, 0.03f };
+
+    // dimensions of the ShapeMeshes shapes that the pool rebuilds; they are
+    // not read from ShapeMeshes, so they must be kept in step with it by hand
+    const float g_CylinderRadius = 1.0f;
+    const float g_TaperedTopRadius = 0.5f;
+    const float g_TorusMainRadius = 1.0f;
+    const float g_TorusTubeRadius = 0.2f;
+    // how far past a switching size a draw must be before its level
+    // changes, so a draw sitting at that size does not flicker
+    const float g_LodHysteresis = 0.15f;
+
+    /***********************************************************
+     *  RadixSort64()
+     *
+     *  Sorts 64-bit keys with a least significant digit radix
+     *  sort, one byte per pass. A pass where every key has the
+     *  same byte would not move anything and is skipped, so
+     *  keys that only differ in a few fields sort in a few
+     *  passes. The sorted keys end up back in keys.
+     ***********************************************************/
+    void RadixSort64(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch)
+    {
+        scratch.resize(keys.size());
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            size_t counts[256] = {};
+            for (uint64_t key : keys)
+            {
+                counts[(key >> shift) & 0xFF]++;
+            }
+            if (keys.empty() || counts[(keys[0] >> shift) & 0xFF] == keys.size())
+            {
+                continue;
+            }
+
+            size_t offset = 0;
+            for (int digit = 0; digit < 256; digit++)
+            {
+                size_t count = counts[digit];
+                counts[digit] = offset;
+                offset += count;
+            }
+            for (uint64_t key : keys)
+            {
+                scratch[counts[(key >> shift) & 0xFF]++] = key;
+            }
+            keys.swap(scratch);
+        }
+    }
+
+    // staging ring for streamed uploads, and the most it may upload per frame
+    // so a burst of finished decodes cannot stall a single frame
+    const size_t g_UploadRingBytes = 32 * 1024 * 1024;
+    const size_t g_MaxUploadBytesPerFrame = 16 * 1024 * 1024;
+
+    // GPU memory the resident textures may use before the least
+    // recently used ones are evicted, see SetTextureBudget()
+    const size_t g_DefaultTextureBudgetBytes = 256 * 1024 * 1024;
+
+    // largest mip level uploaded up front when textures stream progressively
+    const int g_MipTailSize = 32;
+
+    // block compression preferred when cooking the scene textures; the
+    // cache starts without any until the context's formats are known
+    const TEXTURE_COMPRESSION g_TextureCompression = TEXTURE_COMPRESSION_BC1_BC7;
+    const char* const g_CookedFormatNames[] = { "RGB(A)8", "BC1", "BC3", "BC7" };
+    const char* const g_CompressionNames[] = { "none", "BC1 and BC3", "BC1 and BC7" };
+
+    // true if the current context lists the extension
+    bool HasExtension(const char* name)
+    {
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; i++)
+        {
+            const char* pExtension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (pExtension != NULL && std::strcmp(pExtension, name) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // uploads one mip level of one array layer, or of a single texture when
+    // the target is GL_TEXTURE_2D, from client memory or from an offset into
+    // the bound unpack buffer
+    void UploadTextureLevel(GLenum target, const SceneManager::TEXTURE_ARRAY& textureArray, int layer, int level,
+        const COOKED_TEXTURE::MIP_LEVEL& mipLevel, const void* pPixels)
+    {
+        if (target == GL_TEXTURE_2D && textureArray.cookedFormat == COOKED_FORMAT_RAW)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mipLevel.width, mipLevel.height,
+                textureArray.pixelFormat, GL_UNSIGNED_BYTE, pPixels);
+        }
+        else if (target == GL_TEXTURE_2D)
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mipLevel.width, mipLevel.height,
+                textureArray.internalFormat, static_cast<GLsizei>(mipLevel.size), pPixels);
+        }
+        else if (textureArray.cookedFormat == COOKED_FORMAT_RAW)
+        {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                mipLevel.width, mipLevel.height, 1,
+                textureArray.pixelFormat, GL_UNSIGNED_BYTE, pPixels);
+        }
+        else
+        {
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                mipLevel.width, mipLevel.height, 1,
+                textureArray.internalFormat, static_cast<GLsizei>(mipLevel.size), pPixels);
+        }
+    }
+
+    // bytes of GPU memory used by one layer of a texture array
+    size_t GetLayerBytes(const SceneManager::TEXTURE_ARRAY& textureArray, bool bUncompressed)
+    {
+        size_t byteCount = 0;
+        for (int level = 0; level < textureArray.levelCount; level++)
+        {
+            int levelWidth = std::max(1, textureArray.width >> level);
+            int levelHeight = std::max(1, textureArray.height >> level);
+
+            if (bUncompressed || textureArray.cookedFormat == COOKED_FORMAT_RAW)
+            {
+                size_t bytesPerPixel = (textureArray.pixelFormat == GL_RGBA) ? 4 : 3;
+                byteCount += static_cast<size_t>(levelWidth) * levelHeight * bytesPerPixel;
+            }
+            else
+            {
+                size_t blockBytes = (textureArray.cookedFormat == COOKED_FORMAT_BC1) ? 8 : 16;
+                byteCount += static_cast<size_t>((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes;
+            }
+        }
+        return byteCount;
+    }
+
+    // 64-bit hash of the size, format and every mip level of a texture,
+    // eight bytes at a time (FNV-1a style mixing on whole words)
+    uint64_t HashTextureContent(const COOKED_TEXTURE& texture)
+    {
+        const uint64_t prime = 1099511628211ULL;
+        uint64_t hash = 14695981039346656037ULL;
+
+        hash = (hash ^ static_cast<uint64_t>(texture.width)) * prime;
+        hash = (hash ^ static_cast<uint64_t>(texture.height)) * prime;
+        hash = (hash ^ static_cast<uint64_t>(texture.colorChannels)) * prime;
+        hash = (hash ^ static_cast<uint64_t>(texture.format)) * prime;
+
+        for (size_t level = 0; level < texture.levels.size(); level++)
+        {
+            const unsigned char* pData = texture.GetLevelData(level);
+            size_t size = texture.levels[level].size;
+
+            size_t offset = 0;
+            for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+            {
+                uint64_t word;
+                std::memcpy(&word, pData + offset, sizeof(word));
+                hash = (hash ^ word) * prime;
+                hash ^= hash >> 32;
+            }
+            for (; offset < size; offset++)
+            {
+                hash = (hash ^ pData[offset]) * prime;
+            }
+        }
+
+        return hash;
+    }
+
+    // textures with the same size, format and bytes in every mip level
+    bool IsSameTextureContent(const COOKED_TEXTURE& a, const COOKED_TEXTURE& b)
+    {
+        if (a.width != b.width || a.height != b.height || a.colorChannels != b.colorChannels ||
+            a.format != b.format || a.levels.size() != b.levels.size())
+        {
+            return false;
+        }
+
+        for (size_t level = 0; level < a.levels.size(); level++)
+        {
+            if (a.levels[level].size != b.levels[level].size ||
+                std::memcmp(a.GetLevelData(level), b.GetLevelData(level), a.levels[level].size) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // materials that would set exactly the same shader values
+    bool IsSameMaterial(const SceneManager::OBJECT_MATERIAL& a, const SceneManager::OBJECT_MATERIAL& b)
+    {
+        return a.diffuseColor == b.diffuseColor &&
+            a.specularColor == b.specularColor &&
+            a.shininess == b.shininess;
+    }
+
+    // bytes the mip levels firstLevel..endLevel-1 occupy in the upload ring
+    size_t GetUploadSize(const COOKED_TEXTURE& texture, int firstLevel, int endLevel)
+    {
+        size_t byteCount = 0;
+        for (int level = firstLevel; level < endLevel; level++)
+        {
+            byteCount += (texture.levels[level].size + 15) & ~static_cast<size_t>(15);
+        }
+        return byteCount;
+    }
+
+    // first level of the mip tail - the levels no larger than g_MipTailSize,
+    // uploaded together so a texture is drawable after a few KB
+    int GetMipTailLevel(const COOKED_TEXTURE& texture)
+    {
+        int level = 0;
+        while (level + 1 < static_cast<int>(texture.levels.size()) &&
+            (texture.levels[level].width > g_MipTailSize || texture.levels[level].height > g_MipTailSize))
+        {
+            level++;
+        }
+        return level;
+    }
 }
 
 /***********************************************************
@@ -45,13 +340,90 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
     // create the shape meshes object
     m_basicMeshes = new ShapeMeshes();
 
-    // initialize the texture collection
-    for (int i = 0; i < 16; i++)
+    // create the worker threads used for decoding images
+    m_pThreadPool = new ThreadPool();
+
+    // uniform handles are resolved in PrepareScene(), once the shaders are loaded
+    m_pUniformCache = new UniformCache();
+    m_uniformUploads.sentUploads = 0;
+    m_uniformUploads.elidedUploads = 0;
+    m_reportedUniformUploads.sentUploads = -1;
+    m_reportedUniformUploads.elidedUploads = -1;
+
+    // texture and material tags are interned into integer IDs
+    m_pTagTable = new TagTable();
+
+    // image files are memory-mapped instead of read through stdio
+    m_pTextureSource = new FileTextureSource();
+
+    // cooked textures are kept next to the source images
+    m_pTextureCache = new TextureCache("textures/cache", TEXTURE_COMPRESSION_NONE);
+
+    // the upload ring is mapped once textures are first loaded
+    m_pUploadRing = new TextureUploadRing();
+
+    // the texture collection starts empty and grows as textures are loaded
+    m_loadedTextures = 0;
+    m_frameIndex = 0;
+    m_textureBudgetBytes = g_DefaultTextureBudgetBytes;
+    m_residentTextureBytes = 0;
+    m_evictedTextures = 0;
+    m_sharedTextures = 0;
+    m_textureLoadStats.bReported = true;
+    m_textureLoadStats.bDrawableReported = true;
+    m_bProgressiveTextures = true;
+    m_bLazyTextures = false;
+    m_bSerialTextureBenchmark = false;
+    m_placeholderArray = -1;
+    m_bTextureArrays = false;
+
+    // the material buffer is created once the materials are defined
+    m_materialBufferID = 0;
+    m_bMaterialBlock = false;
+
+    // the nodes are created in PrepareScene()
+    m_pSceneGraph = new SceneGraph();
+    m_viewPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_pMeshPool = new MeshPool();
+    for (int i = 0; i < SHAPE_MESH_COUNT; i++)
     {
-        m_textureIDs[i].tag = "/0";
-        m_textureIDs[i].ID = -1;
+        m_shapeLodCounts[i] = 1;
+        for (int lod = 0; lod < SHAPE_LOD_COUNT; lod++)
+        {
+            m_poolMeshes[i][lod] = -1;
+            m_shapeTriangles[i][lod] = 0;
+        }
+        m_shapeBounds[i].minimum = glm::vec3(-1.0f, -1.0f, -1.0f);
+        m_shapeBounds[i].maximum = glm::vec3(1.0f, 1.0f, 1.0f);
     }
-    m_loadedTextures = 0;
+    m_pDrawHierarchy = new BoundingVolumeHierarchy();
+    m_drawHierarchyBuiltCost = 0.0f;
+    m_pOcclusionBuffer = new OcclusionBuffer();
+    m_bOcclusionCulling = false;
+    // nothing is culled until the first view-projection is set
+    m_viewProjection = glm::mat4(1.0f);
+    m_bViewProjection = false;
+    m_cullingStats.visibleDraws = 0;
+    m_cullingStats.culledDraws = 0;
+    m_cullingStats.occludedDraws = 0;
+    m_reportedCullingStats.visibleDraws = -1;
+    m_reportedCullingStats.culledDraws = -1;
+    m_reportedCullingStats.occludedDraws = -1;
+    m_lodStats.trianglesDrawn = 0;
+    m_lodStats.fullDetailTriangles = 0;
+    for (int lod = 0; lod < SHAPE_LOD_COUNT; lod++)
+    {
+        m_lodStats.levelDraws[lod] = 0;
+    }
+    m_reportedLodStats = m_lodStats;
+    m_reportedLodStats.trianglesDrawn = -1;
+    m_recordedOrderStats.textureSwitches = 0;
+    m_recordedOrderStats.meshSwitches = 0;
+    m_recordedOrderStats.drawCalls = 0;
+    m_sortedOrderStats = m_recordedOrderStats;
+    m_reportedOrderStats.textureSwitches = -1;
+    m_reportedOrderStats.meshSwitches = -1;
+    m_reportedOrderStats.drawCalls = -1;
 }
 
 /***********************************************************
@@ -70,8 +442,75 @@ SceneManager::~SceneManager()
         m_basicMeshes = NULL;
     }
 
+    if (m_pThreadPool != NULL)
+    {
+        delete m_pThreadPool;
+        m_pThreadPool = NULL;
+    }
+
+    if (m_pTextureCache != NULL)
+    {
+        delete m_pTextureCache;
+        m_pTextureCache = NULL;
+    }
+
+    if (m_pTextureSource != NULL)
+    {
+        delete m_pTextureSource;
+        m_pTextureSource = NULL;
+    }
+
+    // waits for any upload still reading from the ring
+    if (m_pUploadRing != NULL)
+    {
+        delete m_pUploadRing;
+        m_pUploadRing = NULL;
+    }
+
     // free the allocated OpenGL textures
     DestroyGLTextures();
+
+    if (m_materialBufferID != 0)
+    {
+        glDeleteBuffers(1, &m_materialBufferID);
+        m_materialBufferID = 0;
+    }
+
+    if (m_pTagTable != NULL)
+    {
+        delete m_pTagTable;
+        m_pTagTable = NULL;
+    }
+
+    if (m_pUniformCache != NULL)
+    {
+        delete m_pUniformCache;
+        m_pUniformCache = NULL;
+    }
+
+    if (m_pSceneGraph != NULL)
+    {
+        delete m_pSceneGraph;
+        m_pSceneGraph = NULL;
+    }
+
+    if (m_pMeshPool != NULL)
+    {
+        delete m_pMeshPool;
+        m_pMeshPool = NULL;
+    }
+
+    if (m_pDrawHierarchy != NULL)
+    {
+        delete m_pDrawHierarchy;
+        m_pDrawHierarchy = NULL;
+    }
+
+    if (m_pOcclusionBuffer != NULL)
+    {
+        delete m_pOcclusionBuffer;
+        m_pOcclusionBuffer = NULL;
+    }
 }
 
 /***********************************************************
@@ -80,836 +519,3228 @@ SceneManager::~SceneManager()
  *  This method is used for loading textures from image files,
  *  configuring the texture mapping parameters in OpenGL,
  *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  a layer of the texture array matching its size, growing
+ *  the array when it is already full. In lazy mode only the
+ *  image header is read and the tag is registered; the first
+ *  SetShaderTexture() with the tag loads it.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::CreateGLTexture(const char* filename, std::string_view tag)
 {
-    int  width = 0;
-    int  height = 0;
-    int  colorChannels = 0;
-    GLuint textureID = 0;
+    DECODED_IMAGE image;
 
     // indicate to always flip images vertically when loaded
     stbi_set_flip_vertically_on_load(true);
 
-    // try to parse the image data from the specified image file
-    unsigned char* image = stbi_load(
-        filename,
-        &width,
-        &height,
-        &colorChannels,
-        0);
+    CreatePlaceholderTexture();
 
-    // if the image was successfully read from the image file
-    if (image)
+    if (m_bLazyTextures)
     {
-        std::cout << "Successfully loaded image:" << filename
-            << ", width:" << width
-            << ", height:" << height
-            << ", channels:" << colorChannels << std::endl;
-
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // if the loaded image is in RGB format
-        if (colorChannels == 3)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height,
-                0, GL_RGB, GL_UNSIGNED_BYTE, image);
-        }
-        // if the loaded image is in RGBA format - it supports transparency
-        else if (colorChannels == 4)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height,
-                0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-        }
-        else
+        int width = 0;
+        int height = 0;
+        int colorChannels = 0;
+        if (!ReadImageInfo(filename, width, height, colorChannels))
         {
-            std::cout << "Not implemented to handle image with "
-                << colorChannels << " channels" << std::endl;
-            stbi_image_free(image);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            std::cout << "Could not load image:" << filename << std::endl;
             return false;
         }
 
-        // generate the texture mipmaps for mapping textures to lower resolutions
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // free the image data from local memory
-        stbi_image_free(image);
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-        // register the loaded texture and associate it with the special tag string
-        m_textureIDs[m_loadedTextures].ID = textureID;
-        m_textureIDs[m_loadedTextures].tag = tag;
-  
-
-       
+        return RegisterTexture(filename, tag, width, height, colorChannels) >= 0;
+    }
 
-		// Cs-499 Enhancement: maintain fast lookup tables for textures
-		int slotIndex = m_loadedTextures;   // slot we just used 
-        m_textureIdLookup[tag] = textureID;     //tag -> GL texture ID
-		m_textureSlotLookup[tag] = slotIndex;      //tag -> texture slot
+    // try to parse the image data from the specified image file
+    if (!DecodeImage(filename, image))
+    {
+        std::cout << "Could not load image:" << filename << std::endl;
+        return false;
+    }
 
-        // Now that everything is registered, advance the count 
-		m_loadedTextures++;
+    int textureSlot = RegisterTexture(filename, tag, image.texture.width, image.texture.height, image.texture.colorChannels);
+    if (textureSlot < 0)
+    {
+        return false;
+    }
 
-        return true;
+    // a synchronous load still has to stay within the texture budget
+    if (!m_textureIDs[textureSlot].bResident && m_textureIDs[textureSlot].layer < 0)
+    {
+        if (!MakeTextureRoom(m_textureIDs[textureSlot].byteCount))
+        {
+            std::cout << "Texture budget exhausted, could not load image:" << filename << std::endl;
+            return false;
+        }
+        AcquireTextureLayer(textureSlot);
+    }
+    AllocateTextureArrays();
 
+    int levelCount = static_cast<int>(image.texture.levels.size());
+    if (!m_bProgressiveTextures || m_textureIDs[textureSlot].bLoading)
+    {
+        return UploadGLTexture(image, m_textureIDs[textureSlot].tagID, 0, levelCount);
+    }
 
+    // upload the mip tail now so the texture can be drawn right away;
+    // PumpTextureUploads() streams in the finer levels on later frames
+    int tailLevel = GetMipTailLevel(image.texture);
+    if (!UploadGLTexture(image, m_textureIDs[textureSlot].tagID, tailLevel, levelCount))
+    {
+        return false;
     }
 
-    std::cout << "Could not load image:" << filename << std::endl;
+    if (tailLevel > 0 && !image.texture.levels.empty())
+    {
+        m_textureIDs[textureSlot].bLoading = true;
+
+        PENDING_TEXTURE pendingTexture;
+        pendingTexture.tagID = m_textureIDs[textureSlot].tagID;
+        pendingTexture.bDecoded = true;
+        pendingTexture.nextLevel = tailLevel;
+        pendingTexture.image = std::move(image);
+        m_pendingTextures.push_back(std::move(pendingTexture));
+    }
 
-    // Error loading the image
-    return false;
+    return true;
 }
 
 /***********************************************************
- *  BindGLTextures()
+ *  ReadImageInfo()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for reading the size and channel
+ *  count from an image header through the texture source,
+ *  without decoding the pixels or reading the rest of the
+ *  file ahead.
  ***********************************************************/
-void SceneManager::BindGLTextures()
+bool SceneManager::ReadImageInfo(const char* filename, int& width, int& height, int& colorChannels) const
 {
-    for (int i = 0; i < m_loadedTextures; i++)
+    ENCODED_IMAGE encodedImage;
+    if (m_pTextureSource == NULL || !m_pTextureSource->ReadHeader(filename, encodedImage))
     {
-        // bind textures on corresponding texture units
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+        return false;
     }
+
+    return stbi_info_from_memory(encodedImage.pData, static_cast<int>(encodedImage.size),
+        &width, &height, &colorChannels) != 0;
 }
 
 /***********************************************************
- *  DestroyGLTextures()
+ *  DecodeImage()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for reading an image and its mip
+ *  chain into memory. A valid cache entry is memory-mapped
+ *  as-is; otherwise the image is read through the texture
+ *  source, decoded from memory and cooked into the cache
+ *  for the next launch. It does not touch
+ *  OpenGL, so it can run on the worker threads. The vertical
+ *  flip flag is global in stb_image and must be set before
+ *  any worker starts.
  ***********************************************************/
-void SceneManager::DestroyGLTextures()
+bool SceneManager::DecodeImage(const char* filename, DECODED_IMAGE& image) const
 {
-    for (int i = 0; i < m_loadedTextures; i++)
+    auto startTime = std::chrono::steady_clock::now();
+    bool bLoaded = false;
+
+    image.filename = filename;
+
+    if (m_pTextureCache != NULL)
+    {
+        bLoaded = m_pTextureCache->Load(filename, image.texture);
+    }
+
+    if (!bLoaded)
     {
-        if (m_textureIDs[i].ID != static_cast<GLuint>(-1))
+        // decode straight from the mapped file, which is unmapped again
+        // as soon as the cooked texture exists
+        ENCODED_IMAGE encodedImage;
+        if (m_pTextureSource != NULL && m_pTextureSource->Read(filename, encodedImage))
         {
-            glDeleteTextures(1, &m_textureIDs[i].ID); // CS-499 fix: delete, not generate
-            m_textureIDs[i].ID = static_cast<GLuint>(-1);
+            int width = 0;
+            int height = 0;
+            int colorChannels = 0;
+            unsigned char* pixels = stbi_load_from_memory(
+                encodedImage.pData,
+                static_cast<int>(encodedImage.size),
+                &width,
+                &height,
+                &colorChannels,
+                0);
+
+            if (pixels != NULL)
+            {
+                if (m_pTextureCache != NULL)
+                {
+                    bLoaded = m_pTextureCache->Cook(filename, pixels, width, height, colorChannels, image.texture);
+                }
+                stbi_image_free(pixels);
+            }
         }
     }
-    m_loadedTextures = 0;
+
+    // fingerprint the pixels here, on the worker, so the GL thread can
+    // spot an image that is already loaded under another tag
+    image.contentHash = 0;
+    if (bLoaded)
+    {
+        image.contentHash = HashTextureContent(image.texture);
+    }
+
+    image.decodeMilliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+
+    return bLoaded;
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  MeasureSerialTextureLoad()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for timing the texture load as it
+ *  was before the thread pool: every scene image decoded
+ *  with stbi_load() on this thread, uploaded to its own
+ *  texture and mipmapped by the driver, back to back. The
+ *  textures are deleted again. It runs after the pooled
+ *  load, so its files are already in the page cache, which
+ *  only makes the serial path look faster.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag) {
-
-	// CS-499 Enhancement: 0(1) average lookup using an unordered_map
-    auto it = m_textureIdLookup.find(tag);
-    if (it != m_textureIdLookup.end()) {
-        return static_cast<int>(it->second);
-
-    }
-	// Fallback to legacy method if not found in cache
-    int textureID = -1;
-    int index = 0;
-    bool bFound = false;
+double SceneManager::MeasureSerialTextureLoad()
+{
+    GLint boundTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
 
-    while ((index < m_loadedTextures) && (bFound == false)) {
-        if (m_textureIDs[index].tag.compare(tag) == 0) {
-            textureID = m_textureIDs[index].ID;
-            bFound = true;
+    auto startTime = std::chrono::steady_clock::now();
+    for (const TEXTURE_INFO& textureInfo : m_textureIDs)
+    {
+        if (textureInfo.bLoadFailed)
+            continue;
 
-        }
-        else {
-            index++;
+        int width = 0;
+        int height = 0;
+        int colorChannels = 0;
+        unsigned char* pixels = stbi_load(textureInfo.filename.c_str(), &width, &height, &colorChannels, 0);
+        if (pixels == NULL)
+            continue;
 
+        if (colorChannels == 3 || colorChannels == 4)
+        {
+            GLuint textureID = 0;
+            glGenTextures(1, &textureID);
+            glBindTexture(GL_TEXTURE_2D, textureID);
+            glTexImage2D(GL_TEXTURE_2D, 0, (colorChannels == 4) ? GL_RGBA8 : GL_RGB8, width, height,
+                0, (colorChannels == 4) ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, pixels);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            // wait for the upload, as the old path's first frame did
+            glFinish();
+            glDeleteTextures(1, &textureID);
         }
+        stbi_image_free(pixels);
     }
-    return textureID;
+    double serialMilliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
 
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(boundTexture));
+    return serialMilliseconds;
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  RegisterTexture()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for registering a texture tag with
+ *  its image file and picking the texture array for its
+ *  size and format. A new array is started for each new
+ *  size. The texture only gets a layer in the array while
+ *  it is resident, see AcquireTextureLayer(). Returns the
+ *  texture slot, or -1 on failure.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag) {
-	// CS-499 Enhancement: 0(1) average lookup using an unordered_map
+int SceneManager::RegisterTexture(const char* filename, std::string_view tag, int width, int height, int colorChannels)
+{
+    GLenum internalFormat = GL_RGB8;
+    GLenum pixelFormat = GL_RGB;
 
-    auto it = m_textureSlotLookup.find(tag);
-    if (it != m_textureSlotLookup.end()) {
-        return it->second;
+    // if the image is in RGB format
+    if (colorChannels == 3)
+    {
+        internalFormat = GL_RGB8;
+        pixelFormat = GL_RGB;
+    }
+    // if the image is in RGBA format - it supports transparency
+    else if (colorChannels == 4)
+    {
+        internalFormat = GL_RGBA8;
+        pixelFormat = GL_RGBA;
+    }
+    else
+    {
+        std::cout << "Not implemented to handle image with "
+            << colorChannels << " channels" << std::endl;
+        return -1;
+    }
 
+    // the cache decides from the size alone whether the image is stored
+    // block-compressed, so the storage can be created before decoding
+    COOKED_FORMAT cookedFormat = COOKED_FORMAT_RAW;
+    if (m_pTextureCache != NULL)
+    {
+        cookedFormat = m_pTextureCache->GetCookedFormat(width, height, colorChannels);
+    }
+    switch (cookedFormat)
+    {
+    case COOKED_FORMAT_BC1:
+        internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        break;
+    case COOKED_FORMAT_BC3:
+        internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        break;
+    case COOKED_FORMAT_BC7:
+        internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+        break;
+    default:
+        break;
     }
 
-	// Fallback to legacy linear search if not found in cache
+    // a tag that is already registered keeps its layer
+    uint32_t tagID = m_pTagTable->Intern(tag);
+    int textureSlot = FindTextureSlot(tagID);
+    if (textureSlot >= 0)
+    {
+        const TEXTURE_ARRAY& textureArray = m_textureArrays[m_textureIDs[textureSlot].arrayIndex];
+        if (textureArray.width == width && textureArray.height == height &&
+            textureArray.internalFormat == internalFormat)
+        {
+            return textureSlot;
+        }
 
-    int textureSlot = -1;
-    int index = 0;
-    bool bFound = false;
+        std::cout << "Texture tag " << tag << " is already used by an image of a different size" << std::endl;
+        return -1;
+    }
 
-    while ((index < m_loadedTextures) && (bFound == false)) {
-        if (m_textureIDs[index].tag.compare(tag) == 0) {
-            textureSlot = index;
-            bFound = true;
+    // find the texture array for this size and format; without texture
+    // arrays every texture gets its own
+    int arrayIndex = -1;
+    for (size_t i = 0; m_bTextureArrays && i < m_textureArrays.size(); i++)
+    {
+        if (m_textureArrays[i].width == width && m_textureArrays[i].height == height &&
+            m_textureArrays[i].internalFormat == internalFormat)
+        {
+            arrayIndex = static_cast<int>(i);
+            break;
+        }
+    }
 
+    if (arrayIndex < 0)
+    {
+        // every texture array is bound to its own texture unit
+        if (m_textureArrays.size() >= g_MaxTextureArrays)
+        {
+            std::cout << "No free texture unit for a " << width << "x" << height << " texture array" << std::endl;
+            return -1;
         }
-        else {
-            index++;
 
+        TEXTURE_ARRAY textureArray;
+        textureArray.ID = 0;
+        textureArray.width = width;
+        textureArray.height = height;
+        textureArray.levelCount = 1;
+        while ((width >> textureArray.levelCount) > 0 || (height >> textureArray.levelCount) > 0)
+        {
+            textureArray.levelCount++;
         }
+        textureArray.internalFormat = internalFormat;
+        textureArray.pixelFormat = pixelFormat;
+        textureArray.cookedFormat = cookedFormat;
+        textureArray.layerCount = 0;
+        textureArray.layerCapacity = 0;
+        textureArray.freeLayers.clear();
+        textureArray.baseLevel = 0;
+
+        arrayIndex = static_cast<int>(m_textureArrays.size());
+        m_textureArrays.push_back(textureArray);
     }
-    return textureSlot;
 
+    // register the texture and associate it with the special tag string
+    TEXTURE_INFO textureInfo;
+    textureInfo.tag = tag;
+    textureInfo.tagID = tagID;
+    textureInfo.filename = filename;
+    textureInfo.ID = m_textureArrays[arrayIndex].ID;
+    textureInfo.arrayIndex = arrayIndex;
+    textureInfo.layer = -1;
+    textureInfo.byteCount = GetLayerBytes(m_textureArrays[arrayIndex], false);
+    textureInfo.lastUsedFrame = m_frameIndex;
+    textureInfo.bResident = false;
+    textureInfo.bLoading = false;
+    textureInfo.bLoadFailed = false;
+    textureInfo.bTranslucent = false;
+    textureInfo.sharedSlot = -1;
+    textureInfo.baseLevel = m_textureArrays[arrayIndex].levelCount;
+
+    textureSlot = static_cast<int>(m_textureIDs.size());
+    m_textureIDs.push_back(textureInfo);
+
+    // Cs-499 Enhancement: maintain fast lookup table for textures
+    if (m_textureSlotByTag.size() <= tagID)
+    {
+        m_textureSlotByTag.resize(tagID + 1, -1);
+    }
+    m_textureSlotByTag[tagID] = textureSlot;      //tag ID -> texture slot
+
+    return textureSlot;
 }
 
+
 /***********************************************************
- *  FindMaterial()
+ *  AcquireTextureLayer()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for giving a texture a layer in its
+ *  texture array, reusing a layer released by an evicted
+ *  texture before adding a new one. New layers only exist
+ *  on the GPU after the next AllocateTextureArrays().
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material) {
+void SceneManager::AcquireTextureLayer(int textureSlot)
+{
+    TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+    if (textureInfo.layer >= 0)
+    {
+        return;
+    }
 
-	// CS-499 Enhancement: 0(1) average lookup using a hash map
-    auto it = m_materialLookup.find(tag);
-    if (it != m_materialLookup.end()) {
-        material = it->second;
-        return true;
-	}
+    TEXTURE_ARRAY& textureArray = m_textureArrays[textureInfo.arrayIndex];
+    if (!textureArray.freeLayers.empty())
+    {
+        textureInfo.layer = textureArray.freeLayers.back();
+        textureArray.freeLayers.pop_back();
+    }
+    else
+    {
+        textureInfo.layer = textureArray.layerCount++;
+    }
 
-	// Fallback to legacy linear search if map is not populated
-    if (m_objectMaterials.empty()) {
-        return false;
+    // the budget counts a texture from the moment it holds a layer
+    m_residentTextureBytes += textureInfo.byteCount;
+}
+
+/***********************************************************
+ *  EvictTexture()
+ *
+ *  This method is used for dropping a texture from GPU
+ *  memory. Its layer goes back to the array for the next
+ *  texture of the same size; the texture is reloaded in the
+ *  background the next time it is drawn.
+ ***********************************************************/
+void SceneManager::EvictTexture(int textureSlot)
+{
+    TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
 
+    if (textureInfo.layer >= 0)
+    {
+        m_textureArrays[textureInfo.arrayIndex].freeLayers.push_back(textureInfo.layer);
+        textureInfo.layer = -1;
+        m_residentTextureBytes -= textureInfo.byteCount;
     }
-    int index = 0;
-    bool bFound = false;
-    while ((index < static_cast<int>(m_objectMaterials.size())) && (bFound == false)) {
-        if (m_objectMaterials[index].tag.compare(tag) == 0) {
-            bFound = true;
-            material = m_objectMaterials[index];
 
-        }
-        else {
-            index++;
+    if (textureInfo.bResident)
+    {
+        textureInfo.bResident = false;
+        m_loadedTextures--;
+    }
 
-        }
+    // the rest of the array no longer waits for this layer's finer levels
+    textureInfo.baseLevel = m_textureArrays[textureInfo.arrayIndex].levelCount;
+    UpdateArrayBaseLevel(textureInfo.arrayIndex);
+
+    // its draws show the opaque placeholder until it is loaded again
+    if (textureInfo.bTranslucent)
+    {
+        UpdateDrawTranslucency();
     }
-    return bFound;
 }
+
+/***********************************************************
+ *  ShareTexture()
+ *
+ *  This method is used for pointing a tag at another texture
+ *  with the same pixels. The duplicate gives its layer back
+ *  and is never loaded again; lookups of its tag return the
+ *  shared texture, which is touched and evicted as one.
+ ***********************************************************/
+void SceneManager::ShareTexture(int textureSlot, int sharedSlot)
+{
+    TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+
+    EvictTexture(textureSlot);
+    textureInfo.sharedSlot = sharedSlot;
+
+    m_textureSlotByTag[textureInfo.tagID] = sharedSlot;
+    UpdateDrawTranslucency();
+
+    m_sharedTextures++;
+}
+
+/***********************************************************
+ *  MakeTextureRoom()
+ *
+ *  This method is used for evicting least recently used
+ *  textures until the passed in number of bytes fits in the
+ *  texture budget. Textures drawn in this frame or the one
+ *  before are never evicted, so the visible set does not
+ *  thrash, and neither are textures still streaming in.
+ *  Returns false if the room cannot be made.
+ ***********************************************************/
+bool SceneManager::MakeTextureRoom(size_t byteCount)
+{
+    while (m_residentTextureBytes + byteCount > m_textureBudgetBytes)
+    {
+        // a linear scan is fine - eviction is rare and texture counts are small
+        int victimSlot = -1;
+        for (size_t i = 0; i < m_textureIDs.size(); i++)
+        {
+            const TEXTURE_INFO& textureInfo = m_textureIDs[i];
+            if (!textureInfo.bResident || textureInfo.bLoading || textureInfo.lastUsedFrame + 1 >= m_frameIndex)
+            {
+                continue;
+            }
+
+            if (victimSlot < 0 || textureInfo.lastUsedFrame < m_textureIDs[victimSlot].lastUsedFrame)
+            {
+                victimSlot = static_cast<int>(i);
+            }
+        }
+
+        if (victimSlot < 0)
+        {
+            return false;
+        }
+
+        std::cout << "Evicted texture:" << m_textureIDs[victimSlot].tag
+            << ", last used in frame:" << m_textureIDs[victimSlot].lastUsedFrame << std::endl;
+        EvictTexture(victimSlot);
+        m_evictedTextures++;
+    }
+
+    return true;
+}
+
+/***********************************************************
+ *  RequestTexture()
+ *
+ *  This method is used for starting a background load of a
+ *  registered texture that is not resident. Room is made in
+ *  the budget and a layer is taken up front, so a finished
+ *  decode can always be uploaded. Returns false if the load
+ *  could not be started.
+ ***********************************************************/
+bool SceneManager::RequestTexture(int textureSlot)
+{
+    TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+    if (textureInfo.bResident || textureInfo.bLoading || textureInfo.bLoadFailed ||
+        textureInfo.sharedSlot >= 0 || m_pThreadPool == NULL)
+    {
+        return false;
+    }
+
+    if (!MakeTextureRoom(textureInfo.byteCount))
+    {
+        return false;
+    }
+    AcquireTextureLayer(textureSlot);
+    textureInfo.bLoading = true;
+
+    std::string filename = textureInfo.filename;
+
+    PENDING_TEXTURE pendingTexture;
+    pendingTexture.tagID = textureInfo.tagID;
+    pendingTexture.bDecoded = false;
+    pendingTexture.nextLevel = 0;
+    pendingTexture.decodeResult = m_pThreadPool->Submit([this, filename]()
+    {
+        DECODED_IMAGE image;
+        DecodeImage(filename.c_str(), image);
+        return image;
+    });
+    m_pendingTextures.push_back(std::move(pendingTexture));
+
+    return true;
+}
+
+/***********************************************************
+ *  TouchTexture()
+ *
+ *  This method is used for recording that a texture is drawn
+ *  in the current frame, and for requesting it if it was
+ *  evicted or never loaded. It never blocks; the texture is
+ *  drawn with the placeholder until it has been uploaded.
+ ***********************************************************/
+void SceneManager::TouchTexture(int textureSlot)
+{
+    TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+    textureInfo.lastUsedFrame = m_frameIndex;
+
+    if (!textureInfo.bResident && !textureInfo.bLoading)
+    {
+        RequestTexture(textureSlot);
+    }
+}
+
+/***********************************************************
+ *  SetTextureBudget()
+ *
+ *  This method is used for setting how many bytes of GPU
+ *  memory the resident textures may use. Lowering it evicts
+ *  textures at the start of the next frame.
+ ***********************************************************/
+void SceneManager::SetTextureBudget(size_t budgetBytes)
+{
+    m_textureBudgetBytes = budgetBytes;
+}
+
+/***********************************************************
+ *  SetProgressiveTextures()
+ *
+ *  This method is used for choosing whether textures are
+ *  uploaded mip tail first and refined over later frames,
+ *  or with all of their mip levels at once.
+ ***********************************************************/
+void SceneManager::SetProgressiveTextures(bool bProgressive)
+{
+    m_bProgressiveTextures = bProgressive;
+}
+
+/***********************************************************
+ *  SetLazyTextures()
+ *
+ *  This method is used for choosing whether textures are
+ *  only registered when created, and loaded the first time
+ *  they are drawn. Set it before the textures are created.
+ ***********************************************************/
+void SceneManager::SetLazyTextures(bool bLazy)
+{
+    m_bLazyTextures = bLazy;
+}
+
+/***********************************************************
+ *  SetSerialTextureBenchmark()
+ *
+ *  This method is used for choosing whether the scene
+ *  textures are loaded a second time the old serial way
+ *  once the background load is done, so the load summary
+ *  can report the measured speedup against it.
+ ***********************************************************/
+void SceneManager::SetSerialTextureBenchmark(bool bBenchmark)
+{
+    m_bSerialTextureBenchmark = bBenchmark;
+}
+
+/***********************************************************
+ *  SelectTextureMode()
+ *
+ *  This method is used for choosing how textures are kept,
+ *  before the first one is created. Texture arrays need
+ *  immutable storage and GPU image copies from OpenGL 4.3,
+ *  and a shader with a sampler2DArray objectTextureArray;
+ *  otherwise every texture is its own GL_TEXTURE_2D, drawn
+ *  through the sampler2D objectTexture as before.
+ ***********************************************************/
+void SceneManager::SelectTextureMode()
+{
+    GLint majorVersion = 0;
+    GLint minorVersion = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+    bool bVersionSupported = (majorVersion > 4) || (majorVersion == 4 && minorVersion >= 3);
+
+    m_bTextureArrays = bVersionSupported && m_uniforms.objectTextureArray.IsValid();
+    std::cout << "INFO: Textures use " << (m_bTextureArrays ? "texture arrays" : "one OpenGL texture each")
+        << " (OpenGL " << majorVersion << "." << minorVersion << ")" << std::endl;
+}
+
+/***********************************************************
+ *  SelectTextureCompression()
+ *
+ *  This method is used for cooking the textures to the
+ *  preferred block compression only if the context can
+ *  sample it. BC1 and BC3 need S3TC, which is an extension
+ *  even on current contexts, and BC7 needs OpenGL 4.2 or
+ *  ARB_texture_compression_bptc; without BPTC the RGBA
+ *  textures use BC3, and without S3TC none are compressed.
+ ***********************************************************/
+void SceneManager::SelectTextureCompression()
+{
+    if (m_pTextureCache == NULL)
+        return;
+
+    GLint majorVersion = 0;
+    GLint minorVersion = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+    bool bS3TC = HasExtension("GL_EXT_texture_compression_s3tc");
+    bool bBPTC = (majorVersion > 4) || (majorVersion == 4 && minorVersion >= 2) ||
+        HasExtension("GL_ARB_texture_compression_bptc");
+
+    TEXTURE_COMPRESSION compression = g_TextureCompression;
+    if (!bS3TC)
+    {
+        compression = TEXTURE_COMPRESSION_NONE;
+    }
+    else if (compression == TEXTURE_COMPRESSION_BC1_BC7 && !bBPTC)
+    {
+        compression = TEXTURE_COMPRESSION_BC1_BC3;
+    }
+
+    m_pTextureCache->SetCompression(compression);
+    std::cout << "INFO: Texture block compression: " << g_CompressionNames[compression] << std::endl;
+}
+
+/***********************************************************
+ *  CreatePlaceholderTexture()
+ *
+ *  This method is used for creating the 1x1 neutral gray
+ *  texture drawn in place of any texture that is not
+ *  resident yet. It is an ordinary one-layer texture array,
+ *  so a draw only has to point at a different array/layer.
+ ***********************************************************/
+void SceneManager::CreatePlaceholderTexture()
+{
+    if (m_placeholderArray >= 0)
+    {
+        return;
+    }
+
+    // the placeholder is the first texture, so what depends on the
+    // context is chosen here
+    if (m_textureArrays.empty())
+    {
+        SelectTextureMode();
+        SelectTextureCompression();
+    }
+
+    if (m_textureArrays.size() >= g_MaxTextureArrays)
+    {
+        std::cout << "No free texture unit for the placeholder texture" << std::endl;
+        return;
+    }
+
+    const unsigned char placeholderPixel[4] = { 128, 128, 128, 255 };
+
+    TEXTURE_ARRAY textureArray;
+    textureArray.width = 1;
+    textureArray.height = 1;
+    textureArray.levelCount = 1;
+    textureArray.internalFormat = GL_RGBA8;
+    textureArray.pixelFormat = GL_RGBA;
+    textureArray.cookedFormat = COOKED_FORMAT_RAW;
+    // layer 0 holds the placeholder, later 1x1 images get layers after it
+    textureArray.layerCount = 1;
+    textureArray.layerCapacity = 1;
+    textureArray.baseLevel = 0;
+
+    GLenum target = m_bTextureArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    glGenTextures(1, &textureArray.ID);
+    glBindTexture(target, textureArray.ID);
+    if (m_bTextureArrays)
+    {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, 1, 1, 1);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel);
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(target, 0);
+
+    m_placeholderArray = static_cast<int>(m_textureArrays.size());
+    m_textureArrays.push_back(textureArray);
+
+    BindGLTextures();
+}
+
+/***********************************************************
+ *  AllocateTextureArrays()
+ *
+ *  This method is used for creating the immutable OpenGL
+ *  storage for every texture array that has more reserved
+ *  layers than allocated ones. An array that is already in
+ *  use is replaced by a larger one and its existing layers
+ *  are copied over on the GPU. Without texture arrays each
+ *  texture gets a GL_TEXTURE_2D with every mip level
+ *  defined, which never has to grow. Changed arrays are
+ *  rebound.
+ ***********************************************************/
+void SceneManager::AllocateTextureArrays()
+{
+    bool bArraysChanged = false;
+
+    for (size_t i = 0; i < m_textureArrays.size(); i++)
+    {
+        TEXTURE_ARRAY& textureArray = m_textureArrays[i];
+        if (textureArray.layerCount <= textureArray.layerCapacity)
+        {
+            continue;
+        }
+
+        // grow geometrically once the array has been allocated, so adding
+        // textures one at a time does not copy the array every time
+        int layerCapacity = textureArray.layerCount;
+        if (textureArray.layerCapacity > 0 && layerCapacity < textureArray.layerCapacity * 2)
+        {
+            layerCapacity = textureArray.layerCapacity * 2;
+        }
+
+        GLenum target = m_bTextureArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        GLuint textureID = 0;
+        glGenTextures(1, &textureID);
+        glBindTexture(target, textureID);
+        if (m_bTextureArrays)
+        {
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, textureArray.levelCount, textureArray.internalFormat,
+                textureArray.width, textureArray.height, layerCapacity);
+        }
+        else
+        {
+            // glTexStorage2D is OpenGL 4.2 as well, so the levels are defined
+            // one at a time and filled in by the uploads
+            for (int level = 0; level < textureArray.levelCount; level++)
+            {
+                int levelWidth = std::max(1, textureArray.width >> level);
+                int levelHeight = std::max(1, textureArray.height >> level);
+                if (textureArray.cookedFormat == COOKED_FORMAT_RAW)
+                {
+                    glTexImage2D(GL_TEXTURE_2D, level, textureArray.internalFormat, levelWidth, levelHeight, 0,
+                        textureArray.pixelFormat, GL_UNSIGNED_BYTE, NULL);
+                }
+                else
+                {
+                    size_t blockBytes = (textureArray.cookedFormat == COOKED_FORMAT_BC1) ? 8 : 16;
+                    size_t levelBytes = static_cast<size_t>((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes;
+                    glCompressedTexImage2D(GL_TEXTURE_2D, level, textureArray.internalFormat, levelWidth, levelHeight, 0,
+                        static_cast<GLsizei>(levelBytes), NULL);
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, textureArray.levelCount - 1);
+        }
+
+        // set the texture wrapping parameters
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        // set texture filtering parameters
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // keep sampling within the levels the streamed layers already have
+        glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, textureArray.baseLevel);
+
+        // a single texture holds one layer, so only an array is ever replaced
+        if (textureArray.ID != 0)
+        {
+            for (int level = 0; level < textureArray.levelCount; level++)
+            {
+                int levelWidth = std::max(1, textureArray.width >> level);
+                int levelHeight = std::max(1, textureArray.height >> level);
+                glCopyImageSubData(
+                    textureArray.ID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                    textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                    levelWidth, levelHeight, textureArray.layerCapacity);
+            }
+            glDeleteTextures(1, &textureArray.ID);
+        }
+
+        glBindTexture(target, 0);
+
+        bArraysChanged = true;
+        textureArray.ID = textureID;
+        textureArray.layerCapacity = layerCapacity;
+
+        // point every texture in this array at the new storage
+        for (TEXTURE_INFO& textureInfo : m_textureIDs)
+        {
+            if (textureInfo.arrayIndex == static_cast<int>(i))
+            {
+                textureInfo.ID = textureID;
+            }
+        }
+    }
+
+    // new or replaced arrays have to be bound to their texture units
+    if (bArraysChanged)
+    {
+        BindGLTextures();
+    }
+}
+
+/***********************************************************
+ *  UploadGLTexture()
+ *
+ *  This method is used for copying the mip levels firstLevel
+ *  up to (not including) endLevel of a previously decoded
+ *  image into the texture array layer reserved for its tag ID,
+ *  straight from memory. The finest uploaded level becomes
+ *  the texture's base level. The image memory is released
+ *  once level 0 is uploaded, or when the upload fails.
+ ***********************************************************/
+bool SceneManager::UploadGLTexture(DECODED_IMAGE& image, uint32_t tagID, int firstLevel, int endLevel)
+{
+    COOKED_TEXTURE& texture = image.texture;
+
+    // if the image was not successfully read from the image file
+    if (texture.levels.empty())
+    {
+        std::cout << "Could not load image:" << image.filename << std::endl;
+        return false;
+    }
+
+    const std::string& tag = m_pTagTable->GetName(tagID);
+    int textureSlot = FindTextureSlot(tagID);
+    if (textureSlot < 0)
+    {
+        std::cout << "No texture layer reserved for tag:" << tag << std::endl;
+        image.texture = COOKED_TEXTURE();
+        return false;
+    }
+
+    const TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+    const TEXTURE_ARRAY& textureArray = m_textureArrays[textureInfo.arrayIndex];
+
+    // defensive check: the decoded image has to fit the reserved layer
+    if (texture.width != textureArray.width || texture.height != textureArray.height ||
+        texture.colorChannels != ((textureArray.pixelFormat == GL_RGBA) ? 4 : 3) ||
+        texture.format != textureArray.cookedFormat ||
+        static_cast<int>(texture.levels.size()) != textureArray.levelCount ||
+        textureInfo.layer < 0 || textureInfo.layer >= textureArray.layerCapacity ||
+        firstLevel < 0 || firstLevel >= endLevel || endLevel > textureArray.levelCount)
+    {
+        std::cout << "Image " << image.filename << " does not match the texture layer reserved for tag:" << tag << std::endl;
+        image.texture = COOKED_TEXTURE();
+        return false;
+    }
+
+    // the first upload of an image checks whether it is loaded already
+    if (!textureInfo.bResident)
+    {
+        // an identical image already loaded under another tag is shared
+        // instead of being uploaded into a second layer; without texture
+        // arrays the two are in different textures of the same format.
+        // The hash only finds a candidate: the loaded texture's pixels are
+        // no longer in memory, so its cache entry is mapped again and the
+        // bytes compared, and without one nothing is shared
+        auto contentIt = m_textureContentLookup.find(image.contentHash);
+        const TEXTURE_ARRAY* pSharedArray = (contentIt != m_textureContentLookup.end()) ?
+            &m_textureArrays[m_textureIDs[contentIt->second].arrayIndex] : NULL;
+        COOKED_TEXTURE sharedTexture;
+        if (pSharedArray != NULL && contentIt->second != textureSlot &&
+            pSharedArray->width == textureArray.width && pSharedArray->height == textureArray.height &&
+            pSharedArray->internalFormat == textureArray.internalFormat &&
+            m_pTextureCache != NULL && m_pTextureCache->Load(m_textureIDs[contentIt->second].filename.c_str(), sharedTexture) &&
+            IsSameTextureContent(texture, sharedTexture))
+        {
+            std::cout << "Image " << image.filename << " is identical to texture:"
+                << m_textureIDs[contentIt->second].tag << ", sharing it for tag:" << tag << std::endl;
+            ShareTexture(textureSlot, contentIt->second);
+            image.texture = COOKED_TEXTURE();
+            return true;
+        }
+        m_textureContentLookup[image.contentHash] = textureSlot;
+
+        std::cout << "Successfully loaded image:" << image.filename
+            << ", width:" << texture.width
+            << ", height:" << texture.height
+            << ", channels:" << texture.colorChannels
+            << ", format:" << g_CookedFormatNames[texture.format]
+            << ", array:" << textureInfo.arrayIndex
+            << ", layer:" << textureInfo.layer
+            << ", first mip level:" << firstLevel
+            << (texture.bFromCache ? " (cached)" : "") << std::endl;
+    }
+
+    // the array stays bound to its own texture unit, see BindGLTextures()
+    GLenum target = m_bTextureArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(textureInfo.arrayIndex));
+    glBindTexture(target, textureArray.ID);
+
+    // the precomputed mip levels replace glGenerateMipmap; rows are tightly
+    // packed, which matters for the small RGB levels
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // stage the pixels in the persistently mapped ring when there is room,
+    // so the driver copies them asynchronously instead of stalling here
+    size_t ringOffset = 0;
+    unsigned char* pRingData = NULL;
+    if (m_pUploadRing != NULL && m_pUploadRing->IsAvailable())
+    {
+        pRingData = m_pUploadRing->Allocate(GetUploadSize(texture, firstLevel, endLevel), ringOffset);
+    }
+
+    if (pRingData != NULL)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pUploadRing->GetBufferID());
+
+        size_t levelOffset = 0;
+        for (int level = firstLevel; level < endLevel; level++)
+        {
+            std::memcpy(pRingData + levelOffset, texture.GetLevelData(level), texture.levels[level].size);
+
+            // with a bound unpack buffer the pixel pointer is a buffer offset
+            UploadTextureLevel(target, textureArray, textureInfo.layer, level, texture.levels[level],
+                reinterpret_cast<const void*>(ringOffset + levelOffset));
+
+            levelOffset += (texture.levels[level].size + 15) & ~static_cast<size_t>(15);
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_pUploadRing->Fence();
+    }
+    else
+    {
+        for (int level = firstLevel; level < endLevel; level++)
+        {
+            UploadTextureLevel(target, textureArray, textureInfo.layer, level, texture.levels[level],
+                texture.GetLevelData(level));
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // free the image data from local memory once every level is on the GPU
+    bool bTranslucent = texture.bTranslucent;
+    if (firstLevel == 0)
+    {
+        image.texture = COOKED_TEXTURE();
+    }
+
+    TEXTURE_INFO& uploadedInfo = m_textureIDs[textureSlot];
+    uploadedInfo.baseLevel = std::min(uploadedInfo.baseLevel, firstLevel);
+
+    // a reload into a resident texture replaces its pixels in place
+    if (!uploadedInfo.bResident)
+    {
+        uploadedInfo.bResident = true;
+        uploadedInfo.bTranslucent = bTranslucent;
+        m_loadedTextures++;
+        if (bTranslucent)
+        {
+            UpdateDrawTranslucency();
+        }
+    }
+
+    UpdateArrayBaseLevel(uploadedInfo.arrayIndex);
+
+    return true;
+}
+
+/***********************************************************
+ *  UpdateArrayBaseLevel()
+ *
+ *  This method is used for limiting sampling of a texture
+ *  array to the mip levels that every resident layer in it
+ *  already has. GL_TEXTURE_BASE_LEVEL applies to the whole
+ *  array, so a layer that is still streaming keeps its
+ *  neighbours at its resolution until it catches up.
+ ***********************************************************/
+void SceneManager::UpdateArrayBaseLevel(int arrayIndex)
+{
+    TEXTURE_ARRAY& textureArray = m_textureArrays[arrayIndex];
+    if (textureArray.ID == 0)
+    {
+        return;
+    }
+
+    int baseLevel = 0;
+    for (const TEXTURE_INFO& textureInfo : m_textureIDs)
+    {
+        if (textureInfo.arrayIndex == arrayIndex && textureInfo.bResident)
+        {
+            baseLevel = std::max(baseLevel, textureInfo.baseLevel);
+        }
+    }
+
+    if (baseLevel != textureArray.baseLevel)
+    {
+        textureArray.baseLevel = baseLevel;
+
+        GLenum target = m_bTextureArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(arrayIndex));
+        glBindTexture(target, textureArray.ID);
+        glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, baseLevel);
+    }
+}
+
+/***********************************************************
+ *  BindGLTextures()
+ *
+ *  This method is used for binding each texture array, or
+ *  each single texture, to its own OpenGL texture unit.
+ *  The bindings never change after this, so a draw only
+ *  points its sampler at a unit and picks a layer.
+ ***********************************************************/
+void SceneManager::BindGLTextures()
+{
+    GLenum target = m_bTextureArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    for (size_t i = 0; i < m_textureArrays.size(); i++)
+    {
+        // bind texture arrays on corresponding texture units
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+        glBindTexture(target, m_textureArrays[i].ID);
+    }
+}
+
+/***********************************************************
+ *  DestroyGLTextures()
+ *
+ *  This method is used for freeing the memory in all the
+ *  used texture memory slots.
+ ***********************************************************/
+void SceneManager::DestroyGLTextures()
+{
+    // the textures share their array's OpenGL texture, so each array is deleted once
+    for (TEXTURE_ARRAY& textureArray : m_textureArrays)
+    {
+        if (textureArray.ID != 0)
+        {
+            glDeleteTextures(1, &textureArray.ID); // CS-499 fix: delete, not generate
+            textureArray.ID = 0;
+        }
+        textureArray.layerCount = 0;
+        textureArray.layerCapacity = 0;
+        textureArray.freeLayers.clear();
+        textureArray.baseLevel = 0;
+    }
+    m_placeholderArray = -1;
+
+    for (TEXTURE_INFO& textureInfo : m_textureIDs)
+    {
+        textureInfo.ID = 0;
+        textureInfo.layer = -1;
+        textureInfo.baseLevel = m_textureArrays[textureInfo.arrayIndex].levelCount;
+        textureInfo.bResident = false;
+        textureInfo.bLoading = false;
+    }
+    m_textureContentLookup.clear();
+    m_residentTextureBytes = 0;
+    m_loadedTextures = 0;
+}
+
+/***********************************************************
+ *  FindTextureID()
+ *
+ *  This method is used for getting an ID for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureID(std::string_view tag) {
+
+	// CS-499 Enhancement: the slot lookup already knows the texture
+    int textureSlot = FindTextureSlot(tag);
+    if (textureSlot >= 0) {
+        return static_cast<int>(m_textureIDs[textureSlot].ID);
+
+    }
+    return -1;
+
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureSlot(std::string_view tag) {
+	// CS-499 Enhancement: O(1) lookup through the interned tag ID
+
+    int textureSlot = FindTextureSlot(m_pTagTable->Find(tag));
+    if (textureSlot >= 0) {
+        return textureSlot;
+
+    }
+
+	// Fallback to legacy linear search if not found in cache
+
+    int index = 0;
+    bool bFound = false;
+
+    while ((index < static_cast<int>(m_textureIDs.size())) && (bFound == false)) {
+        if (m_textureIDs[index].tag.compare(tag) == 0) {
+            textureSlot = index;
+            bFound = true;
+
+        }
+        else {
+            index++;
+
+        }
+    }
+    return textureSlot;
+
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting the slot index of the
+ *  texture for an interned tag. It is a bounds-checked
+ *  vector read, cheap enough for every draw.
+ ***********************************************************/
+int SceneManager::FindTextureSlot(uint32_t tagID) const {
+
+    if (tagID < m_textureSlotByTag.size()) {
+        return m_textureSlotByTag[tagID];
+
+    }
+    return -1;
+
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(std::string_view tag, OBJECT_MATERIAL& material) {
+
+	// CS-499 Enhancement: O(1) lookup through the interned tag ID
+    int materialHandle = FindMaterialHandle(tag);
+    if (materialHandle >= 0) {
+        material = m_objectMaterials[materialHandle];
+        return true;
+	}
+
+	// Fallback to legacy linear search if map is not populated
+    if (m_objectMaterials.empty()) {
+        return false;
+
+    }
+    int index = 0;
+    bool bFound = false;
+    while ((index < static_cast<int>(m_objectMaterials.size())) && (bFound == false)) {
+        if (m_objectMaterials[index].tag.compare(tag) == 0) {
+            bFound = true;
+            material = m_objectMaterials[index];
+
+        }
+        else {
+            index++;
+
+        }
+    }
+    return bFound;
+}
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values. Scene objects
+ *  use SetNodeTransformation() instead; this is for one-off
+ *  draws that are not part of the scene graph.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+    glm::vec3 scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    glm::vec3 positionXYZ)
+{
+    if (m_pShaderManager != NULL)
+    {
+        m_uniforms.model.Set(TransformKernel::ComposeTransform(
+            scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ));
+    }
+}
+
+/***********************************************************
+ *  SetNodeTransformation()
+ *
+ *  This method is used for setting the world matrix of a
+ *  scene graph node into the transform buffer. The matrix
+ *  was built by the last UpdateWorldTransforms(), so a draw
+ *  only uploads it.
+ ***********************************************************/
+void SceneManager::SetNodeTransformation(int node)
+{
+    if (m_pShaderManager != NULL)
+    {
+        m_uniforms.model.Set(m_pSceneGraph->GetWorldMatrix(node));
+    }
+}
+
+/***********************************************************
+ *  SetShaderColor()
+ *
+ *  This method is used for setting the passed in color
+ *  into the shader for the next draw command
+ ***********************************************************/
+void SceneManager::SetShaderColor(
+    float redColorValue,
+    float greenColorValue,
+    float blueColorValue,
+    float alphaValue)
+{
+    glm::vec4 currentColor;
+    currentColor.r = redColorValue;
+    currentColor.g = greenColorValue;
+    currentColor.b = blueColorValue;
+    currentColor.a = alphaValue;
+
+    if (m_pShaderManager != NULL)
+    {
+        CountUniformUpload(m_uniforms.bUseTexture.Set(false));
+        CountUniformUpload(m_uniforms.objectColor.Set(currentColor));
+    }
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data
+ *  associated with the passed in ID into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(std::string_view textureTag)
+{
+    SetShaderTexture(m_pTagTable->Find(textureTag));
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture of an
+ *  interned tag into the shader, without touching a string.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(uint32_t textureTagID)
+{
+    if (m_pShaderManager == NULL)
+        return;
+
+    int arrayIndex = -1;
+    int layer = 0;
+    if (!ResolveTextureLayer(textureTagID, arrayIndex, layer))
+    {
+        // an unknown tag keeps the current texture; a known one that is
+        // still loading, with no placeholder to stand in, is drawn gray
+        if (FindTextureSlot(textureTagID) >= 0)
+        {
+            SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
+        }
+        return;
+    }
+
+    // the textures stay bound to their units, see BindGLTextures(), so a
+    // draw only picks the unit and the layer inside it
+    CountUniformUpload(m_uniforms.bUseTexture.Set(true));
+    SetShaderTextureUnit(arrayIndex);
+    if (m_bTextureArrays)
+    {
+        CountUniformUpload(m_uniforms.objectTextureLayer.Set(layer));
+    }
+}
+
+/***********************************************************
+ *  SetShaderTextureUnit()
+ *
+ *  This method is used for pointing the sampler of a draw
+ *  at the texture unit a texture array, or a single
+ *  texture, is bound to. It is one sampler uniform rather
+ *  than an indexed array of them, which GLSL 3.30 forbids.
+ ***********************************************************/
+void SceneManager::SetShaderTextureUnit(int arrayIndex)
+{
+    if (m_bTextureArrays)
+    {
+        CountUniformUpload(m_uniforms.objectTextureArray.Set(arrayIndex));
+    }
+    else
+    {
+        CountUniformUpload(m_uniforms.objectTexture.Set(arrayIndex));
+    }
+}
+
+/***********************************************************
+ *  ResolveTextureLayer()
+ *
+ *  This method is used for finding the texture array and
+ *  layer a draw with the passed in tag samples. Using a
+ *  texture keeps it from being evicted and reloads it if it
+ *  was; until it is resident the placeholder stands in.
+ *  Returns false if there is nothing to sample.
+ ***********************************************************/
+bool SceneManager::ResolveTextureLayer(uint32_t textureTagID, int& arrayIndex, int& layer)
+{
+    int textureSlot = FindTextureSlot(textureTagID);
+    if (textureSlot < 0)
+    {
+        return false;
+    }
+
+    TouchTexture(textureSlot);
+
+    if (!m_textureIDs[textureSlot].bResident)
+    {
+        if (m_placeholderArray < 0)
+        {
+            return false;
+        }
+        arrayIndex = m_placeholderArray;
+        layer = 0;
+        return true;
+    }
+
+    arrayIndex = m_textureIDs[textureSlot].arrayIndex;
+    layer = m_textureIDs[textureSlot].layer;
+    return true;
+}
+
+/***********************************************************
+ *  SetTextureUVScale()
+ *
+ *  This method is used for setting the texture UV scale
+ *  values into the shader.
+ ***********************************************************/
+void SceneManager::SetTextureUVScale(float u, float v)
+{
+    if (m_pShaderManager != NULL)
+    {
+        CountUniformUpload(m_uniforms.UVscale.Set(glm::vec2(u, v)));
+    }
+}
+
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for selecting a material by tag. It
+ *  resolves the tag on every call, so per-draw code should
+ *  keep the handle from FindMaterialHandle() instead.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(std::string_view materialTag)
+{
+    SetShaderMaterial(FindMaterialHandle(materialTag));
+}
+
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for selecting a material by the
+ *  handle returned from FindMaterialHandle(). The material
+ *  values already sit in the material uniform buffer, so a
+ *  draw only sets the index into it; a shader without the
+ *  buffer gets the values themselves.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(int materialHandle)
+{
+    if (m_pShaderManager == NULL || materialHandle < 0)
+        return;
+
+    if (m_bMaterialBlock)
+    {
+        CountUniformUpload(m_uniforms.materialIndex.Set(materialHandle));
+        return;
+    }
+
+    const OBJECT_MATERIAL& material = m_objectMaterials[materialHandle];
+    CountUniformUpload(m_uniforms.materialDiffuseColor.Set(material.diffuseColor));
+    CountUniformUpload(m_uniforms.materialSpecularColor.Set(material.specularColor));
+    CountUniformUpload(m_uniforms.materialShininess.Set(material.shininess));
+}
+
+/***********************************************************
+ *  FindMaterialHandle()
+ *
+ *  This method is used for resolving a material tag to its
+ *  index in the material uniform buffer, once, when the
+ *  scene is built. Returns -1 for an unknown tag.
+ ***********************************************************/
+int SceneManager::FindMaterialHandle(std::string_view tag)
+{
+    uint32_t tagID = m_pTagTable->Find(tag);
+    if (tagID < m_materialHandleByTag.size())
+    {
+        return m_materialHandleByTag[tagID];
+    }
+    return -1;
+}
+
+/***********************************************************
+ *  UploadMaterialBuffer()
+ *
+ *  This method is used for packing every defined material
+ *  into a std140 uniform buffer and binding it to the
+ *  material block binding point, where ResolveUniforms()
+ *  points the shader program's block.
+ ***********************************************************/
+void SceneManager::UploadMaterialBuffer()
+{
+    std::vector<GPU_MATERIAL> gpuMaterials;
+    for (size_t i = 0; i < m_objectMaterials.size() && i < g_MaxMaterials; i++)
+    {
+        GPU_MATERIAL gpuMaterial;
+        gpuMaterial.diffuseColor[0] = m_objectMaterials[i].diffuseColor.x;
+        gpuMaterial.diffuseColor[1] = m_objectMaterials[i].diffuseColor.y;
+        gpuMaterial.diffuseColor[2] = m_objectMaterials[i].diffuseColor.z;
+        gpuMaterial.shininess = m_objectMaterials[i].shininess;
+        gpuMaterial.specularColor[0] = m_objectMaterials[i].specularColor.x;
+        gpuMaterial.specularColor[1] = m_objectMaterials[i].specularColor.y;
+        gpuMaterial.specularColor[2] = m_objectMaterials[i].specularColor.z;
+        gpuMaterial.padding = 0.0f;
+        gpuMaterials.push_back(gpuMaterial);
+    }
+
+    if (m_materialBufferID == 0)
+    {
+        glGenBuffers(1, &m_materialBufferID);
+    }
+
+    // the block is declared with the maximum size, so the buffer always covers it
+    glBindBuffer(GL_UNIFORM_BUFFER, m_materialBufferID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(GPU_MATERIAL) * g_MaxMaterials, NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GPU_MATERIAL) * gpuMaterials.size(), gpuMaterials.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, g_MaterialBlockBinding, m_materialBufferID);
+}
+
+/***********************************************************
+ *  ResolveUniforms()
+ *
+ *  This method is used for reading the uniform locations of
+ *  the shader program in use and storing a typed handle for
+ *  every uniform set per draw. It only does work when the
+ *  program has changed since the last call, so the setters
+ *  never look a uniform up by name.
+ ***********************************************************/
+void SceneManager::ResolveUniforms()
+{
+    if (m_pShaderManager == NULL || m_pUniformCache == NULL)
+        return;
+
+    if (m_pUniformCache->GetProgramID() == m_pShaderManager->m_programID)
+        return;
+
+    m_pUniformCache->Load(m_pShaderManager->m_programID);
+
+    m_uniforms.model = m_pUniformCache->Get<glm::mat4>(g_ModelName);
+    m_uniforms.objectColor = m_pUniformCache->Get<glm::vec4>(g_ColorValueName);
+    m_uniforms.bUseTexture = m_pUniformCache->Get<bool>(g_UseTextureName);
+    m_uniforms.bUseLighting = m_pUniformCache->Get<bool>(g_UseLightingName);
+    m_uniforms.bInstanced = m_pUniformCache->Get<bool>(g_InstancedName);
+    m_uniforms.bMultiDraw = m_pUniformCache->Get<bool>(g_MultiDrawName);
+    m_uniforms.objectTextureArray = m_pUniformCache->Get<int>(g_TextureArrayName);
+    m_uniforms.objectTextureLayer = m_pUniformCache->Get<int>(g_TextureLayerName);
+    m_uniforms.objectTexture = m_pUniformCache->Get<int>(g_TextureValueName);
+    m_uniforms.UVscale = m_pUniformCache->Get<glm::vec2>(g_UVScaleName);
+    m_uniforms.materialIndex = m_pUniformCache->Get<int>(g_MaterialIndexName);
+    m_uniforms.materialDiffuseColor = m_pUniformCache->Get<glm::vec3>(g_MaterialDiffuseName);
+    m_uniforms.materialSpecularColor = m_pUniformCache->Get<glm::vec3>(g_MaterialSpecularName);
+    m_uniforms.materialShininess = m_pUniformCache->Get<float>(g_MaterialShininessName);
+
+    // a shader without the material block keeps the per-material uniforms
+    GLuint blockIndex = glGetUniformBlockIndex(m_pShaderManager->m_programID, g_MaterialBlockName);
+    m_bMaterialBlock = (blockIndex != GL_INVALID_INDEX) && m_uniforms.materialIndex.IsValid();
+    if (m_bMaterialBlock)
+    {
+        glUniformBlockBinding(m_pShaderManager->m_programID, blockIndex, g_MaterialBlockBinding);
+    }
+    else
+    {
+        std::cout << "INFO: Shader has no " << g_MaterialBlockName << " uniform block, materials are set per draw" << std::endl;
+    }
+
+    if (!m_uniforms.model.IsValid())
+    {
+        std::cout << "Shader has no " << g_ModelName << " uniform" << std::endl;
+    }
+}
+
+/***********************************************************
+ *  CountUniformUpload()
+ *
+ *  This method is used for counting a shadowed uniform set
+ *  as sent to the program or skipped as redundant.
+ ***********************************************************/
+void SceneManager::CountUniformUpload(bool bSent)
+{
+    if (bSent)
+    {
+        m_uniformUploads.sentUploads++;
+    }
+    else
+    {
+        m_uniformUploads.elidedUploads++;
+    }
+}
+
+/***********************************************************
+ *  ReportUniformUploads()
+ *
+ *  This method is used for printing how many uniform
+ *  uploads the last frame sent and skipped, and resetting
+ *  the counts for the next frame. The counts only change
+ *  while textures stream in, so they are printed when they
+ *  differ from the last report instead of every frame.
+ ***********************************************************/
+void SceneManager::ReportUniformUploads()
+{
+    if (m_uniformUploads.sentUploads != m_reportedUniformUploads.sentUploads ||
+        m_uniformUploads.elidedUploads != m_reportedUniformUploads.elidedUploads)
+    {
+        std::cout << "INFO: Frame " << m_frameIndex << " sent " << m_uniformUploads.sentUploads
+            << " uniform uploads, elided " << m_uniformUploads.elidedUploads << " redundant ones" << std::endl;
+        m_reportedUniformUploads = m_uniformUploads;
+    }
+
+    m_uniformUploads.sentUploads = 0;
+    m_uniformUploads.elidedUploads = 0;
+}
+
+void SceneManager::DefineObjectMaterials()
+{
+    // Define material properties for a polished silver appearance
+    OBJECT_MATERIAL silverMaterial;
+    silverMaterial.diffuseColor = glm::vec3(0.7f, 0.7f, 0.7f);
+    silverMaterial.specularColor = glm::vec3(0.9f, 0.9f, 0.9f);
+    silverMaterial.shininess = 64.0f;
+    silverMaterial.tag = "metal";
+    m_objectMaterials.push_back(silverMaterial);
+
+    // Define material properties for a rich wood texture
+    OBJECT_MATERIAL woodMaterial;
+    woodMaterial.diffuseColor = glm::vec3(0.3f, 0.2f, 0.1f);
+    woodMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
+    woodMaterial.shininess = 16.0f;
+    woodMaterial.tag = "wood";
+    m_objectMaterials.push_back(woodMaterial);
+
+    // Define material properties for tinted glass
+    OBJECT_MATERIAL glassMaterial;
+    glassMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.3f);
+    glassMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    glassMaterial.shininess = 128.0f;
+    glassMaterial.tag = "glass";
+    m_objectMaterials.push_back(glassMaterial);
+
+    // Define material properties for a simple plate
+    OBJECT_MATERIAL plateMaterial;
+    plateMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
+    plateMaterial.specularColor = glm::vec3(0.3f, 0.3f, 0.3f);
+    plateMaterial.shininess = 24.0f;
+    plateMaterial.tag = "plate";
+    m_objectMaterials.push_back(plateMaterial);
+
+    // Define material properties for a backdrop or background plane
+    OBJECT_MATERIAL backdropMaterial;
+    backdropMaterial.diffuseColor = glm::vec3(0.8f, 0.8f, 0.9f);
+    backdropMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+    backdropMaterial.shininess = 8.0f;
+    backdropMaterial.tag = "backdrop";
+    m_objectMaterials.push_back(backdropMaterial);
+
+    // Define material properties for coffee-like liquid
+    OBJECT_MATERIAL coffeeMaterial;
+    coffeeMaterial.diffuseColor = glm::vec3(0.4f, 0.25f, 0.1f);
+    coffeeMaterial.specularColor = glm::vec3(0.5f, 0.3f, 0.2f);
+    coffeeMaterial.shininess = 30.0f;
+    coffeeMaterial.tag = "liquid";
+    m_objectMaterials.push_back(coffeeMaterial);
+
+    // Define material properties for the cover of a book
+    OBJECT_MATERIAL coverMaterial;
+    coverMaterial.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    coverMaterial.specularColor = glm::vec3(0.9f, 0.9f, 0.9f);
+    coverMaterial.shininess = 64.0f;
+    coverMaterial.tag = "cover";
+    m_objectMaterials.push_back(coverMaterial);
+
+    // Define material properties for the spine of a book
+    OBJECT_MATERIAL spineMaterial;
+    spineMaterial.diffuseColor = glm::vec3(0.3f, 0.15f, 0.15f);
+    spineMaterial.specularColor = glm::vec3(0.4f, 0.2f, 0.2f);
+    spineMaterial.shininess = 20.0f;
+    spineMaterial.tag = "spine";
+    m_objectMaterials.push_back(spineMaterial);
+
+    // Define material properties for the pages of a book
+    OBJECT_MATERIAL pagesMaterial;
+    pagesMaterial.diffuseColor = glm::vec3(0.9f, 0.9f, 0.85f);
+    pagesMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+    pagesMaterial.shininess = 5.0f;
+    pagesMaterial.tag = "pages";
+    m_objectMaterials.push_back(pagesMaterial);
+
+    // Leaf Material
+    OBJECT_MATERIAL leafMaterial;
+    leafMaterial.diffuseColor = glm::vec3(0.2f, 0.6f, 0.2f);
+    leafMaterial.specularColor = glm::vec3(0.1f, 0.3f, 0.1f);
+    leafMaterial.shininess = 6.0f;
+    leafMaterial.tag = "leaf";
+    m_objectMaterials.push_back(leafMaterial);
+
+    // Soil Material
+    OBJECT_MATERIAL soilMaterial;
+    soilMaterial.diffuseColor = glm::vec3(0.2f, 0.1f, 0.0f);
+    soilMaterial.specularColor = glm::vec3(0.05f, 0.02f, 0.01f);
+    soilMaterial.shininess = 4.0f;
+    soilMaterial.tag = "soil";
+    m_objectMaterials.push_back(soilMaterial);
+
+    // Clay Material
+    OBJECT_MATERIAL clayMaterial;
+    clayMaterial.diffuseColor = glm::vec3(0.8f, 0.5f, 0.3f);
+    clayMaterial.specularColor = glm::vec3(0.2f, 0.1f, 0.05f);
+    clayMaterial.shininess = 16.0f;
+    clayMaterial.tag = "clay";
+    m_objectMaterials.push_back(clayMaterial);
+
+	// CS-499 Enhancement: build fast lookup map for materials
+    // identical materials collapse into the first entry defined with those
+    // values; every tag still finds it through the lookup table, and its
+    // handle is the index of that entry in the material buffer
+    std::vector<OBJECT_MATERIAL> uniqueMaterials;
+    m_materialHandleByTag.clear();
+    for (const auto& mat : m_objectMaterials) {
+        uint32_t tagID = m_pTagTable->Intern(mat.tag);
+        if (m_materialHandleByTag.size() <= tagID) {
+            m_materialHandleByTag.resize(tagID + 1, -1);
+        }
+
+        auto it = std::find_if(uniqueMaterials.begin(), uniqueMaterials.end(),
+            [&mat](const OBJECT_MATERIAL& unique) { return IsSameMaterial(unique, mat); });
+        if (it == uniqueMaterials.end() && uniqueMaterials.size() >= g_MaxMaterials) {
+            // only g_MaxMaterials handles index into the material buffer
+            std::cout << "No room in the material buffer for material:" << mat.tag << std::endl;
+            m_materialHandleByTag[tagID] = -1;
+        }
+        else if (it == uniqueMaterials.end()) {
+            m_materialHandleByTag[tagID] = static_cast<int>(uniqueMaterials.size());
+            uniqueMaterials.push_back(mat);
+        }
+        else {
+            m_materialHandleByTag[tagID] = static_cast<int>(it - uniqueMaterials.begin());
+        }
+	}
+
+    // the material buffer always holds g_MaxMaterials entries, so this
+    // saves entries, not memory
+    size_t sharedMaterials = m_objectMaterials.size() - uniqueMaterials.size();
+    std::cout << "INFO: Deduplicated " << sharedMaterials << " of " << m_objectMaterials.size()
+        << " materials, " << uniqueMaterials.size() << " of " << g_MaxMaterials
+        << " material buffer entries used" << std::endl;
+    m_objectMaterials.swap(uniqueMaterials);
+
+    UploadMaterialBuffer();
+
+    // the render methods draw with handles resolved here, once
+    m_sceneMaterials.plate = FindMaterialHandle("plate");
+    m_sceneMaterials.backdrop = FindMaterialHandle("backdrop");
+    m_sceneMaterials.glass = FindMaterialHandle("glass");
+    m_sceneMaterials.wood = FindMaterialHandle("wood");
+    m_sceneMaterials.liquid = FindMaterialHandle("liquid");
+    m_sceneMaterials.cover = FindMaterialHandle("cover");
+    m_sceneMaterials.pages = FindMaterialHandle("pages");
+    m_sceneMaterials.soil = FindMaterialHandle("soil");
+    m_sceneMaterials.leaf = FindMaterialHandle("leaf");
+}
+
+/***********************************************************
+ * SetupSceneLights()
+ * Define lighting for the scene
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+    if (m_pShaderManager == NULL)
+        return;
+
+    // Enable lighting in the shader
+    m_uniforms.bUseLighting.Set(true);
+
+    // Main directional light (simulating sunlight)
+    m_pShaderManager->setVec3Value("directionalLight.direction", -0.5f, -1.0f, -0.3f);
+    m_pShaderManager->setVec3Value("directionalLight.ambient", 0.2f, 0.2f, 0.2f);
+    m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.7f, 0.7f, 0.6f);
+    m_pShaderManager->setVec3Value("directionalLight.specular", 0.5f, 0.5f, 0.5f);
+    m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+
+    // Point light 1
+    m_pShaderManager->setVec3Value("pointLights[0].position", -3.0f, 5.0f, 2.0f);
+    m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.1f, 0.1f, 0.1f);
+    m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.6f, 0.6f, 0.5f);
+    m_pShaderManager->setVec3Value("pointLights[0].specular", 0.7f, 0.7f, 0.6f);
+    m_pShaderManager->setFloatValue("pointLights[0].constant", 1.0f);
+    m_pShaderManager->setFloatValue("pointLights[0].linear", 0.09f);
+    m_pShaderManager->setFloatValue("pointLights[0].quadratic", 0.032f);
+    m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+
+    // Point light 2
+    m_pShaderManager->setVec3Value("pointLights[1].position", 4.0f, 5.0f, -2.0f);
+    m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.1f, 0.1f, 0.1f);
+    m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.5f, 0.5f, 0.6f);
+    m_pShaderManager->setVec3Value("pointLights[1].specular", 0.6f, 0.6f, 0.7f);
+    m_pShaderManager->setFloatValue("pointLights[1].constant", 1.0f);
+    m_pShaderManager->setFloatValue("pointLights[1].linear", 0.09f);
+    m_pShaderManager->setFloatValue("pointLights[1].quadratic", 0.032f);
+    m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+
+    // Spotlight (overhead)
+    m_pShaderManager->setVec3Value("spotLight.position", 0.0f, 6.0f, 0.0f);
+    m_pShaderManager->setVec3Value("spotLight.direction", 0.0f, -1.0f, 0.0f);
+    m_pShaderManager->setVec3Value("spotLight.ambient", 0.05f, 0.05f, 0.05f);
+    m_pShaderManager->setVec3Value("spotLight.diffuse", 0.7f, 0.7f, 0.6f);
+    m_pShaderManager->setVec3Value("spotLight.specular", 0.8f, 0.8f, 0.7f);
+    m_pShaderManager->setFloatValue("spotLight.constant", 1.0f);
+    m_pShaderManager->setFloatValue("spotLight.linear", 0.07f);
+    m_pShaderManager->setFloatValue("spotLight.quadratic", 0.017f);
+    m_pShaderManager->setFloatValue("spotLight.cutOff", glm::cos(glm::radians(15.0f)));
+    m_pShaderManager->setFloatValue("spotLight.outerCutOff", glm::cos(glm::radians(25.0f)));
+    m_pShaderManager->setBoolValue("spotLight.bActive", true);
+}
+
+/***********************************************************
+ * LoadSceneTextures()
+ * Load and bind textures for the scene
+ *
+ * The image files are decoded concurrently on the worker
+ * threads and uploaded by PumpTextureUploads() once per
+ * frame, so the scene starts rendering right away and the
+ * textures appear as they finish. Same-sized textures share
+ * a texture array where the context supports them, so the
+ * scene is not limited to 16. Every
+ * texture is registered, but only as many as fit in the
+ * texture budget are loaded up front; the rest load on use.
+ * In lazy mode none are loaded until they are first drawn.
+ ***********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+    struct TEXTURE_FILE
+    {
+        const char* filename;
+        const char* tag;
+    };
+
+    const TEXTURE_FILE sceneTextures[] =
+    {
+        { "textures/ceramic.png", "teapot" },
+        { "textures/woodtable.png", "table" },
+        { "textures/backdrop.png", "background" },
+        { "textures/woodroundtable.jpg", "roundtable" },
+        { "textures/coffeecup.png", "cup" },
+        { "textures/book.jpg", "book" },
+        { "textures/Coffeeliquid.png", "coffee" },
+        { "textures/metal.png", "handle" },
+        { "textures/pages.png", "pages" },
+        { "textures/bookspine.png", "spine" },
+        { "textures/glass.png", "glasshandle" },
+        { "textures/soiltexture.png", "soiltexture" },
+        { "textures/leaftexture.JPG", "leaftexture" },
+    };
+
+    m_textureLoadStats.startTime = std::chrono::steady_clock::now();
+    m_textureLoadStats.summedDecodeMilliseconds = 0.0;
+    m_textureLoadStats.uploadMilliseconds = 0.0;
+    m_textureLoadStats.cachedImages = 0;
+    m_textureLoadStats.bReported = false;
+    m_textureLoadStats.bDrawableReported = false;
+
+    // falls back to uploads from client memory if persistent mapping is unsupported
+    if (m_pUploadRing != NULL && !m_pUploadRing->IsAvailable() &&
+        !m_pUploadRing->Initialize(g_UploadRingBytes))
+    {
+        std::cout << "INFO: Persistently mapped upload buffers unavailable, textures upload synchronously" << std::endl;
+    }
+
+    CreatePlaceholderTexture();
+
+    // read only the image headers first, so each texture gets its array
+    // and every array is allocated once at its final size; the files are
+    // mapped and their headers parsed concurrently on the worker threads
+    struct IMAGE_HEADER
+    {
+        bool bValid;
+        int width;
+        int height;
+        int colorChannels;
+    };
+
+    std::vector<std::future<IMAGE_HEADER>> imageHeaders;
+    for (const TEXTURE_FILE& texture : sceneTextures)
+    {
+        const char* filename = texture.filename;
+        imageHeaders.push_back(m_pThreadPool->Submit([this, filename]()
+        {
+            IMAGE_HEADER header = { false, 0, 0, 0 };
+            header.bValid = ReadImageInfo(filename, header.width, header.height, header.colorChannels);
+            return header;
+        }));
+    }
+
+    std::vector<int> textureSlots;
+    for (size_t i = 0; i < imageHeaders.size(); i++)
+    {
+        IMAGE_HEADER header = imageHeaders[i].get();
+        if (header.bValid)
+        {
+            int textureSlot = RegisterTexture(sceneTextures[i].filename, sceneTextures[i].tag,
+                header.width, header.height, header.colorChannels);
+            if (textureSlot >= 0)
+            {
+                textureSlots.push_back(textureSlot);
+            }
+        }
+    }
+
+    // the flip flag is shared by all stb_image calls, so set it
+    // before any worker thread starts decoding
+    stbi_set_flip_vertically_on_load(true);
+
+    // the render methods draw with tag IDs resolved here, once; a tag
+    // whose image failed to load still gets an ID, it just finds no texture
+    m_sceneTextures.roundtable = m_pTagTable->Intern("roundtable");
+    m_sceneTextures.background = m_pTagTable->Intern("background");
+    m_sceneTextures.teapot = m_pTagTable->Intern("teapot");
+    m_sceneTextures.cup = m_pTagTable->Intern("cup");
+    m_sceneTextures.glasshandle = m_pTagTable->Intern("glasshandle");
+    m_sceneTextures.coffee = m_pTagTable->Intern("coffee");
+    m_sceneTextures.book = m_pTagTable->Intern("book");
+    m_sceneTextures.pages = m_pTagTable->Intern("pages");
+    m_sceneTextures.table = m_pTagTable->Intern("table");
+    m_sceneTextures.soiltexture = m_pTagTable->Intern("soiltexture");
+    m_sceneTextures.leaftexture = m_pTagTable->Intern("leaftexture");
+
+    // lazy textures load as draws first need them, with no point at which
+    // the scene load is over, so there is no load summary to print
+    if (m_bLazyTextures)
+    {
+        m_textureLoadStats.bReported = true;
+        m_textureLoadStats.bDrawableReported = true;
+        std::cout << "INFO: Textures load on first use, no scene texture load summary" << std::endl;
+        return;
+    }
+
+    for (int textureSlot : textureSlots)
+    {
+        RequestTexture(textureSlot);
+    }
+    AllocateTextureArrays();
+}
+
+
+/***********************************************************
+ * PumpTextureUploads()
+ * Upload the background-loaded textures that are ready
+ *
+ * Called once per frame. Finished decodes are copied into
+ * the upload ring while earlier uploads are still in flight;
+ * when the ring is full or the per-frame budget is spent,
+ * the rest waits for the next frame instead of stalling.
+ * Evicted textures requested again by the previous frame
+ * are uploaded the same way. In progressive mode a texture
+ * becomes drawable with its mip tail and sharpens by one
+ * mip level per frame.
+ ***********************************************************/
+void SceneManager::PumpTextureUploads()
+{
+    // a lowered budget takes effect before anything new is uploaded
+    if (m_residentTextureBytes > m_textureBudgetBytes)
+    {
+        MakeTextureRoom(0);
+    }
+
+    if (m_pendingTextures.empty())
+    {
+        return;
+    }
+
+    // layers taken by new requests may need larger texture arrays
+    AllocateTextureArrays();
+
+    size_t uploadedBytes = 0;
+    size_t index = 0;
+    while (index < m_pendingTextures.size() && uploadedBytes < g_MaxUploadBytesPerFrame)
+    {
+        PENDING_TEXTURE& pendingTexture = m_pendingTextures[index];
+
+        if (!pendingTexture.bDecoded)
+        {
+            if (pendingTexture.decodeResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                index++;
+                continue;
+            }
+
+            pendingTexture.image = pendingTexture.decodeResult.get();
+            pendingTexture.bDecoded = true;
+            pendingTexture.nextLevel = static_cast<int>(pendingTexture.image.texture.levels.size());
+            m_textureLoadStats.summedDecodeMilliseconds += pendingTexture.image.decodeMilliseconds;
+            if (pendingTexture.image.texture.bFromCache)
+            {
+                m_textureLoadStats.cachedImages++;
+            }
+        }
+
+        // progressive streaming uploads the mip tail first and then one
+        // finer level per frame; otherwise every level goes at once
+        const COOKED_TEXTURE& texture = pendingTexture.image.texture;
+        int levelCount = static_cast<int>(texture.levels.size());
+        int endLevel = pendingTexture.nextLevel;
+        int firstLevel = 0;
+        if (m_bProgressiveTextures && levelCount > 0)
+        {
+            firstLevel = (endLevel >= levelCount) ? GetMipTailLevel(texture) : endLevel - 1;
+        }
+
+        // wait for ring space rather than falling back to a blocking upload;
+        // only images larger than the whole ring go through client memory
+        size_t uploadSize = GetUploadSize(texture, firstLevel, endLevel);
+        if (m_pUploadRing != NULL && m_pUploadRing->IsAvailable() &&
+            uploadSize <= m_pUploadRing->GetCapacity() && !m_pUploadRing->HasSpace(uploadSize))
+        {
+            break;
+        }
+
+        // looked up first - an upload that turns out to be a duplicate
+        // points the tag at the shared texture
+        int textureSlot = FindTextureSlot(pendingTexture.tagID);
+
+        auto uploadStart = std::chrono::steady_clock::now();
+        bool bUploaded = UploadGLTexture(pendingTexture.image, pendingTexture.tagID, firstLevel, endLevel);
+        m_textureLoadStats.uploadMilliseconds += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - uploadStart).count();
+        uploadedBytes += uploadSize;
+
+        // the image is kept until its finest level is uploaded
+        if (bUploaded && !pendingTexture.image.texture.levels.empty())
+        {
+            pendingTexture.nextLevel = firstLevel;
+            index++;
+            continue;
+        }
+
+        if (textureSlot >= 0)
+        {
+            m_textureIDs[textureSlot].bLoading = false;
+
+            // a broken image gives its layer back and is not requested again
+            if (!bUploaded)
+            {
+                m_textureIDs[textureSlot].bLoadFailed = true;
+                EvictTexture(textureSlot);
+            }
+        }
+
+        m_pendingTextures.erase(m_pendingTextures.begin() + index);
+    }
+
+    // with progressive streaming the scene is fully drawable once every
+    // texture has its mip tail, long before the full resolution arrives
+    if (!m_textureLoadStats.bDrawableReported)
+    {
+        bool bDrawable = true;
+        for (const PENDING_TEXTURE& pendingTexture : m_pendingTextures)
+        {
+            if (!pendingTexture.bDecoded ||
+                pendingTexture.nextLevel >= static_cast<int>(pendingTexture.image.texture.levels.size()))
+            {
+                bDrawable = false;
+                break;
+            }
+        }
+
+        if (bDrawable)
+        {
+            m_textureLoadStats.bDrawableReported = true;
+            std::cout << "INFO: All scene textures drawable after "
+                << std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - m_textureLoadStats.startTime).count()
+                << " ms" << std::endl;
+        }
+    }
+
+    // the summary covers the scene load, not later reloads of evicted textures
+    if (m_pendingTextures.empty() && !m_textureLoadStats.bReported)
+    {
+        m_textureLoadStats.bReported = true;
+
+        double totalMilliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - m_textureLoadStats.startTime).count();
+
+        // the decodes overlapped and competed for the cores and the disk, so
+        // their summed time is no measure of the serial path; that takes a
+        // real serial pass, which is only run when asked for
+        std::cout << "INFO: Loaded " << m_loadedTextures << " textures (" << m_textureLoadStats.cachedImages << " from cache) into "
+            << m_textureArrays.size() << " texture arrays in "
+            << totalMilliseconds << " ms using " << m_pThreadPool->GetThreadCount()
+            << " decode threads (summed decode " << m_textureLoadStats.summedDecodeMilliseconds
+            << " ms, upload " << m_textureLoadStats.uploadMilliseconds << " ms)" << std::endl;
+        if (m_bSerialTextureBenchmark)
+        {
+            double serialMilliseconds = MeasureSerialTextureLoad();
+            std::cout << "INFO: Serial texture load " << serialMilliseconds << " ms, "
+                << (totalMilliseconds > 0.0 ? serialMilliseconds / totalMilliseconds : 1.0)
+                << "x the time of the pooled load" << std::endl;
+        }
+
+        // compare the texture memory against the same arrays stored uncompressed
+        size_t gpuBytes = 0;
+        size_t uncompressedBytes = 0;
+        for (const TEXTURE_ARRAY& textureArray : m_textureArrays)
+        {
+            gpuBytes += GetLayerBytes(textureArray, false) * textureArray.layerCapacity;
+            uncompressedBytes += GetLayerBytes(textureArray, true) * textureArray.layerCapacity;
+        }
+        std::cout << "INFO: Texture memory " << gpuBytes / 1024 << " KB (uncompressed "
+            << uncompressedBytes / 1024 << " KB, "
+            << (gpuBytes > 0 ? static_cast<double>(uncompressedBytes) / gpuBytes : 1.0) << "x smaller)" << std::endl;
+        std::cout << "INFO: Resident textures " << m_residentTextureBytes / 1024 << " KB of "
+            << m_textureBudgetBytes / 1024 << " KB budget, " << m_textureIDs.size() - m_loadedTextures
+            << " waiting to load on first use, " << m_evictedTextures << " evicted" << std::endl;
+        // the array storage is allocated up front and never shrinks, so a
+        // shared texture frees a layer for reuse, not GPU memory
+        std::cout << "INFO: Deduplicated " << m_sharedTextures
+            << " textures, their layers are free for other textures" << std::endl;
+    }
+}
+
+/***********************************************************
+ * PrepareScene()
+ * Prepare shapes, textures, and materials
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+    // the texture and material setup below already sets uniforms
+    ResolveUniforms();
+
+    LoadSceneTextures();
+    DefineObjectMaterials();
+    SetupSceneLights();
+    BuildSceneGraph();
+    BuildDrawList();
+
+    // the shapes share one vertex array; ShapeMeshes, with a vertex
+    // array per shape, is only loaded if the pool cannot be created
+    if (LoadMeshPool() || m_basicMeshes == NULL)
+        return;
+
+    m_basicMeshes->LoadPlaneMesh();
+    m_basicMeshes->LoadCylinderMesh();
+    m_basicMeshes->LoadTaperedCylinderMesh();
+    m_basicMeshes->LoadTorusMesh();
+    m_basicMeshes->LoadSphereMesh();
+    m_basicMeshes->LoadConeMesh();
+    m_basicMeshes->LoadBoxMesh();
+    m_basicMeshes->LoadPyramid3Mesh();
+}
+
 /***********************************************************
- *  SetTransformations()
+ *  LoadMeshPool()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for building every basic shape into
+ *  the shared mesh pool, so the whole scene draws from one
+ *  vertex array and can be submitted as one multi-draw.
+ *  The round shapes are built at every tessellation level;
+ *  the flat ones have a single level. The local bounding
+ *  box of each shape is kept for the culling, which also
+ *  covers the ShapeMeshes fallback, and its coarsest level
+ *  is what the occlusion test draws for it.
  ***********************************************************/
-void SceneManager::SetTransformations(
-    glm::vec3 scaleXYZ,
-    float XrotationDegrees,
-    float YrotationDegrees,
-    float ZrotationDegrees,
-    glm::vec3 positionXYZ)
+bool SceneManager::LoadMeshPool()
 {
-    // variables for this method
-    glm::mat4 modelView;
-    glm::mat4 scale;
-    glm::mat4 rotationX;
-    glm::mat4 rotationY;
-    glm::mat4 rotationZ;
-    glm::mat4 translation;
-
-    // set the scale value in the transform buffer
-    scale = glm::scale(scaleXYZ);
-    // set the rotation values in the transform buffer
-    rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-    // set the translation value in the transform buffer
-    translation = glm::translate(positionXYZ);
-
-    modelView = translation * rotationZ * rotationY * rotationX * scale;
+    for (int i = 0; i < SHAPE_MESH_COUNT; i++)
+    {
+        SHAPE_MESH shape = static_cast<SHAPE_MESH>(i);
+        bool bFlat = (shape == SHAPE_MESH_BOX || shape == SHAPE_MESH_PLANE || shape == SHAPE_MESH_PYRAMID3);
+        m_shapeLodCounts[i] = bFlat ? 1 : SHAPE_LOD_COUNT;
 
-    if (m_pShaderManager != NULL)
+        for (int lod = 0; lod < m_shapeLodCounts[i]; lod++)
+        {
+            ShapeGeometry::MESH_DATA mesh;
+            BuildShapeMesh(shape, g_LodSlices[lod], mesh);
+            if (lod == 0)
+            {
+                m_shapeBounds[i] = Culling::ComputeBox(mesh.vertices.data(), mesh.GetVertexCount(), ShapeGeometry::FLOATS_PER_VERTEX);
+            }
+            m_shapeTriangles[i][lod] = static_cast<int>(mesh.indices.size() / 3);
+            if (m_pMeshPool != NULL)
+            {
+                m_poolMeshes[i][lod] = m_pMeshPool->AddMesh(mesh);
+            }
+            if (lod == m_shapeLodCounts[i] - 1)
+            {
+                m_occluderMeshes[i].vertices.swap(mesh.vertices);
+                m_occluderMeshes[i].indices.swap(mesh.indices);
+            }
+        }
+
+        // a draw of a flat shape always stays at level 0, but the
+        // other levels name the same mesh all the same
+        for (int lod = m_shapeLodCounts[i]; lod < SHAPE_LOD_COUNT; lod++)
+        {
+            m_poolMeshes[i][lod] = m_poolMeshes[i][0];
+            m_shapeTriangles[i][lod] = m_shapeTriangles[i][0];
+        }
+    }
+
+    if (m_pMeshPool == NULL || !m_pMeshPool->Upload())
+        return false;
+
+    std::cout << "INFO: Mesh pool shapes are rebuilt with the assumed ShapeMeshes dimensions "
+        << "(cylinder radius " << g_CylinderRadius << ", tapered top " << g_TaperedTopRadius
+        << ", torus " << g_TorusMainRadius << "/" << g_TorusTubeRadius << ")" << std::endl;
+    return true;
+}
+
+/***********************************************************
+ *  BuildShapeMesh()
+ *
+ *  This method is used for generating the vertices and
+ *  indices of one basic shape. The round shapes have the
+ *  given number of slices around their axis; the sphere
+ *  and the torus tube have half as many stacks.
+ *
+ *  The shapes are rebuilt rather than copied from
+ *  ShapeMeshes, which keeps its vertices on the GPU only.
+ *  They assume its dimensions: a unit box and sphere, a
+ *  2x2 plane, cylinders of radius 1 and height 1 whose
+ *  tapered top has radius 0.5, and a torus of radius 1.0
+ *  with a 0.2 tube. A shape of ShapeMeshes with other
+ *  dimensions would draw, cull and occlude at the wrong
+ *  size through the pool.
+ ***********************************************************/
+void SceneManager::BuildShapeMesh(SHAPE_MESH mesh, int slices, ShapeGeometry::MESH_DATA& data) const
+{
+    switch (mesh)
     {
-        m_pShaderManager->setMat4Value(g_ModelName, modelView);
+    case SHAPE_MESH_BOX:
+        ShapeGeometry::BuildBox(data);
+        break;
+    case SHAPE_MESH_CONE:
+        ShapeGeometry::BuildCylinder(data, g_CylinderRadius, 0.0f, slices);
+        break;
+    case SHAPE_MESH_CYLINDER:
+        ShapeGeometry::BuildCylinder(data, g_CylinderRadius, g_CylinderRadius, slices);
+        break;
+    case SHAPE_MESH_PLANE:
+        ShapeGeometry::BuildPlane(data);
+        break;
+    case SHAPE_MESH_PYRAMID3:
+        ShapeGeometry::BuildPyramid3(data);
+        break;
+    case SHAPE_MESH_SPHERE:
+        ShapeGeometry::BuildSphere(data, slices / 2, slices);
+        break;
+    case SHAPE_MESH_TAPERED_CYLINDER:
+        ShapeGeometry::BuildCylinder(data, g_CylinderRadius, g_TaperedTopRadius, slices);
+        break;
+    case SHAPE_MESH_TORUS:
+        ShapeGeometry::BuildTorus(data, g_TorusMainRadius, g_TorusTubeRadius, slices, slices / 2);
+        break;
+    default:
+        break;
     }
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  RenderScene()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for rendering the 3D scene by
+ *  replaying the draw commands recorded in PrepareScene()
  ***********************************************************/
-void SceneManager::SetShaderColor(
-    float redColorValue,
-    float greenColorValue,
-    float blueColorValue,
-    float alphaValue)
+void SceneManager::RenderScene()
 {
-    glm::vec4 currentColor;
-    currentColor.r = redColorValue;
-    currentColor.g = greenColorValue;
-    currentColor.b = blueColorValue;
-    currentColor.a = alphaValue;
+    if (m_basicMeshes == NULL)
+    {
+        std::cerr << "ERROR: m_basicMeshes is null in RenderScene()." << std::endl;
+        return;
+    }
 
-    if (m_pShaderManager != NULL)
+    // textures keep streaming in while the scene renders; the frame
+    // index dates every texture use for the eviction order
+    m_frameIndex++;
+    ResolveUniforms();
+    PumpTextureUploads();
+
+    // only subtrees under a moved node are recomputed, and the draw
+    // bounds only need refreshing when a world matrix changed
+    if (m_pSceneGraph->UpdateWorldTransforms() > 0 || m_drawBounds.size() != m_drawCommands.size())
+    {
+        UpdateDrawBounds();
+    }
+
+    // replay the visible draws in state order; the shadowed uniforms drop the
+    // uploads that repeat the previous command's material, texture or UV scale
+    CullDrawCommands();
+    SelectDrawLods();
+    SortDrawCommands();
+    m_sortedOrderStats.drawCalls = 0;
+    bool bPooled = (m_pMeshPool != NULL && m_pMeshPool->IsLoaded());
+    if (bPooled)
+    {
+        m_pMeshPool->Bind();
+    }
+
+    // with multi-draw support the whole sorted list is one submission
+    bool bSubmitted = bPooled && SubmitMultiDraw();
+    for (size_t i = 0; !bSubmitted && i < m_drawKeys.size(); )
+    {
+        m_sortedOrderStats.drawCalls++;
+
+        // identical shapes next to each other in the sorted order collapse
+        // into one instanced draw
+        size_t instancedCount = DrawInstancedRun(i);
+        if (instancedCount > 0)
+        {
+            i += instancedCount;
+            continue;
+        }
+
+        size_t draw = m_drawKeys[i] & g_DrawKeyIndexMask;
+        const DRAW_COMMAND& command = m_drawCommands[draw];
+        CountUniformUpload(m_uniforms.bInstanced.Set(false));
+        SetNodeTransformation(command.node);
+        SetShaderMaterial(command.materialHandle);
+        SetShaderTexture(command.textureTagID);
+        SetTextureUVScale(command.UVscale.x, command.UVscale.y);
+        DrawShapeMesh(command.mesh, m_drawLods[draw]);
+        i++;
+    }
+
+    if (bPooled)
+    {
+        m_pMeshPool->Unbind();
+    }
+
+    ReportDrawOrder();
+    ReportCulling();
+    ReportLevelOfDetail();
+    ReportUniformUploads();
+}
+
+/***********************************************************
+ *  BuildSceneGraph()
+ *
+ *  This method is used for creating the scene nodes. Each
+ *  compound object is one node placed in the scene, with
+ *  its parts as children positioned relative to it, so the
+ *  whole object moves by changing the parent alone.
+ ***********************************************************/
+void SceneManager::BuildSceneGraph()
+{
+    SceneGraph& graph = *m_pSceneGraph;
+    const int root = SceneGraph::NO_PARENT;
+    const glm::vec3 unitScale = glm::vec3(1.0f, 1.0f, 1.0f);
+
+    // Round table and backdrop
+    m_sceneNodes.table = graph.CreateNode(root,
+        glm::vec3(15.0f, 0.0f, 15.0f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_sceneNodes.backdrop = graph.CreateNode(root,
+        glm::vec3(20.0f, 1.0f, 20.0f), 90.0f, 0.0f, 0.0f, glm::vec3(0.0f, 20.0f, -10.0f));
+
+    // Percolator, left of the center of the tray
+    int percolator = graph.CreateNode(root, unitScale, 0.0f, 0.0f, 0.0f, glm::vec3(-2.5f, 0.0f, 0.0f));
+    m_sceneNodes.percolatorBody = graph.CreateNode(percolator,
+        glm::vec3(1.2f, 3.0f, 1.2f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_sceneNodes.percolatorSpout = graph.CreateNode(percolator,
+        glm::vec3(0.4f, 1.9f, 0.4f), 30.0f, 90.0f, 0.0f, glm::vec3(0.9f, 0.4f, 0.0f));
+    m_sceneNodes.percolatorHandle = graph.CreateNode(percolator,
+        glm::vec3(0.6f, 0.8f, 0.2f), 0.0f, 0.0f, 90.0f, glm::vec3(-0.9f, 1.8f, 0.0f));
+    m_sceneNodes.percolatorLid = graph.CreateNode(percolator,
+        glm::vec3(0.6f, 0.1f, 0.80f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 3.0f, 0.0f));
+    m_sceneNodes.percolatorKnob = graph.CreateNode(percolator,
+        glm::vec3(0.2f, 0.1f, 0.2f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 3.1f, 0.0f));
+    m_sceneNodes.percolator = percolator;
+
+    // Coffee cup
+    int cup = graph.CreateNode(root, unitScale, 0.0f, 0.0f, 0.0f, glm::vec3(0.5f, 0.0f, 1.0f));
+    m_sceneNodes.cupBody = graph.CreateNode(cup,
+        glm::vec3(1.1f, 1.0f, 1.2f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_sceneNodes.cupHandle = graph.CreateNode(cup,
+        glm::vec3(0.5f, 0.3f, 0.2f), 0.0f, 0.0f, 1.0f, glm::vec3(1.0f, 0.5f, 0.0f));
+    m_sceneNodes.cupLiquid = graph.CreateNode(cup,
+        glm::vec3(1.1f, 0.01f, 1.2f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+    m_sceneNodes.cup = cup;
+
+    // Stack of three books, shifted diagonally off the table corner
+    float gap = 0.02f;   // Small gap between books
+    float tableHeight = 0.2f;    // Height of the table
+    float diagonalOffset = 0.5f;  // Amount to shift diagonally (x and z)
+    const float coverHeights[3] = { 0.0f, 0.3f + gap, 0.6f + 2 * gap };
+    const float pageHeights[3] = { 0.01f, 0.33f + gap, 0.61f + 2 * gap };
+
+    int books = graph.CreateNode(root, unitScale, 0.0f, 0.0f, 0.0f,
+        glm::vec3(-6.0f + diagonalOffset, tableHeight, 5.0f + diagonalOffset));
+    for (int i = 0; i < 3; i++)
+    {
+        m_sceneNodes.bookCovers[i] = graph.CreateNode(books,
+            glm::vec3(3.5f, 0.3f, 2.5f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, coverHeights[i], 0.0f));
+        m_sceneNodes.bookPages[i] = graph.CreateNode(books,
+            glm::vec3(3.53f, 0.23f, 2.3f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, pageHeights[i], -0.11f));
+    }
+    m_sceneNodes.books = books;
+
+    // Tray, with its edges standing on the base
+    float edgeHeight = 0.3f;
+    float edgeThickness = 0.1f;
+    int tray = graph.CreateNode(root, unitScale, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.05f, 0.0f));
+    m_sceneNodes.trayBase = graph.CreateNode(tray,
+        glm::vec3(8.0f, 0.05f, 5.0f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+    // Front and back edges
+    m_sceneNodes.trayEdges[0] = graph.CreateNode(tray,
+        glm::vec3(8.1f, edgeHeight, edgeThickness), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, edgeHeight / 2.0f, -2.55f));
+    m_sceneNodes.trayEdges[1] = graph.CreateNode(tray,
+        glm::vec3(8.1f, edgeHeight, edgeThickness), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, edgeHeight / 2.0f, 2.55f));
+    // Left and right edges
+    m_sceneNodes.trayEdges[2] = graph.CreateNode(tray,
+        glm::vec3(edgeThickness, edgeHeight, 5.1f), 0.0f, 0.0f, 0.0f, glm::vec3(-4.05f, edgeHeight / 2.0f, 0.0f));
+    m_sceneNodes.trayEdges[3] = graph.CreateNode(tray,
+        glm::vec3(edgeThickness, edgeHeight, 5.1f), 0.0f, 0.0f, 0.0f, glm::vec3(4.05f, edgeHeight / 2.0f, 0.0f));
+    m_sceneNodes.tray = tray;
+
+    // Flower pot
+    int flowerPot = graph.CreateNode(root, unitScale, 0.0f, 0.0f, 0.0f, glm::vec3(-7.0f, 0.0f, 0.0f));
+    m_sceneNodes.potBody = graph.CreateNode(flowerPot,
+        glm::vec3(0.8f, 0.6f, 0.8f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_sceneNodes.potSoil = graph.CreateNode(flowerPot,
+        glm::vec3(0.7f, 0.05f, 0.7f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.56f, 0.0f));
+    m_sceneNodes.potPlant = graph.CreateNode(flowerPot,
+        glm::vec3(0.5f, 0.5f, 0.5f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.8f, 0.0f));
+    m_sceneNodes.flowerPot = flowerPot;
+
+    graph.UpdateWorldTransforms();
+}
+
+/***********************************************************
+ *  AddDrawCommand()
+ *
+ *  This method is used for appending one draw to the
+ *  retained draw list. Every command carries its full
+ *  state, so the replay never depends on what the command
+ *  before it set.
+ ***********************************************************/
+void SceneManager::AddDrawCommand(
+    int node,
+    SHAPE_MESH mesh,
+    int materialHandle,
+    uint32_t textureTagID,
+    float uScale,
+    float vScale)
+{
+    // the sort key has 16 bits for the command index
+    if (m_drawCommands.size() > g_DrawKeyIndexMask)
+    {
+        std::cout << "Draw list is full, dropping draw of node " << node << std::endl;
+        return;
+    }
+
+    DRAW_COMMAND command;
+    command.node = node;
+    command.mesh = mesh;
+    command.materialHandle = materialHandle;
+    command.textureTagID = textureTagID;
+    command.UVscale = glm::vec2(uScale, vScale);
+    command.bTranslucent = IsTextureTranslucent(textureTagID);
+    command.bOccluder = false;
+    m_drawCommands.push_back(command);
+}
+
+/***********************************************************
+ *  DrawInstancedRun()
+ *
+ *  This method is used for drawing consecutive sorted draw
+ *  commands as instances of one shape. A run can only hold
+ *  opaque draws of the same shape, tessellation level and
+ *  UV scale whose textures are in the same texture array,
+ *  because the sampler is one uniform for the whole draw;
+ *  the material and the layer come from each instance. Returns how many commands were drawn, or
+ *  0 when fewer than two could be batched.
+ ***********************************************************/
+size_t SceneManager::DrawInstancedRun(size_t firstKey)
+{
+    size_t firstDraw = m_drawKeys[firstKey] & g_DrawKeyIndexMask;
+    const DRAW_COMMAND& first = m_drawCommands[firstDraw];
+    if (m_pMeshPool == NULL || !m_pMeshPool->IsLoaded() || first.bTranslucent || m_pShaderManager == NULL ||
+        !m_uniforms.bInstanced.IsValid() || !m_bMaterialBlock)
+    {
+        return 0;
+    }
+
+    int batchArray = -1;
+    int layer = 0;
+    if (!ResolveTextureLayer(first.textureTagID, batchArray, layer))
+    {
+        return 0;
+    }
+
+    m_meshInstances.clear();
+    for (size_t i = firstKey; i < m_drawKeys.size() && m_meshInstances.size() < g_MaxInstancesPerDraw; i++)
+    {
+        size_t draw = m_drawKeys[i] & g_DrawKeyIndexMask;
+        const DRAW_COMMAND& command = m_drawCommands[draw];
+        if (command.mesh != first.mesh || m_drawLods[draw] != m_drawLods[firstDraw] || command.bTranslucent || command.materialHandle < 0 ||
+            !(command.UVscale == first.UVscale))
+        {
+            break;
+        }
+
+        int arrayIndex = -1;
+        if (!ResolveTextureLayer(command.textureTagID, arrayIndex, layer) || arrayIndex != batchArray)
+        {
+            break;
+        }
+
+        MESH_INSTANCE instance;
+        instance.model = m_pSceneGraph->GetWorldMatrix(command.node);
+        instance.materialIndex = command.materialHandle;
+        instance.textureLayer = layer;
+        instance.padding[0] = 0;
+        instance.padding[1] = 0;
+        m_meshInstances.push_back(instance);
+    }
+
+    if (m_meshInstances.size() < 2)
+    {
+        return 0;
+    }
+
+    CountUniformUpload(m_uniforms.bInstanced.Set(true));
+    CountUniformUpload(m_uniforms.bUseTexture.Set(true));
+    SetShaderTextureUnit(batchArray);
+    CountUniformUpload(m_uniforms.UVscale.Set(first.UVscale));
+    m_pMeshPool->DrawInstances(m_poolMeshes[first.mesh][m_drawLods[firstDraw]], m_meshInstances.data(), m_meshInstances.size());
+    return m_meshInstances.size();
+}
+
+/***********************************************************
+ *  SubmitMultiDraw()
+ *
+ *  This method is used for drawing the sorted draw list
+ *  with indirect multi-draws, one for each run of draws
+ *  from the same texture array, since the array sampler is
+ *  a single uniform. Each command draws its shape's range
+ *  of the mesh pool, and its model matrix, material,
+ *  texture layer and UV scale go into the per-draw data at
+ *  the same index, where the shader reads them through
+ *  gl_DrawID. A draw whose texture tag is unknown or
+ *  material is missing keeps the values of the draw before
+ *  it, as it does when drawing one at a time.
+ ***********************************************************/
+bool SceneManager::SubmitMultiDraw()
+{
+    if (!m_pMeshPool->IsMultiDrawSupported() || !m_bTextureArrays || !m_bMaterialBlock ||
+        m_pShaderManager == NULL || !m_uniforms.bMultiDraw.IsValid())
+    {
+        return false;
+    }
+
+    MESH_DRAW draw;
+    draw.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    draw.materialIndex = 0;
+    draw.textureLayer = 0;
+    draw.bUseTexture = 0;
+    draw.padding[0] = 0;
+    draw.padding[1] = 0;
+    draw.padding[2] = 0;
+
+    CountUniformUpload(m_uniforms.bMultiDraw.Set(true));
+    m_sortedOrderStats.drawCalls = 0;
+
+    // draws the collected run with its texture array on the sampler
+    int runArray = -1;
+    auto submitRun = [this, &runArray]()
+    {
+        if (m_meshDraws.empty())
+        {
+            return;
+        }
+        if (runArray >= 0)
+        {
+            SetShaderTextureUnit(runArray);
+        }
+        m_pMeshPool->MultiDraw(m_indirectCommands.data(), m_meshDraws.data(), m_meshDraws.size());
+        m_sortedOrderStats.drawCalls++;
+        m_indirectCommands.clear();
+        m_meshDraws.clear();
+    };
+
+    m_indirectCommands.clear();
+    m_meshDraws.clear();
+    for (uint64_t key : m_drawKeys)
+    {
+        size_t drawIndex = key & g_DrawKeyIndexMask;
+        const DRAW_COMMAND& command = m_drawCommands[drawIndex];
+        const MESH_RANGE& range = m_pMeshPool->GetRange(m_poolMeshes[command.mesh][m_drawLods[drawIndex]]);
+
+        int arrayIndex = -1;
+        int layer = 0;
+        bool bTextured = ResolveTextureLayer(command.textureTagID, arrayIndex, layer);
+        if (bTextured && arrayIndex != runArray)
+        {
+            submitRun();
+            runArray = arrayIndex;
+        }
+
+        DRAW_ELEMENTS_INDIRECT_COMMAND indirect;
+        indirect.count = range.indexCount;
+        indirect.instanceCount = 1;
+        indirect.firstIndex = range.firstIndex;
+        indirect.baseVertex = range.baseVertex;
+        indirect.baseInstance = 0;
+        m_indirectCommands.push_back(indirect);
+
+        draw.model = m_pSceneGraph->GetWorldMatrix(command.node);
+        draw.UVscale = command.UVscale;
+        if (command.materialHandle >= 0)
+        {
+            draw.materialIndex = command.materialHandle;
+        }
+
+        if (bTextured)
+        {
+            draw.bUseTexture = 1;
+            draw.textureLayer = layer;
+        }
+        else if (FindTextureSlot(command.textureTagID) >= 0)
+        {
+            draw.bUseTexture = 0;
+            draw.color = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+        }
+        m_meshDraws.push_back(draw);
+    }
+
+    submitRun();
+    CountUniformUpload(m_uniforms.bMultiDraw.Set(false));
+    return true;
+}
+
+/***********************************************************
+ *  IsTextureTranslucent()
+ *
+ *  This method is used for telling whether a texture has
+ *  pixels with an alpha below 255, and so must be blended
+ *  over what is behind it. An alpha channel alone does not
+ *  count, as many opaque images carry one. It is known once
+ *  the pixels are loaded; until then the opaque placeholder
+ *  is drawn in its place.
+ ***********************************************************/
+bool SceneManager::IsTextureTranslucent(uint32_t textureTagID) const
+{
+    int textureSlot = FindTextureSlot(textureTagID);
+    if (textureSlot < 0)
+    {
+        return false;
+    }
+    return m_textureIDs[textureSlot].bResident && m_textureIDs[textureSlot].bTranslucent;
+}
+
+/***********************************************************
+ *  UpdateDrawTranslucency()
+ *
+ *  This method is used for updating the blended draws when
+ *  a translucent texture is loaded, evicted or shared. The
+ *  occluders are chosen again too, since a blended draw
+ *  hides nothing.
+ ***********************************************************/
+void SceneManager::UpdateDrawTranslucency()
+{
+    for (DRAW_COMMAND& command : m_drawCommands)
+    {
+        command.bTranslucent = IsTextureTranslucent(command.textureTagID);
+    }
+    DesignateOccluders();
+}
+
+/***********************************************************
+ *  UpdateDrawBounds()
+ *
+ *  This method is used for placing the local box of each
+ *  draw's shape at its node's world matrix, giving the
+ *  world box and sphere the culling tests. The hierarchy
+ *  over the boxes is refit in place; it is only rebuilt
+ *  when the draw list changed, or when moved objects have
+ *  stretched its boxes enough to make queries half again
+ *  as expensive as a fresh build.
+ ***********************************************************/
+void SceneManager::UpdateDrawBounds()
+{
+    m_drawBounds.resize(m_drawCommands.size());
+    m_drawBoxes.resize(m_drawCommands.size());
+    m_drawLods.resize(m_drawCommands.size(), 0);
+    for (size_t i = 0; i < m_drawCommands.size(); i++)
+    {
+        const DRAW_COMMAND& command = m_drawCommands[i];
+        m_drawBounds[i] = Culling::TransformBounds(m_shapeBounds[command.mesh], m_pSceneGraph->GetWorldMatrix(command.node));
+        m_drawBoxes[i] = m_drawBounds[i].box;
+    }
+
+    if (m_pDrawHierarchy == NULL)
+        return;
+
+    if (m_pDrawHierarchy->GetObjectCount() == m_drawBoxes.size())
+    {
+        m_pDrawHierarchy->Refit(m_drawBoxes);
+        if (m_pDrawHierarchy->GetCost() <= 1.5f * m_drawHierarchyBuiltCost)
+        {
+            return;
+        }
+    }
+    m_pDrawHierarchy->Build(m_drawBoxes);
+    m_drawHierarchyBuiltCost = m_pDrawHierarchy->GetCost();
+}
+
+/***********************************************************
+ *  PickNode()
+ *
+ *  This method is used for finding what is under a ray,
+ *  such as one cast from the camera through the mouse. It
+ *  returns the scene graph node of the draw whose box the
+ *  ray enters first, or -1 if it hits nothing.
+ ***********************************************************/
+int SceneManager::PickNode(const glm::vec3& origin, const glm::vec3& direction) const
+{
+    if (m_pDrawHierarchy == NULL)
+        return -1;
+
+    float hitDistance = 0.0f;
+    int draw = m_pDrawHierarchy->QueryRay(origin, direction, std::numeric_limits<float>::max(), hitDistance);
+    return (draw != BoundingVolumeHierarchy::NO_HIT) ? m_drawCommands[draw].node : -1;
+}
+
+/***********************************************************
+ *  CullDrawCommands()
+ *
+ *  This method is used for finding the draws that can be
+ *  seen this frame; the others get no sort key, so nothing
+ *  downstream sets a uniform or issues a draw for them.
+ *  The hierarchy drops whole groups of draws outside the
+ *  view frustum at once, and the draws it keeps get the
+ *  finer sphere and box test. With occlusion culling on,
+ *  the visible occluders are then rasterized into the CPU
+ *  depth buffer, and every other draw whose box is behind
+ *  them at all the pixels it covers is dropped as well.
+ ***********************************************************/
+void SceneManager::CullDrawCommands()
+{
+    Culling::FRUSTUM frustum = Culling::ExtractFrustum(m_viewProjection);
+
+    m_visibleDraws.clear();
+    if (m_bViewProjection && m_pDrawHierarchy != NULL && m_pDrawHierarchy->GetObjectCount() == m_drawCommands.size())
+    {
+        m_pDrawHierarchy->QueryFrustum(frustum, m_visibleDraws);
+    }
+    else
+    {
+        for (size_t i = 0; i < m_drawCommands.size(); i++)
+        {
+            m_visibleDraws.push_back(static_cast<int>(i));
+        }
+    }
+
+    size_t visibleCount = 0;
+    for (int i : m_visibleDraws)
+    {
+        if (!m_bViewProjection || !Culling::IsOutsideFrustum(frustum, m_drawBounds[i]))
+        {
+            m_visibleDraws[visibleCount++] = i;
+        }
+    }
+    m_visibleDraws.resize(visibleCount);
+    int frustumVisibleDraws = static_cast<int>(visibleCount);
+
+    m_occluders.clear();
+    if (m_bOcclusionCulling && m_bViewProjection && m_pOcclusionBuffer != NULL)
+    {
+        for (int i : m_visibleDraws)
+        {
+            const DRAW_COMMAND& command = m_drawCommands[i];
+            if (command.bOccluder && !m_occluderMeshes[command.mesh].indices.empty())
+            {
+                OcclusionBuffer::OCCLUDER occluder;
+                occluder.pMesh = &m_occluderMeshes[command.mesh];
+                occluder.model = m_pSceneGraph->GetWorldMatrix(command.node);
+                m_occluders.push_back(occluder);
+            }
+        }
+    }
+
+    if (!m_occluders.empty())
+    {
+        m_pOcclusionBuffer->Rasterize(m_occluders, m_viewProjection, m_pThreadPool);
+
+        visibleCount = 0;
+        for (int i : m_visibleDraws)
+        {
+            if (m_drawCommands[i].bOccluder || !m_pOcclusionBuffer->IsHidden(m_drawBounds[i].box))
+            {
+                m_visibleDraws[visibleCount++] = i;
+            }
+        }
+        m_visibleDraws.resize(visibleCount);
+    }
+
+    m_cullingStats.visibleDraws = static_cast<int>(m_visibleDraws.size());
+    m_cullingStats.culledDraws = static_cast<int>(m_drawCommands.size()) - frustumVisibleDraws;
+    m_cullingStats.occludedDraws = frustumVisibleDraws - m_cullingStats.visibleDraws;
+}
+
+/***********************************************************
+ *  SelectDrawLods()
+ *
+ *  This method is used for choosing how finely each visible
+ *  draw of a round shape is tessellated. The measure is the
+ *  fraction of the view height its bounding sphere covers:
+ *  the length of the view-projection's y row is the y scale
+ *  of the projection, because the view matrix only rotates
+ *  and translates, and its w row gives the depth the size
+ *  is divided by (1 for the orthographic views). A draw
+ *  only moves to another level once it is well past the
+ *  size between the two, so one sitting near that size
+ *  does not pop back and forth. ShapeMeshes has a single
+ *  tessellation, so without the pool every draw stays at
+ *  level 0.
+ ***********************************************************/
+void SceneManager::SelectDrawLods()
+{
+    glm::vec3 yRow(m_viewProjection[0][1], m_viewProjection[1][1], m_viewProjection[2][1]);
+    glm::vec4 wRow(m_viewProjection[0][3], m_viewProjection[1][3], m_viewProjection[2][3], m_viewProjection[3][3]);
+    float yScale = std::sqrt(yRow.x * yRow.x + yRow.y * yRow.y + yRow.z * yRow.z);
+    bool bPooled = (m_pMeshPool != NULL && m_pMeshPool->IsLoaded());
+
+    LOD_STATS stats = { 0, 0, { 0 } };
+    for (int i : m_visibleDraws)
+    {
+        const DRAW_COMMAND& command = m_drawCommands[i];
+        int levelCount = (bPooled && m_bViewProjection) ? m_shapeLodCounts[command.mesh] : 1;
+        int& level = m_drawLods[i];
+        level = std::min(level, levelCount - 1);
+
+        if (levelCount > 1)
+        {
+            const Culling::WORLD_BOUNDS& bounds = m_drawBounds[i];
+            float depth = wRow.x * bounds.center.x + wRow.y * bounds.center.y + wRow.z * bounds.center.z + wRow.w;
+            float screenSize = (depth > 0.0f) ? bounds.radius * yScale / depth : 1.0f;
+            while (level > 0 && screenSize > g_LodScreenSizes[level - 1] * (1.0f + g_LodHysteresis))
+            {
+                level--;
+            }
+            while (level < levelCount - 1 && screenSize < g_LodScreenSizes[level] * (1.0f - g_LodHysteresis))
+            {
+                level++;
+            }
+        }
+
+        stats.trianglesDrawn += m_shapeTriangles[command.mesh][level];
+        stats.fullDetailTriangles += m_shapeTriangles[command.mesh][0];
+        stats.levelDraws[level]++;
+    }
+    m_lodStats = stats;
+}
+
+/***********************************************************
+ *  SortDrawCommands()
+ *
+ *  This method is used for ordering this frame's visible
+ *  draws so consecutive draws share as much GL state as
+ *  possible. Opaque draws are grouped by program, then
+ *  mesh and level, then texture, then material. Translucent draws go
+ *  after all of them, farthest from the camera first, so
+ *  blending sees what is behind them. The keys are rebuilt
+ *  every frame because the camera and the nodes can move.
+ ***********************************************************/
+void SceneManager::SortDrawCommands()
+{
+    uint64_t program = (m_pShaderManager != NULL) ? (m_pShaderManager->m_programID & 0x7F) : 0;
+
+    m_drawKeys.clear();
+    for (int i : m_visibleDraws)
+    {
+        const DRAW_COMMAND& command = m_drawCommands[i];
+        uint64_t key;
+        if (!command.bTranslucent)
+        {
+            key = (program << g_DrawKeyProgramShift) |
+                ((static_cast<uint64_t>(command.mesh * SHAPE_LOD_COUNT + m_drawLods[i]) & g_DrawKeyMeshMask) << g_DrawKeyMeshShift) |
+                ((static_cast<uint64_t>(command.textureTagID) & g_DrawKeyTextureMask) << g_DrawKeyTextureShift) |
+                ((static_cast<uint64_t>(command.materialHandle) & 0xFFFF) << g_DrawKeyMaterialShift);
+        }
+        else
+        {
+            // the bits of a non-negative float sort like its value; inverting
+            // them puts the farthest draw first
+            glm::vec3 offset = m_drawBounds[i].center - m_viewPosition;
+            float distanceSquared = offset.x * offset.x + offset.y * offset.y + offset.z * offset.z;
+            uint32_t depthBits;
+            std::memcpy(&depthBits, &distanceSquared, sizeof(depthBits));
+            key = g_DrawKeyTranslucentBit |
+                (static_cast<uint64_t>(0xFFFFFFFFu - depthBits) << g_DrawKeyDepthShift);
+        }
+        m_drawKeys.push_back(key | static_cast<uint64_t>(i));
+    }
+
+    RadixSort64(m_drawKeys, m_drawKeyScratch);
+    m_sortedOrderStats = CountDrawStateChanges(m_drawKeys);
+}
+
+/***********************************************************
+ *  CountDrawStateChanges()
+ *
+ *  This method is used for counting how often a draw order
+ *  switches texture and mesh between consecutive draws;
+ *  the first draw counts as one of each. With the mesh pool
+ *  a mesh switch only moves to another index range, but
+ *  through ShapeMeshes it is a VAO switch. Another level of
+ *  the same shape is another index range too; a draw whose
+ *  level is not chosen yet counts at level 0.
+ ***********************************************************/
+SceneManager::DRAW_ORDER_STATS SceneManager::CountDrawStateChanges(const std::vector<uint64_t>& drawKeys) const
+{
+    DRAW_ORDER_STATS stats = { 0, 0, 0 };
+    const DRAW_COMMAND* pPrevious = NULL;
+    int previousLod = 0;
+    for (uint64_t key : drawKeys)
     {
-        m_pShaderManager->setIntValue(g_UseTextureName, false);
-        m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+        size_t index = static_cast<size_t>(key & g_DrawKeyIndexMask);
+        const DRAW_COMMAND& command = m_drawCommands[index];
+        int lod = (index < m_drawLods.size()) ? m_drawLods[index] : 0;
+        if (pPrevious == NULL || pPrevious->textureTagID != command.textureTagID)
+        {
+            stats.textureSwitches++;
+        }
+        if (pPrevious == NULL || pPrevious->mesh != command.mesh || previousLod != lod)
+        {
+            stats.meshSwitches++;
+        }
+        pPrevious = &command;
+        previousLod = lod;
     }
+    return stats;
 }
 
 /***********************************************************
- *  SetShaderTexture()
+ *  ReportDrawOrder()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for printing the texture binds and
+ *  mesh switches of the sorted draw order next to those of
+ *  the recorded order. Like the uniform upload counts it
+ *  only prints when the numbers change.
  ***********************************************************/
-void SceneManager::SetShaderTexture(std::string textureTag)
+void SceneManager::ReportDrawOrder()
 {
-    if (m_pShaderManager != NULL)
+    if (m_sortedOrderStats.textureSwitches == m_reportedOrderStats.textureSwitches &&
+        m_sortedOrderStats.meshSwitches == m_reportedOrderStats.meshSwitches &&
+        m_sortedOrderStats.drawCalls == m_reportedOrderStats.drawCalls)
     {
-        m_pShaderManager->setIntValue(g_UseTextureName, true);
-
-        int textureSlot = FindTextureSlot(textureTag);
-        m_pShaderManager->setSampler2DValue(g_TextureValueName, textureSlot);
+        return;
     }
+
+    std::cout << "INFO: " << m_drawCommands.size() << " draws, draw calls "
+        << m_recordedOrderStats.drawCalls << " -> " << m_sortedOrderStats.drawCalls << ", texture binds "
+        << m_recordedOrderStats.textureSwitches << " -> " << m_sortedOrderStats.textureSwitches
+        << ", mesh switches " << m_recordedOrderStats.meshSwitches << " -> " << m_sortedOrderStats.meshSwitches
+        << " (recorded -> sorted order)" << std::endl;
+    m_reportedOrderStats = m_sortedOrderStats;
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  ReportCulling()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for printing how many draws the
+ *  frustum and occlusion tests kept and rejected, when
+ *  that changes, with the cost of the occlusion pass.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::ReportCulling()
 {
-    if (m_pShaderManager != NULL)
+    if (m_cullingStats.visibleDraws == m_reportedCullingStats.visibleDraws &&
+        m_cullingStats.culledDraws == m_reportedCullingStats.culledDraws &&
+        m_cullingStats.occludedDraws == m_reportedCullingStats.occludedDraws)
+    {
+        return;
+    }
+
+    std::cout << "INFO: Frame " << m_frameIndex << " drew " << m_cullingStats.visibleDraws
+        << " visible draws, culled " << m_cullingStats.culledDraws << " outside the view";
+    if (!m_occluders.empty())
     {
-        m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+        std::cout << ", " << m_cullingStats.occludedDraws << " hidden behind " << m_occluders.size()
+            << " occluders (" << m_pOcclusionBuffer->GetTriangleCount() << " triangles rasterized in "
+            << m_pOcclusionBuffer->GetRasterMilliseconds() << " ms)";
     }
+    std::cout << std::endl;
+    m_reportedCullingStats = m_cullingStats;
 }
 
 /***********************************************************
- *  SetShaderMaterial()
+ *  ReportLevelOfDetail()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for printing the triangles of the
+ *  frame's draws at their chosen levels, next to what they
+ *  would cost at full detail, when that changes.
  ***********************************************************/
-void SceneManager::SetShaderMaterial(std::string materialTag)
+void SceneManager::ReportLevelOfDetail()
 {
-    if (m_pShaderManager == NULL || m_objectMaterials.empty())
+    bool bChanged = (m_lodStats.trianglesDrawn != m_reportedLodStats.trianglesDrawn ||
+        m_lodStats.fullDetailTriangles != m_reportedLodStats.fullDetailTriangles);
+    for (int lod = 0; lod < SHAPE_LOD_COUNT; lod++)
+    {
+        bChanged = bChanged || (m_lodStats.levelDraws[lod] != m_reportedLodStats.levelDraws[lod]);
+    }
+    if (!bChanged)
+    {
         return;
+    }
 
-    OBJECT_MATERIAL material;
-    bool bReturn = FindMaterial(materialTag, material);
-    if (bReturn)
+    std::cout << "INFO: Frame " << m_frameIndex << " drew " << m_lodStats.trianglesDrawn
+        << " triangles, " << m_lodStats.fullDetailTriangles << " at full detail; draws per level";
+    for (int lod = 0; lod < SHAPE_LOD_COUNT; lod++)
     {
-        m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-        m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-        m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+        std::cout << " " << m_lodStats.levelDraws[lod];
     }
+    std::cout << std::endl;
+    m_reportedLodStats = m_lodStats;
 }
 
-void SceneManager::DefineObjectMaterials()
+/***********************************************************
+ *  DesignateOccluders()
+ *
+ *  This method is used for choosing the draws drawn into
+ *  the occlusion buffer: the large solid parts that other
+ *  objects sit behind or inside. Only closed convex shapes
+ *  qualify: the buffer bounds an occluder over a pixel from
+ *  its corners, which holds for convex ones, and their
+ *  coarsest mesh stays inside the drawn one at any level,
+ *  as the slices of every level divide those of the finer
+ *  ones. A translucent draw hides nothing.
+ ***********************************************************/
+void SceneManager::DesignateOccluders()
 {
-    // Define material properties for a polished silver appearance
-    OBJECT_MATERIAL silverMaterial;
-    silverMaterial.diffuseColor = glm::vec3(0.7f, 0.7f, 0.7f);
-    silverMaterial.specularColor = glm::vec3(0.9f, 0.9f, 0.9f);
-    silverMaterial.shininess = 64.0f;
-    silverMaterial.tag = "metal";
-    m_objectMaterials.push_back(silverMaterial);
-
-    // Define material properties for a rich wood texture
-    OBJECT_MATERIAL woodMaterial;
-    woodMaterial.diffuseColor = glm::vec3(0.3f, 0.2f, 0.1f);
-    woodMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
-    woodMaterial.shininess = 16.0f;
-    woodMaterial.tag = "wood";
-    m_objectMaterials.push_back(woodMaterial);
-
-    // Define material properties for tinted glass
-    OBJECT_MATERIAL glassMaterial;
-    glassMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.3f);
-    glassMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-    glassMaterial.shininess = 128.0f;
-    glassMaterial.tag = "glass";
-    m_objectMaterials.push_back(glassMaterial);
-
-    // Define material properties for a simple plate
-    OBJECT_MATERIAL plateMaterial;
-    plateMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-    plateMaterial.specularColor = glm::vec3(0.3f, 0.3f, 0.3f);
-    plateMaterial.shininess = 24.0f;
-    plateMaterial.tag = "plate";
-    m_objectMaterials.push_back(plateMaterial);
-
-    // Define material properties for a backdrop or background plane
-    OBJECT_MATERIAL backdropMaterial;
-    backdropMaterial.diffuseColor = glm::vec3(0.8f, 0.8f, 0.9f);
-    backdropMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-    backdropMaterial.shininess = 8.0f;
-    backdropMaterial.tag = "backdrop";
-    m_objectMaterials.push_back(backdropMaterial);
-
-    // Define material properties for coffee-like liquid
-    OBJECT_MATERIAL coffeeMaterial;
-    coffeeMaterial.diffuseColor = glm::vec3(0.4f, 0.25f, 0.1f);
-    coffeeMaterial.specularColor = glm::vec3(0.5f, 0.3f, 0.2f);
-    coffeeMaterial.shininess = 30.0f;
-    coffeeMaterial.tag = "liquid";
-    m_objectMaterials.push_back(coffeeMaterial);
-
-    // Define material properties for the cover of a book
-    OBJECT_MATERIAL coverMaterial;
-    coverMaterial.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
-    coverMaterial.specularColor = glm::vec3(0.9f, 0.9f, 0.9f);
-    coverMaterial.shininess = 64.0f;
-    coverMaterial.tag = "cover";
-    m_objectMaterials.push_back(coverMaterial);
-
-    // Define material properties for the spine of a book
-    OBJECT_MATERIAL spineMaterial;
-    spineMaterial.diffuseColor = glm::vec3(0.3f, 0.15f, 0.15f);
-    spineMaterial.specularColor = glm::vec3(0.4f, 0.2f, 0.2f);
-    spineMaterial.shininess = 20.0f;
-    spineMaterial.tag = "spine";
-    m_objectMaterials.push_back(spineMaterial);
-
-    // Define material properties for the pages of a book
-    OBJECT_MATERIAL pagesMaterial;
-    pagesMaterial.diffuseColor = glm::vec3(0.9f, 0.9f, 0.85f);
-    pagesMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-    pagesMaterial.shininess = 5.0f;
-    pagesMaterial.tag = "pages";
-    m_objectMaterials.push_back(pagesMaterial);
-
-    // Leaf Material
-    OBJECT_MATERIAL leafMaterial;
-    leafMaterial.diffuseColor = glm::vec3(0.2f, 0.6f, 0.2f);
-    leafMaterial.specularColor = glm::vec3(0.1f, 0.3f, 0.1f);
-    leafMaterial.shininess = 6.0f;
-    leafMaterial.tag = "leaf";
-    m_objectMaterials.push_back(leafMaterial);
-
-    // Soil Material
-    OBJECT_MATERIAL soilMaterial;
-    soilMaterial.diffuseColor = glm::vec3(0.2f, 0.1f, 0.0f);
-    soilMaterial.specularColor = glm::vec3(0.05f, 0.02f, 0.01f);
-    soilMaterial.shininess = 4.0f;
-    soilMaterial.tag = "soil";
-    m_objectMaterials.push_back(soilMaterial);
-
-    // Clay Material
-    OBJECT_MATERIAL clayMaterial;
-    clayMaterial.diffuseColor = glm::vec3(0.8f, 0.5f, 0.3f);
-    clayMaterial.specularColor = glm::vec3(0.2f, 0.1f, 0.05f);
-    clayMaterial.shininess = 16.0f;
-    clayMaterial.tag = "clay";
-    m_objectMaterials.push_back(clayMaterial);
-
-	// CS-499 Enhancement: build fast lookup map for materials
-    m_materialLookup.clear();
-    for (const auto& mat : m_objectMaterials) {
-        m_materialLookup[mat.tag] = mat;
-	}
+    const int occluderNodes[] = {
+        m_sceneNodes.table,
+        m_sceneNodes.trayBase,
+        m_sceneNodes.percolatorBody,
+        m_sceneNodes.cupBody,
+        m_sceneNodes.bookCovers[0],
+        m_sceneNodes.bookCovers[1],
+        m_sceneNodes.bookCovers[2],
+        m_sceneNodes.potBody
+    };
+
+    for (DRAW_COMMAND& command : m_drawCommands)
+    {
+        bool bConvex = (command.mesh == SHAPE_MESH_BOX || command.mesh == SHAPE_MESH_CYLINDER ||
+            command.mesh == SHAPE_MESH_TAPERED_CYLINDER || command.mesh == SHAPE_MESH_CONE ||
+            command.mesh == SHAPE_MESH_SPHERE);
+        command.bOccluder = false;
+        for (int node : occluderNodes)
+        {
+            if (command.node == node)
+            {
+                command.bOccluder = bConvex && !command.bTranslucent;
+            }
+        }
+    }
 }
 
 /***********************************************************
- * SetupSceneLights()
- * Define lighting for the scene
+ *  SetOcclusionCulling()
+ *
+ *  This method is used for turning the CPU occlusion test
+ *  on or off. It costs a small rasterization every frame,
+ *  which pays off when large objects hide many others.
  ***********************************************************/
-void SceneManager::SetupSceneLights()
+void SceneManager::SetOcclusionCulling(bool bOcclusionCulling)
 {
-    if (m_pShaderManager == NULL)
-        return;
-
-    // Enable lighting in the shader
-    m_pShaderManager->setBoolValue(g_UseLightingName, true);
-
-    // Main directional light (simulating sunlight)
-    m_pShaderManager->setVec3Value("directionalLight.direction", -0.5f, -1.0f, -0.3f);
-    m_pShaderManager->setVec3Value("directionalLight.ambient", 0.2f, 0.2f, 0.2f);
-    m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.7f, 0.7f, 0.6f);
-    m_pShaderManager->setVec3Value("directionalLight.specular", 0.5f, 0.5f, 0.5f);
-    m_pShaderManager->setBoolValue("directionalLight.bActive", true);
-
-    // Point light 1
-    m_pShaderManager->setVec3Value("pointLights[0].position", -3.0f, 5.0f, 2.0f);
-    m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.1f, 0.1f, 0.1f);
-    m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.6f, 0.6f, 0.5f);
-    m_pShaderManager->setVec3Value("pointLights[0].specular", 0.7f, 0.7f, 0.6f);
-    m_pShaderManager->setFloatValue("pointLights[0].constant", 1.0f);
-    m_pShaderManager->setFloatValue("pointLights[0].linear", 0.09f);
-    m_pShaderManager->setFloatValue("pointLights[0].quadratic", 0.032f);
-    m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
-
-    // Point light 2
-    m_pShaderManager->setVec3Value("pointLights[1].position", 4.0f, 5.0f, -2.0f);
-    m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.1f, 0.1f, 0.1f);
-    m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.5f, 0.5f, 0.6f);
-    m_pShaderManager->setVec3Value("pointLights[1].specular", 0.6f, 0.6f, 0.7f);
-    m_pShaderManager->setFloatValue("pointLights[1].constant", 1.0f);
-    m_pShaderManager->setFloatValue("pointLights[1].linear", 0.09f);
-    m_pShaderManager->setFloatValue("pointLights[1].quadratic", 0.032f);
-    m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
-
-    // Spotlight (overhead)
-    m_pShaderManager->setVec3Value("spotLight.position", 0.0f, 6.0f, 0.0f);
-    m_pShaderManager->setVec3Value("spotLight.direction", 0.0f, -1.0f, 0.0f);
-    m_pShaderManager->setVec3Value("spotLight.ambient", 0.05f, 0.05f, 0.05f);
-    m_pShaderManager->setVec3Value("spotLight.diffuse", 0.7f, 0.7f, 0.6f);
-    m_pShaderManager->setVec3Value("spotLight.specular", 0.8f, 0.8f, 0.7f);
-    m_pShaderManager->setFloatValue("spotLight.constant", 1.0f);
-    m_pShaderManager->setFloatValue("spotLight.linear", 0.07f);
-    m_pShaderManager->setFloatValue("spotLight.quadratic", 0.017f);
-    m_pShaderManager->setFloatValue("spotLight.cutOff", glm::cos(glm::radians(15.0f)));
-    m_pShaderManager->setFloatValue("spotLight.outerCutOff", glm::cos(glm::radians(25.0f)));
-    m_pShaderManager->setBoolValue("spotLight.bActive", true);
+    m_bOcclusionCulling = bOcclusionCulling;
 }
 
 /***********************************************************
- * LoadSceneTextures()
- * Load and bind textures for the scene
+ *  SetViewProjection()
+ *
+ *  This method is used for setting the view-projection
+ *  matrix of the frame about to be rendered; draws whose
+ *  bounds are outside its frustum are skipped.
  ***********************************************************/
-void SceneManager::LoadSceneTextures()
+void SceneManager::SetViewProjection(const glm::mat4& viewProjection)
 {
-    CreateGLTexture("textures/ceramic.png", "teapot");
-    CreateGLTexture("textures/woodtable.png", "table");
-    CreateGLTexture("textures/backdrop.png", "background");
-    CreateGLTexture("textures/woodroundtable.jpg", "roundtable");
-    CreateGLTexture("textures/coffeecup.png", "cup");
-    CreateGLTexture("textures/book.jpg", "book");
-    CreateGLTexture("textures/Coffeeliquid.png", "coffee");
-    CreateGLTexture("textures/metal.png", "handle");
-    CreateGLTexture("textures/pages.png", "pages");
-    CreateGLTexture("textures/bookspine.png", "spine");
-    CreateGLTexture("textures/glass.png", "glasshandle");
-    CreateGLTexture("textures/soiltexture.png", "soiltexture");
-    CreateGLTexture("textures/leaftexture.JPG", "leaftexture");
-
-    BindGLTextures();
+    m_viewProjection = viewProjection;
+    m_bViewProjection = true;
 }
 
 /***********************************************************
- * PrepareScene()
- * Prepare shapes, textures, and materials
+ *  SetViewPosition()
+ *
+ *  This method is used for setting the camera position the
+ *  translucent draws are sorted against, before each frame.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::SetViewPosition(const glm::vec3& viewPosition)
 {
-    LoadSceneTextures();
-    DefineObjectMaterials();
-    SetupSceneLights();
-
-    if (m_basicMeshes == NULL)
-        return;
-
-    m_basicMeshes->LoadPlaneMesh();
-    m_basicMeshes->LoadCylinderMesh();
-    m_basicMeshes->LoadTaperedCylinderMesh();
-    m_basicMeshes->LoadTorusMesh();
-    m_basicMeshes->LoadSphereMesh();
-    m_basicMeshes->LoadConeMesh();
-    m_basicMeshes->LoadBoxMesh();
-    m_basicMeshes->LoadPyramid3Mesh();
+    m_viewPosition = viewPosition;
 }
 
 /***********************************************************
- *  RenderScene()
+ *  DrawShapeMesh()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for drawing one of the basic shape
+ *  meshes by its ID, from the mesh pool when it is loaded.
+ *  ShapeMeshes has one tessellation, so the level is only
+ *  used with the pool.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::DrawShapeMesh(SHAPE_MESH mesh, int lod)
 {
-    if (m_basicMeshes == NULL)
+    if (m_pMeshPool != NULL && m_pMeshPool->IsLoaded())
     {
-        std::cerr << "ERROR: m_basicMeshes is null in RenderScene()." << std::endl;
+        m_pMeshPool->DrawMesh(m_poolMeshes[mesh][lod]);
         return;
     }
 
-    RenderTable();
-    RenderBackdrop();
-    RenderPercolator();
-    RenderCoffeeCup();
-    RenderBook();
-    RenderTray();
-    RenderFlowerPot();
-   
+    switch (mesh)
+    {
+    case SHAPE_MESH_BOX:
+        m_basicMeshes->DrawBoxMesh();
+        break;
+    case SHAPE_MESH_CONE:
+        m_basicMeshes->DrawConeMesh();
+        break;
+    case SHAPE_MESH_CYLINDER:
+        m_basicMeshes->DrawCylinderMesh();
+        break;
+    case SHAPE_MESH_PLANE:
+        m_basicMeshes->DrawPlaneMesh();
+        break;
+    case SHAPE_MESH_PYRAMID3:
+        m_basicMeshes->DrawPyramid3Mesh();
+        break;
+    case SHAPE_MESH_SPHERE:
+        m_basicMeshes->DrawSphereMesh();
+        break;
+    case SHAPE_MESH_TAPERED_CYLINDER:
+        m_basicMeshes->DrawTaperedCylinderMesh();
+        break;
+    case SHAPE_MESH_TORUS:
+        m_basicMeshes->DrawTorusMesh();
+        break;
+    default:
+        break;
+    }
 }
 
 /***********************************************************
- * RenderTable()
- * Render the table with its material and texture
+ *  BuildDrawList()
+ *
+ *  This method is used for recording the draw commands of
+ *  every object once, after the scene graph and materials
+ *  exist. RenderScene() only replays the list.
  ***********************************************************/
-void SceneManager::RenderTable()
+void SceneManager::BuildDrawList()
 {
-    // Render the Round Table
-    glm::vec3 scaleXYZ = glm::vec3(15.0f, 0.0f, 15.0f);
-    glm::vec3 positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-
-    SetShaderMaterial("plate");
-    SetShaderTexture("roundtable");
-    SetTextureUVScale(1.0f, 1.0f);
-
-    m_basicMeshes->DrawCylinderMesh();
+    m_drawCommands.clear();
+
+    RecordTable();
+    RecordBackdrop();
+    RecordPercolator();
+    RecordCoffeeCup();
+    RecordBook();
+    RecordTray();
+    RecordFlowerPot();
+    DesignateOccluders();
+
+    // the state changes of the order the objects were recorded in
+    std::vector<uint64_t> recordedOrder(m_drawCommands.size());
+    for (size_t i = 0; i < recordedOrder.size(); i++)
+    {
+        recordedOrder[i] = static_cast<uint64_t>(i);
+    }
+    m_recordedOrderStats = CountDrawStateChanges(recordedOrder);
+    m_recordedOrderStats.drawCalls = static_cast<int>(m_drawCommands.size());
 }
 
 /***********************************************************
- * RenderBackdrop()
- * Render the backdrop with its material and texture
+ * RecordTable()
+ * Record the table with its material and texture
  ***********************************************************/
-void SceneManager::RenderBackdrop()
+void SceneManager::RecordTable()
 {
-    glm::vec3 scaleXYZ = glm::vec3(20.0f, 1.0f, 20.0f);
-    glm::vec3 positionXYZ = glm::vec3(0.0f, 20.0f, -10.0f);
-    SetTransformations(scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ);
-
-    SetShaderMaterial("backdrop");
-    SetShaderTexture("background");
-    SetTextureUVScale(1.0f, 1.0f);
-
-    m_basicMeshes->DrawPlaneMesh();
+    // Round Table
+    AddDrawCommand(m_sceneNodes.table, SHAPE_MESH_CYLINDER,
+        m_sceneMaterials.plate, m_sceneTextures.roundtable);
 }
 
 /***********************************************************
- * RenderPercolator()
- * Render the teapot/percolator with its material and texture
+ * RecordBackdrop()
+ * Record the backdrop with its material and texture
  ***********************************************************/
-void SceneManager::RenderPercolator()
+void SceneManager::RecordBackdrop()
 {
-    const float leftOffset = -2.5f;
+    AddDrawCommand(m_sceneNodes.backdrop, SHAPE_MESH_PLANE,
+        m_sceneMaterials.backdrop, m_sceneTextures.background);
+}
 
+/***********************************************************
+ * RecordPercolator()
+ * Record the teapot/percolator with its material and texture
+ ***********************************************************/
+void SceneManager::RecordPercolator()
+{
     // Body
-    glm::vec3 scaleXYZ = glm::vec3(1.2f, 3.0f, 1.2f);
-    glm::vec3 positionXYZ = glm::vec3(leftOffset, 0.0f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("glass");
-    SetShaderTexture("teapot");
-    SetTextureUVScale(1.0f, 1.0f);
-    m_basicMeshes->DrawTaperedCylinderMesh(1.0f, 1.2f, 3.0f);
-
+    AddDrawCommand(m_sceneNodes.percolatorBody, SHAPE_MESH_TAPERED_CYLINDER,
+        m_sceneMaterials.glass, m_sceneTextures.teapot);
     // Spout
-    scaleXYZ = glm::vec3(0.4f, 1.9f, 0.4f);
-    positionXYZ = glm::vec3(leftOffset + 0.9f, 0.4f, 0.0f);
-    SetTransformations(scaleXYZ, 30.0f, 90.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("glass");
-    SetShaderTexture("teapot");
-    m_basicMeshes->DrawTaperedCylinderMesh();
-
+    AddDrawCommand(m_sceneNodes.percolatorSpout, SHAPE_MESH_TAPERED_CYLINDER,
+        m_sceneMaterials.glass, m_sceneTextures.teapot);
     // Handle
-    scaleXYZ = glm::vec3(0.6f, 0.8f, 0.2f);
-    positionXYZ = glm::vec3(leftOffset - 0.9f, 1.8f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 90.0f, positionXYZ);
-    SetShaderMaterial("glass");
-    SetShaderTexture("teapot");
-    m_basicMeshes->DrawTorusMesh();
-
+    AddDrawCommand(m_sceneNodes.percolatorHandle, SHAPE_MESH_TORUS,
+        m_sceneMaterials.glass, m_sceneTextures.teapot);
     // Lid
-    scaleXYZ = glm::vec3(0.6f, 0.1f, 0.80f);
-    positionXYZ = glm::vec3(leftOffset, 3.0f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("glass");
-    SetShaderTexture("teapot");
-    m_basicMeshes->DrawCylinderMesh();
-
-    // Knob
-    scaleXYZ = glm::vec3(0.2f, 0.1f, 0.2f);
-    positionXYZ = glm::vec3(leftOffset, 3.1f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("wood");
-    m_basicMeshes->DrawCylinderMesh();
+    AddDrawCommand(m_sceneNodes.percolatorLid, SHAPE_MESH_CYLINDER,
+        m_sceneMaterials.glass, m_sceneTextures.teapot);
+    // Knob - wood, still textured like the rest of the percolator
+    AddDrawCommand(m_sceneNodes.percolatorKnob, SHAPE_MESH_CYLINDER,
+        m_sceneMaterials.wood, m_sceneTextures.teapot);
 }
 
 /***********************************************************
- * RenderCoffeeCup()
+ * RecordCoffeeCup()
  ***********************************************************/
-void SceneManager::RenderCoffeeCup()
+void SceneManager::RecordCoffeeCup()
 {
     // Cup body
-    glm::vec3 scaleXYZ = glm::vec3(1.1f, 1.0f, 1.2f);
-    glm::vec3 positionXYZ = glm::vec3(0.5f, 0.0f, 1.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("glass");
-    SetShaderTexture("cup");
-    SetTextureUVScale(1.0f, 1.0f);
-    m_basicMeshes->DrawCylinderMesh();
-
+    AddDrawCommand(m_sceneNodes.cupBody, SHAPE_MESH_CYLINDER,
+        m_sceneMaterials.glass, m_sceneTextures.cup);
     // Handle
-    scaleXYZ = glm::vec3(0.5f, 0.3f, 0.2f);
-    positionXYZ = glm::vec3(1.5f, 0.5f, 1.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 1.0f, positionXYZ);
-    SetShaderMaterial("glass");
-    SetShaderTexture("glasshandle");
-    m_basicMeshes->DrawTorusMesh();
-
+    AddDrawCommand(m_sceneNodes.cupHandle, SHAPE_MESH_TORUS,
+        m_sceneMaterials.glass, m_sceneTextures.glasshandle);
     // Coffee liquid
-    scaleXYZ = glm::vec3(1.1f, 0.01f, 1.2f);
-    positionXYZ = glm::vec3(0.5f, 1.0f, 1.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("liquid");
-    SetShaderTexture("coffee");
-    SetTextureUVScale(1.0f, 1.0f);
-    m_basicMeshes->DrawCylinderMesh();
-}
-
-/***********************************************************
- * Helper: RenderBookSection()
- * CS-499 Enhancement - removes duplicated boilerplate
- ***********************************************************/
-void SceneManager::RenderBookSection(
-    const glm::vec3& scaleXYZ,
-    const glm::vec3& positionXYZ,
-    const std::string& materialTag,
-    const std::string& textureTag)
-{
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial(materialTag);
-    SetShaderTexture(textureTag);
-    SetTextureUVScale(1.0f, 1.0f);
-    m_basicMeshes->DrawBoxMesh();
+    AddDrawCommand(m_sceneNodes.cupLiquid, SHAPE_MESH_CYLINDER,
+        m_sceneMaterials.liquid, m_sceneTextures.coffee);
 }
 
-
-
 /***********************************************************
- * RenderBook()
+ * RecordBook()
  ***********************************************************/
-void SceneManager::RenderBook()
+void SceneManager::RecordBook()
 {
-    float gap = 0.02f;   // Small gap between books
-    float tableHeight = 0.2f;    // Height of the table
-    float diagonalOffset = 0.5f;  // Amount to shift diagonally (x and z)
-
-    // First book (bottom)
-    RenderBookSection(
-        glm::vec3(3.5f, 0.3f, 2.5f),
-        glm::vec3(-6.0f + diagonalOffset, tableHeight, 5.0f + diagonalOffset),
-        "cover",
-        "book");
-
-    RenderBookSection(
-        glm::vec3(3.53f, 0.23f, 2.3f),
-        glm::vec3(-6.0f + diagonalOffset, tableHeight + 0.01f, 4.89f + diagonalOffset),
-        "pages",
-        "pages");
-
-    // Second book (middle)
-    RenderBookSection(
-        glm::vec3(3.5f, 0.3f, 2.5f),
-        glm::vec3(-6.0f + diagonalOffset, tableHeight + 0.3f + gap, 5.0f + diagonalOffset),
-        "cover",
-        "book");
-
-    RenderBookSection(
-        glm::vec3(3.53f, 0.23f, 2.3f),
-        glm::vec3(-6.0f + diagonalOffset, tableHeight + 0.33f + gap, 4.89f + diagonalOffset),
-        "pages",
-        "pages");
-
-    // Third book (top)
-    RenderBookSection(
-        glm::vec3(3.5f, 0.3f, 2.5f),
-        glm::vec3(-6.0f + diagonalOffset, tableHeight + 0.6f + 2 * gap, 5.0f + diagonalOffset),
-        "cover",
-        "book");
-
-    RenderBookSection(
-        glm::vec3(3.53f, 0.23f, 2.3f),
-        glm::vec3(-6.0f + diagonalOffset, tableHeight + 0.61f + 2 * gap, 4.89f + diagonalOffset),
-        "pages",
-        "pages");
+    // bottom to top, the cover of each book and then its pages
+    for (int i = 0; i < 3; i++)
+    {
+        AddDrawCommand(m_sceneNodes.bookCovers[i], SHAPE_MESH_BOX,
+            m_sceneMaterials.cover, m_sceneTextures.book);
+        AddDrawCommand(m_sceneNodes.bookPages[i], SHAPE_MESH_BOX,
+            m_sceneMaterials.pages, m_sceneTextures.pages);
+    }
 }
 
 /***********************************************************
- * RenderTray()
+ * RecordTray()
  ***********************************************************/
-void SceneManager::RenderTray()
+void SceneManager::RecordTray()
 {
     // Tray Base
-    glm::vec3 scaleXYZ = glm::vec3(8.0f, 0.05f, 5.0f);
-    glm::vec3 positionXYZ = glm::vec3(0.0f, 0.05f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("wood");
-    SetShaderTexture("table");
-    SetTextureUVScale(1.0f, 1.0f);
-    m_basicMeshes->DrawBoxMesh();
-
-    float edgeHeight = 0.3f;
-    float edgeThickness = 0.1f;
-
-    // Front edge
-    scaleXYZ = glm::vec3(8.1f, edgeHeight, edgeThickness);
-    positionXYZ = glm::vec3(0.0f, edgeHeight / 2.0f + 0.05f, -2.55f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    m_basicMeshes->DrawBoxMesh();
-
-    // Back edge
-    scaleXYZ = glm::vec3(8.1f, edgeHeight, edgeThickness);
-    positionXYZ = glm::vec3(0.0f, edgeHeight / 2.0f + 0.05f, 2.55f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    m_basicMeshes->DrawBoxMesh();
-
-    // Left edge
-    scaleXYZ = glm::vec3(edgeThickness, edgeHeight, 5.1f);
-    positionXYZ = glm::vec3(-4.05f, edgeHeight / 2.0f + 0.05f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    m_basicMeshes->DrawBoxMesh();
+    AddDrawCommand(m_sceneNodes.trayBase, SHAPE_MESH_BOX,
+        m_sceneMaterials.wood, m_sceneTextures.table);
 
-    // Right edge
-    scaleXYZ = glm::vec3(edgeThickness, edgeHeight, 5.1f);
-    positionXYZ = glm::vec3(4.05f, edgeHeight / 2.0f + 0.05f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    m_basicMeshes->DrawBoxMesh();
+    // Front, back, left and right edges, finished like the base
+    for (int i = 0; i < 4; i++)
+    {
+        AddDrawCommand(m_sceneNodes.trayEdges[i], SHAPE_MESH_BOX,
+            m_sceneMaterials.wood, m_sceneTextures.table);
+    }
 }
 
 /***********************************************************
- * RenderFlowerPot()
+ * RecordFlowerPot()
  ***********************************************************/
-void SceneManager::RenderFlowerPot()
+void SceneManager::RecordFlowerPot()
 {
-    // Pot body
-    glm::vec3 scaleXYZ = glm::vec3(0.8f, 0.6f, 0.8f);
-    glm::vec3 positionXYZ = glm::vec3(-7.0f, 0.0f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("glass");   // using glass material for stylized look
-    SetShaderTexture("teapot");
-    SetTextureUVScale(1.0f, 1.0f);
-    m_basicMeshes->DrawCylinderMesh();
-
+    // Pot body - using glass material for stylized look
+    AddDrawCommand(m_sceneNodes.potBody, SHAPE_MESH_CYLINDER,
+        m_sceneMaterials.glass, m_sceneTextures.teapot);
     // Soil
-    scaleXYZ = glm::vec3(0.7f, 0.05f, 0.7f);
-    positionXYZ = glm::vec3(-7.0f, 0.56f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("soil");
-    SetShaderTexture("soiltexture");
-    SetTextureUVScale(1.0f, 1.0f);
-    m_basicMeshes->DrawCylinderMesh();
-
+    AddDrawCommand(m_sceneNodes.potSoil, SHAPE_MESH_CYLINDER,
+        m_sceneMaterials.soil, m_sceneTextures.soiltexture);
     // Plant sphere
-    scaleXYZ = glm::vec3(0.5f, 0.5f, 0.5f);
-    positionXYZ = glm::vec3(-7.0f, 0.8f, 0.0f);
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderMaterial("leaf");
-    SetShaderTexture("leaftexture");
-    SetTextureUVScale(1.0f, 1.0f);
-    m_basicMeshes->DrawSphereMesh();
+    AddDrawCommand(m_sceneNodes.potPlant, SHAPE_MESH_SPHERE,
+        m_sceneMaterials.leaf, m_sceneTextures.leaftexture);
 }
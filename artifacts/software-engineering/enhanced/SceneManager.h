@@ -14,8 +14,22 @@
 #include <unordered_map>
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "BoundingVolumeHierarchy.h"
+#include "Culling.h"
+#include "MeshPool.h"
+#include "OcclusionBuffer.h"
+#include "SceneGraph.h"
+#include "ThreadPool.h"
+#include "TagTable.h"
+#include "TextureCache.h"
+#include "TextureSource.h"
+#include "TextureUploadRing.h"
+#include "UniformCache.h"
+#include <chrono>
+#include <future>
 #include <glm/glm.hpp>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint> // For uint32_t
 
@@ -36,7 +50,36 @@ public:
     struct TEXTURE_INFO
     {
         std::string tag;
+        uint32_t tagID;         // interned tag
+        std::string filename;   // image file, reloaded after an eviction
+        uint32_t ID;        // OpenGL texture array holding this texture
+        int arrayIndex;     // index into m_textureArrays (also its texture unit)
+        int layer;          // layer inside the texture array, -1 while evicted
+        size_t byteCount;   // GPU memory of the layer, all mip levels
+        int baseLevel;      // finest mip level uploaded so far
+        uint64_t lastUsedFrame;
+        bool bResident;     // true once the pixels have been uploaded
+        bool bLoading;      // decode or upload in progress
+        bool bLoadFailed;   // the image could not be loaded, never retried
+        bool bTranslucent;  // some pixel has an alpha below 255, known once loaded
+        int sharedSlot;     // identical texture this tag uses instead, or -1
+    };
+
+    // Texture array shared by every texture with the same size and format;
+    // without texture arrays, a single GL_TEXTURE_2D holding one texture
+    struct TEXTURE_ARRAY
+    {
         uint32_t ID;
+        int width;
+        int height;
+        int levelCount;
+        GLenum internalFormat;
+        GLenum pixelFormat;         // source pixel layout, GL_RGB or GL_RGBA
+        COOKED_FORMAT cookedFormat; // raw or block-compressed levels
+        int layerCount;     // layers handed out so far
+        int layerCapacity;  // layers allocated on the GPU
+        std::vector<int> freeLayers;    // layers released by evicted textures
+        int baseLevel;      // GL_TEXTURE_BASE_LEVEL - finest level every resident layer has
     };
 
     struct OBJECT_MATERIAL
@@ -47,34 +90,346 @@ public:
         std::string tag;
     };
 
+    // Texture tag IDs used by the render methods, resolved once
+    struct SCENE_TEXTURES
+    {
+        uint32_t roundtable;
+        uint32_t background;
+        uint32_t teapot;
+        uint32_t cup;
+        uint32_t glasshandle;
+        uint32_t coffee;
+        uint32_t book;
+        uint32_t pages;
+        uint32_t table;
+        uint32_t soiltexture;
+        uint32_t leaftexture;
+    };
+
+    // Material handles used by the render methods, resolved once
+    struct SCENE_MATERIALS
+    {
+        int plate;
+        int backdrop;
+        int glass;
+        int wood;
+        int liquid;
+        int cover;
+        int pages;
+        int soil;
+        int leaf;
+    };
+
+    // Handles of the per-draw uniforms, resolved once per shader program.
+    // The shadowed ones skip uploads of the value the program already holds
+    struct SCENE_UNIFORMS
+    {
+        Uniform<glm::mat4> model;
+        ShadowedUniform<glm::vec4> objectColor;
+        ShadowedUniform<bool> bUseTexture;
+        Uniform<bool> bUseLighting;
+        ShadowedUniform<bool> bInstanced;
+        ShadowedUniform<bool> bMultiDraw;
+        ShadowedUniform<int> objectTextureArray;
+        ShadowedUniform<int> objectTextureLayer;
+        ShadowedUniform<int> objectTexture;
+        ShadowedUniform<glm::vec2> UVscale;
+        ShadowedUniform<int> materialIndex;
+        ShadowedUniform<glm::vec3> materialDiffuseColor;
+        ShadowedUniform<glm::vec3> materialSpecularColor;
+        ShadowedUniform<float> materialShininess;
+    };
+
+    // Scene graph nodes of the drawn parts, and of the compound objects they belong to
+    struct SCENE_NODES
+    {
+        int table;
+        int backdrop;
+        int percolator;
+        int percolatorBody;
+        int percolatorSpout;
+        int percolatorHandle;
+        int percolatorLid;
+        int percolatorKnob;
+        int cup;
+        int cupBody;
+        int cupHandle;
+        int cupLiquid;
+        int books;
+        int bookCovers[3];
+        int bookPages[3];
+        int tray;
+        int trayBase;
+        int trayEdges[4];
+        int flowerPot;
+        int potBody;
+        int potSoil;
+        int potPlant;
+    };
+
+    // Basic shape meshes a draw command can use
+    enum SHAPE_MESH
+    {
+        SHAPE_MESH_BOX,
+        SHAPE_MESH_CONE,
+        SHAPE_MESH_CYLINDER,
+        SHAPE_MESH_PLANE,
+        SHAPE_MESH_PYRAMID3,
+        SHAPE_MESH_SPHERE,
+        SHAPE_MESH_TAPERED_CYLINDER,
+        SHAPE_MESH_TORUS,
+        SHAPE_MESH_COUNT
+    };
+
+    // Tessellation levels of the round shapes, finest first
+    static const int SHAPE_LOD_COUNT = 3;
+
+    // One recorded draw: the model matrix is the world matrix of the scene
+    // graph node, so moving the node moves the draw without re-recording
+    struct DRAW_COMMAND
+    {
+        int node;
+        SHAPE_MESH mesh;
+        int materialHandle;
+        uint32_t textureTagID;
+        glm::vec2 UVscale;
+        bool bTranslucent;  // blended with the scene, drawn back to front after the opaque draws
+        bool bOccluder;     // rasterized into the occlusion buffer, and never tested against it
+    };
+
+    // Texture and mesh changes between consecutive draws of a draw order
+    struct DRAW_ORDER_STATS
+    {
+        int textureSwitches;
+        int meshSwitches;
+        int drawCalls;
+    };
+
+    // Draws kept and rejected by the view-frustum and occlusion tests in a frame
+    struct CULLING_STATS
+    {
+        int visibleDraws;
+        int culledDraws;
+        int occludedDraws;
+    };
+
+    // Triangles of the visible draws at their chosen tessellation levels
+    // and at full detail, and how many draws use each level, in a frame
+    struct LOD_STATS
+    {
+        int trianglesDrawn;
+        int fullDetailTriangles;
+        int levelDraws[SHAPE_LOD_COUNT];
+    };
+
+    // Shadowed uniform uploads sent and skipped in a frame
+    struct UNIFORM_UPLOAD_STATS
+    {
+        int sentUploads;
+        int elidedUploads;
+    };
+
+    // Image decoded (or read from the cache) on a worker thread, waiting for GL upload
+    struct DECODED_IMAGE
+    {
+        std::string filename;
+        COOKED_TEXTURE texture;
+        uint64_t contentHash;   // identifies identical pixels across files
+        double decodeMilliseconds;
+    };
+
+    // Texture whose image is still being decoded or waiting for upload space
+    struct PENDING_TEXTURE
+    {
+        uint32_t tagID;
+        std::future<DECODED_IMAGE> decodeResult;
+        DECODED_IMAGE image;
+        bool bDecoded;
+        int nextLevel;      // finest mip level uploaded so far, levelCount before the first upload
+    };
+
+    // Timing of the streamed scene texture load
+    struct TEXTURE_LOAD_STATS
+    {
+        std::chrono::steady_clock::time_point startTime;
+        double summedDecodeMilliseconds;    // per-image decode times added up, measured while overlapping
+        double uploadMilliseconds;
+        int cachedImages;
+        bool bReported;
+        bool bDrawableReported;
+    };
+
 private:
     // Pointer to shader manager object
     ShaderManager* m_pShaderManager;
+    // Uniform locations of the shader program, read once after it is linked
+    UniformCache* m_pUniformCache;
+    SCENE_UNIFORMS m_uniforms;
+    // Uploads of the frame being rendered, and of the last one reported
+    UNIFORM_UPLOAD_STATS m_uniformUploads;
+    UNIFORM_UPLOAD_STATS m_reportedUniformUploads;
     // Pointer to basic shapes object
     ShapeMeshes* m_basicMeshes;
-    // Total number of loaded textures
+    // Worker threads used for image decoding
+    ThreadPool* m_pThreadPool;
+    // Where the encoded image files are read from
+    TextureSource* m_pTextureSource;
+    // Cooked textures with precomputed mipmaps
+    TextureCache* m_pTextureCache;
+    // Persistently mapped staging buffer for texture uploads
+    TextureUploadRing* m_pUploadRing;
+    // Textures that are loading in the background
+    std::vector<PENDING_TEXTURE> m_pendingTextures;
+    TEXTURE_LOAD_STATS m_textureLoadStats;
+    // Total number of resident textures
     int m_loadedTextures;
+    // Frames rendered so far - dates every texture use
+    uint64_t m_frameIndex;
+    // GPU memory the resident textures may use, and use now
+    size_t m_textureBudgetBytes;
+    size_t m_residentTextureBytes;
+    int m_evictedTextures;
+    // Upload the mip tail first and the finer levels on later frames
+    bool m_bProgressiveTextures;
+    // Load textures on first use instead of when they are created
+    bool m_bLazyTextures;
+    // Repeat the scene texture load serially once it is done, to time the speedup
+    bool m_bSerialTextureBenchmark;
+    // Texture array holding the 1x1 placeholder in layer 0, or -1
+    int m_placeholderArray;
+    // Texture arrays (OpenGL 4.3), or one GL_TEXTURE_2D per texture
+    bool m_bTextureArrays;
+    // Duplicate images shared with an identical texture
+    int m_sharedTextures;
     // Loaded textures info
-    TEXTURE_INFO m_textureIDs[16];
-    // Defined object materials
+    std::vector<TEXTURE_INFO> m_textureIDs;
+    // Texture arrays grouping same-sized textures, one per texture unit
+    std::vector<TEXTURE_ARRAY> m_textureArrays;
+    // Transform hierarchy of the scene; world matrices are only rebuilt under moved nodes
+    SceneGraph* m_pSceneGraph;
+    SCENE_NODES m_sceneNodes;
+    // Draw commands recorded in PrepareScene() and replayed every frame
+    std::vector<DRAW_COMMAND> m_drawCommands;
+    // Sort keys of this frame's draws, and the radix sort's second buffer
+    std::vector<uint64_t> m_drawKeys;
+    std::vector<uint64_t> m_drawKeyScratch;
+    // Every basic shape in one shared vertex array, and the pool mesh ID of
+    // each shape at each tessellation level
+    MeshPool* m_pMeshPool;
+    int m_poolMeshes[SHAPE_MESH_COUNT][SHAPE_LOD_COUNT];
+    // Levels each shape has - 1 for the flat shapes - and their triangles
+    int m_shapeLodCounts[SHAPE_MESH_COUNT];
+    int m_shapeTriangles[SHAPE_MESH_COUNT][SHAPE_LOD_COUNT];
+    // Local bounding box of each basic shape
+    Culling::AABB m_shapeBounds[SHAPE_MESH_COUNT];
+    // World bounds of each draw command, refreshed when the scene graph changes
+    std::vector<Culling::WORLD_BOUNDS> m_drawBounds;
+    // Hierarchy over the world boxes of the draws, refit when they move,
+    // and its cost when it was last built
+    BoundingVolumeHierarchy* m_pDrawHierarchy;
+    std::vector<Culling::AABB> m_drawBoxes;
+    float m_drawHierarchyBuiltCost;
+    // Draws that passed the frustum and occlusion tests this frame
+    std::vector<int> m_visibleDraws;
+    // Tessellation level of each draw, kept between frames so a level only
+    // changes once the draw is clearly past the size it switches at
+    std::vector<int> m_drawLods;
+    LOD_STATS m_lodStats;
+    LOD_STATS m_reportedLodStats;
+    // CPU depth buffer the occluders are drawn into, the coarsest level of
+    // each shape drawn there, and this frame's occluders
+    OcclusionBuffer* m_pOcclusionBuffer;
+    ShapeGeometry::MESH_DATA m_occluderMeshes[SHAPE_MESH_COUNT];
+    std::vector<OcclusionBuffer::OCCLUDER> m_occluders;
+    bool m_bOcclusionCulling;
+    // View-projection matrix of the frame the draws are culled against
+    glm::mat4 m_viewProjection;
+    bool m_bViewProjection;
+    CULLING_STATS m_cullingStats;
+    CULLING_STATS m_reportedCullingStats;
+    // Instances of the batch being drawn
+    std::vector<MESH_INSTANCE> m_meshInstances;
+    // Indirect commands and per-draw data of the frame's multi-draw
+    std::vector<DRAW_ELEMENTS_INDIRECT_COMMAND> m_indirectCommands;
+    std::vector<MESH_DRAW> m_meshDraws;
+    // Camera position the translucent draws are sorted against
+    glm::vec3 m_viewPosition;
+    // State changes of the recorded and of the sorted draw order
+    DRAW_ORDER_STATS m_recordedOrderStats;
+    DRAW_ORDER_STATS m_sortedOrderStats;
+    DRAW_ORDER_STATS m_reportedOrderStats;
+    // Defined object materials, in material buffer order
     std::vector<OBJECT_MATERIAL> m_objectMaterials;
+    // Uniform buffer holding every material
+    GLuint m_materialBufferID;
+    // Materials are indexed in the uniform block, or set per draw for shaders without it
+    bool m_bMaterialBlock;
+    SCENE_MATERIALS m_sceneMaterials;
+    SCENE_TEXTURES m_sceneTextures;
+    // String tags interned into the IDs used by the lookup tables
+    TagTable* m_pTagTable;
 
-	// Fast lookup for texture and materias (enhancement for CS-499)
-	std::unordered_map<std::string, int>    m_textureSlotLookup; // tag -> texture slot
-	std::unordered_map<std::string, GLuint>     m_textureIdLookup; // tag -> OpengL texture ID
-	std::unordered_map<std::string, OBJECT_MATERIAL>    m_materialLookup; // tag -> material
+	// Fast lookup for texture and materias (enhancement for CS-499), indexed by tag ID
+	std::vector<int>    m_textureSlotByTag; // tag ID -> texture slot, -1 if none
+	std::vector<int>    m_materialHandleByTag; // tag ID -> material buffer index, -1 if none
+	std::unordered_map<uint64_t, int>   m_textureContentLookup; // pixel hash -> texture slot
 
     // Load texture images and convert to OpenGL texture data
-    bool CreateGLTexture(const char* filename, std::string tag);
+    bool CreateGLTexture(const char* filename, std::string_view tag);
+    // Read the size of an image from its header - safe to call from worker threads
+    bool ReadImageInfo(const char* filename, int& width, int& height, int& colorChannels) const;
+    // Decode an image file into memory - safe to call from worker threads
+    bool DecodeImage(const char* filename, DECODED_IMAGE& image) const;
+    // Load every scene texture the old way, one after another, and return the milliseconds
+    double MeasureSerialTextureLoad();
+    // Register a texture tag and the texture array for its size and format
+    int RegisterTexture(const char* filename, std::string_view tag, int width, int height, int colorChannels);
+    // Give a texture a layer in its texture array
+    void AcquireTextureLayer(int textureSlot);
+    // Release the layer of a texture, it reloads on its next use
+    void EvictTexture(int textureSlot);
+    // Point a tag at an identical texture and release its own layer
+    void ShareTexture(int textureSlot, int sharedSlot);
+    // Evict least recently used textures until the bytes fit the budget
+    bool MakeTextureRoom(size_t byteCount);
+    // Start loading a texture that is not resident in the background
+    bool RequestTexture(int textureSlot);
+    // Mark a texture as used in this frame, requesting it if evicted
+    void TouchTexture(int textureSlot);
+    // Choose texture arrays or single textures, before the first texture is created
+    void SelectTextureMode();
+    // Fall back from the preferred block compression to what the context supports
+    void SelectTextureCompression();
+    // Create the 1x1 texture drawn until a texture is resident
+    void CreatePlaceholderTexture();
+    // Create or grow the OpenGL storage of every texture array - GL thread only
+    void AllocateTextureArrays();
+    // Upload decoded mip levels into the layer reserved for the tag - GL thread only
+    bool UploadGLTexture(DECODED_IMAGE& image, uint32_t tagID, int firstLevel, int endLevel);
+    // Clamp sampling of a texture array to the levels all of its layers have
+    void UpdateArrayBaseLevel(int arrayIndex);
+    // Upload the background-loaded textures that are ready, within a per-frame budget
+    void PumpTextureUploads();
     // Bind loaded OpenGL textures to slots in memory
     void BindGLTextures();
     // Free the loaded OpenGL textures
     void DestroyGLTextures();
     // Find a loaded texture by tag
-    int FindTextureID(std::string tag);
-    int FindTextureSlot(std::string tag);
+    int FindTextureID(std::string_view tag);
+    int FindTextureSlot(std::string_view tag);
+    int FindTextureSlot(uint32_t tagID) const;
     // Find a defined material by tag
-    bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+    bool FindMaterial(std::string_view tag, OBJECT_MATERIAL& material);
+    // Find the material buffer index of a material by tag
+    int FindMaterialHandle(std::string_view tag);
+    // Pack the defined materials into the material uniform buffer
+    void UploadMaterialBuffer();
+    // Resolve the uniform handles when the shader program has changed
+    void ResolveUniforms();
+    // Count a shadowed uniform upload as sent or elided
+    void CountUniformUpload(bool bSent);
+    // Report the uniform uploads of the finished frame and start a new count
+    void ReportUniformUploads();
 
     // Set the transformation values into the transform buffer
     void SetTransformations(
@@ -84,6 +439,52 @@ private:
         float ZrotationDegrees,
         glm::vec3 positionXYZ);
 
+    // Append a draw to the retained draw list
+    void AddDrawCommand(
+        int node,
+        SHAPE_MESH mesh,
+        int materialHandle,
+        uint32_t textureTagID,
+        float uScale = 1.0f,
+        float vScale = 1.0f);
+    // Build every basic shape into the shared mesh pool - false if it could not be created
+    bool LoadMeshPool();
+    // Build a basic shape with the given number of slices around its round parts
+    void BuildShapeMesh(SHAPE_MESH mesh, int slices, ShapeGeometry::MESH_DATA& data) const;
+    // Draw a basic shape mesh by ID at a tessellation level
+    void DrawShapeMesh(SHAPE_MESH mesh, int lod);
+    // True if the loaded texture of a tag has pixels that are not fully opaque
+    bool IsTextureTranslucent(uint32_t textureTagID) const;
+    // Re-derive which draws blend and which occlude after a texture loads or goes
+    void UpdateDrawTranslucency();
+    // Draw the run of sorted commands starting at a key with one instanced
+    // call - returns the number of commands drawn, 0 if they cannot be batched
+    size_t DrawInstancedRun(size_t firstKey);
+    // Submit every sorted draw with one indirect multi-draw - false if the
+    // context or the shader cannot, and the draws must go one at a time
+    bool SubmitMultiDraw();
+    // Recompute the world bounds of every draw command and refit the hierarchy over them
+    void UpdateDrawBounds();
+    // Find the draws that are inside the view and not hidden behind the occluders
+    void CullDrawCommands();
+    // Choose the tessellation level of every visible draw from its size on screen
+    void SelectDrawLods();
+    // Build the state sort key of every visible draw command and radix sort them
+    void SortDrawCommands();
+    // Count the texture and mesh changes of a draw order given as sort keys
+    DRAW_ORDER_STATS CountDrawStateChanges(const std::vector<uint64_t>& drawKeys) const;
+    // Print the state changes of the sorted order against the recorded one
+    void ReportDrawOrder();
+    // Print the visible, culled and occluded draws when they change
+    void ReportCulling();
+    // Print the triangles drawn and the draws at each level when they change
+    void ReportLevelOfDetail();
+    // Mark the large opaque draws that hide the objects behind them
+    void DesignateOccluders();
+
+    // Set the world matrix of a scene graph node into the transform buffer
+    void SetNodeTransformation(int node);
+
     // Set the color values into the shader
     void SetShaderColor(
         float redColorValue,
@@ -93,7 +494,14 @@ private:
 
     // Set the texture data into the shader
     void SetShaderTexture(
-        std::string textureTag);
+        std::string_view textureTag);
+    // Pick the texture array and layer a draw samples for a tag - false if there is none
+    bool ResolveTextureLayer(uint32_t textureTagID, int& arrayIndex, int& layer);
+    // Point the draw's sampler at the texture unit of a texture array
+    void SetShaderTextureUnit(int arrayIndex);
+    // Set the texture of an interned tag - no string work per draw
+    void SetShaderTexture(
+        uint32_t textureTagID);
 
     // Set the UV scale for the texture mapping
     void SetTextureUVScale(
@@ -101,7 +509,10 @@ private:
 
     // Set the object material into the shaders
     void SetShaderMaterial(
-        std::string materialTag);
+        std::string_view materialTag);
+    // Select a material by handle - one integer uniform per draw
+    void SetShaderMaterial(
+        int materialHandle);
 
 public:
     // Prepare the 3D scene for rendering
@@ -109,26 +520,45 @@ public:
     // Render the objects in the 3D scene
     void RenderScene();
 
-    // Load all of the needed textures before rendering
+    // Start loading all of the needed textures in the background
     void LoadSceneTextures();
+    // Set the GPU memory budget for resident textures, in bytes
+    void SetTextureBudget(size_t budgetBytes);
+    // Stream textures mip tail first instead of all levels at once
+    void SetProgressiveTextures(bool bProgressive);
+    // Load textures the first time they are drawn instead of up front
+    void SetLazyTextures(bool bLazy);
+    // Time the old serial texture load after the scene load, for the speedup report
+    void SetSerialTextureBenchmark(bool bBenchmark);
+    // Set the camera position translucent objects are sorted against
+    void SetViewPosition(const glm::vec3& viewPosition);
+    // Set the view-projection matrix draws outside the view are culled against
+    void SetViewProjection(const glm::mat4& viewProjection);
+    // Test the draws against a CPU depth buffer of the large objects before submitting them
+    void SetOcclusionCulling(bool bOcclusionCulling);
+    // Visible, culled and occluded draws of the last rendered frame
+    const CULLING_STATS& GetCullingStats() const { return m_cullingStats; }
+    // Triangles and tessellation levels of the last rendered frame
+    const LOD_STATS& GetLodStats() const { return m_lodStats; }
+    // Scene graph node of the nearest draw a ray hits, or -1
+    int PickNode(const glm::vec3& origin, const glm::vec3& direction) const;
+    // Create the scene graph nodes of every object before rendering
+    void BuildSceneGraph();
+    // Record the draw commands of every object before rendering
+    void BuildDrawList();
     // Define all the object materials before rendering
     void DefineObjectMaterials();
     // Add and define the light sources before rendering
     void SetupSceneLights();
 
-    // Methods for rendering the individual objects in the 3D scene
-    void RenderTable();       // Rectangular table
-    void RenderPercolator();      // Coffee Percolator
-    void RenderBackdrop();    // Backdrop
-    void RenderBook();       // Books on the round table
-    void RenderCoffeeCup();   // Coffee cup on the round table
-    void RenderTray();          // Tray for Pot and Mug
-    void RenderFlowerPot();    // Small flower pot
-    void RenderBookSection(
-        const glm::vec3& scaleXYZ,
-        const glm::vec3& positionXYZ,
-        const std::string& materialTag,
-        const std::string& textureTag);
+    // Methods for recording the draws of the individual objects in the 3D scene
+    void RecordTable();       // Rectangular table
+    void RecordPercolator();      // Coffee Percolator
+    void RecordBackdrop();    // Backdrop
+    void RecordBook();       // Books on the round table
+    void RecordCoffeeCup();   // Coffee cup on the round table
+    void RecordTray();          // Tray for Pot and Mug
+    void RecordFlowerPot();    // Small flower pot
 
 
 
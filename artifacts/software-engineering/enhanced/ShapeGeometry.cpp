@@ -0,0 +1,280 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.cpp
+// ============
+// vertex and index data of the basic shapes, built on the CPU
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShapeGeometry.h"
+
+#include <cmath>
+
+namespace
+{
+    const float g_Pi = 3.14159265358979f;
+
+    // append one vertex and return its index in the mesh
+    uint32_t AddVertex(
+        ShapeGeometry::MESH_DATA& mesh,
+        float x, float y, float z,
+        float nx, float ny, float nz,
+        float u, float v)
+    {
+        uint32_t index = static_cast<uint32_t>(mesh.GetVertexCount());
+        const float vertex[ShapeGeometry::FLOATS_PER_VERTEX] = { x, y, z, nx, ny, nz, u, v };
+        mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + ShapeGeometry::FLOATS_PER_VERTEX);
+        return index;
+    }
+
+    void AddTriangle(ShapeGeometry::MESH_DATA& mesh, uint32_t a, uint32_t b, uint32_t c)
+    {
+        mesh.indices.push_back(a);
+        mesh.indices.push_back(b);
+        mesh.indices.push_back(c);
+    }
+
+    // append a flat shaded triangle, its normal taken from the winding
+    void AddFlatTriangle(ShapeGeometry::MESH_DATA& mesh, const float* p0, const float* p1, const float* p2)
+    {
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+
+        uint32_t a = AddVertex(mesh, p0[0], p0[1], p0[2], n[0], n[1], n[2], 0.0f, 0.0f);
+        uint32_t b = AddVertex(mesh, p1[0], p1[1], p1[2], n[0], n[1], n[2], 1.0f, 0.0f);
+        uint32_t c = AddVertex(mesh, p2[0], p2[1], p2[2], n[0], n[1], n[2], 0.5f, 1.0f);
+        AddTriangle(mesh, a, b, c);
+    }
+}
+
+/***********************************************************
+ *  BuildBox()
+ *
+ *  This method is used for building a unit box centered on
+ *  the origin, four vertices per face so every face has its
+ *  own normal and a full 0..1 texture square.
+ ***********************************************************/
+void ShapeGeometry::BuildBox(MESH_DATA& mesh)
+{
+    // face normal, then the face's right and up directions
+    const float faces[6][9] =
+    {
+        {  0.0f,  0.0f,  1.0f,    1.0f, 0.0f,  0.0f,    0.0f, 1.0f,  0.0f },   // front
+        {  0.0f,  0.0f, -1.0f,   -1.0f, 0.0f,  0.0f,    0.0f, 1.0f,  0.0f },   // back
+        { -1.0f,  0.0f,  0.0f,    0.0f, 0.0f,  1.0f,    0.0f, 1.0f,  0.0f },   // left
+        {  1.0f,  0.0f,  0.0f,    0.0f, 0.0f, -1.0f,    0.0f, 1.0f,  0.0f },   // right
+        {  0.0f,  1.0f,  0.0f,    1.0f, 0.0f,  0.0f,    0.0f, 0.0f, -1.0f },   // top
+        {  0.0f, -1.0f,  0.0f,    1.0f, 0.0f,  0.0f,    0.0f, 0.0f,  1.0f },   // bottom
+    };
+    const float corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+    for (int face = 0; face < 6; face++)
+    {
+        const float* normal = faces[face];
+        const float* right = faces[face] + 3;
+        const float* up = faces[face] + 6;
+
+        uint32_t firstVertex = static_cast<uint32_t>(mesh.GetVertexCount());
+        for (int corner = 0; corner < 4; corner++)
+        {
+            float u = corners[corner][0];
+            float v = corners[corner][1];
+            float position[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                position[axis] = 0.5f * normal[axis] + (u - 0.5f) * right[axis] + (v - 0.5f) * up[axis];
+            }
+            AddVertex(mesh, position[0], position[1], position[2], normal[0], normal[1], normal[2], u, v);
+        }
+
+        AddTriangle(mesh, firstVertex, firstVertex + 1, firstVertex + 2);
+        AddTriangle(mesh, firstVertex, firstVertex + 2, firstVertex + 3);
+    }
+}
+
+/***********************************************************
+ *  BuildPlane()
+ *
+ *  This method is used for building a 2x2 plane on the XZ
+ *  plane, facing up, with the texture stretched across it.
+ ***********************************************************/
+void ShapeGeometry::BuildPlane(MESH_DATA& mesh)
+{
+    uint32_t a = AddVertex(mesh, -1.0f, 0.0f,  1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+    uint32_t b = AddVertex(mesh,  1.0f, 0.0f,  1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f);
+    uint32_t c = AddVertex(mesh,  1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f);
+    uint32_t d = AddVertex(mesh, -1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+    AddTriangle(mesh, a, b, c);
+    AddTriangle(mesh, a, c, d);
+}
+
+/***********************************************************
+ *  BuildCylinder()
+ *
+ *  This method is used for building a cylinder standing on
+ *  the origin, one unit high. Different radii give the
+ *  tapered cylinder, and a top radius of zero the cone,
+ *  whose top cap is then left out. The side normals lean
+ *  with the slope of the side. The seam repeats its first
+ *  column of vertices so the texture wraps once around.
+ ***********************************************************/
+void ShapeGeometry::BuildCylinder(MESH_DATA& mesh, float bottomRadius, float topRadius, int slices)
+{
+    // the side normal is (cos, slope, sin) normalized
+    float slope = bottomRadius - topRadius;
+    float normalScale = 1.0f / std::sqrt(1.0f + slope * slope);
+
+    uint32_t firstSide = static_cast<uint32_t>(mesh.GetVertexCount());
+    for (int i = 0; i <= slices; i++)
+    {
+        float angle = 2.0f * g_Pi * i / slices;
+        float c = std::cos(angle);
+        float s = std::sin(angle);
+        float u = static_cast<float>(i) / slices;
+        AddVertex(mesh, bottomRadius * c, 0.0f, bottomRadius * s, c * normalScale, slope * normalScale, s * normalScale, u, 0.0f);
+        AddVertex(mesh, topRadius * c, 1.0f, topRadius * s, c * normalScale, slope * normalScale, s * normalScale, u, 1.0f);
+    }
+    for (int i = 0; i < slices; i++)
+    {
+        uint32_t bottom = firstSide + 2 * i;
+        uint32_t top = bottom + 1;
+        AddTriangle(mesh, bottom, top, top + 2);
+        AddTriangle(mesh, bottom, top + 2, bottom + 2);
+    }
+
+    // caps: a center vertex fanned out to a ring with the cap's normal
+    for (int cap = 0; cap < 2; cap++)
+    {
+        float radius = (cap == 0) ? bottomRadius : topRadius;
+        if (radius <= 0.0f)
+        {
+            continue;
+        }
+        float y = static_cast<float>(cap);
+        float ny = (cap == 0) ? -1.0f : 1.0f;
+
+        uint32_t center = AddVertex(mesh, 0.0f, y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+        for (int i = 0; i <= slices; i++)
+        {
+            float angle = 2.0f * g_Pi * i / slices;
+            float c = std::cos(angle);
+            float s = std::sin(angle);
+            AddVertex(mesh, radius * c, y, radius * s, 0.0f, ny, 0.0f, 0.5f + 0.5f * c, 0.5f + 0.5f * s);
+        }
+        for (uint32_t i = 0; i < static_cast<uint32_t>(slices); i++)
+        {
+            if (cap == 0)
+            {
+                AddTriangle(mesh, center, center + 1 + i, center + 2 + i);
+            }
+            else
+            {
+                AddTriangle(mesh, center, center + 2 + i, center + 1 + i);
+            }
+        }
+    }
+}
+
+/***********************************************************
+ *  BuildSphere()
+ *
+ *  This method is used for building a unit sphere from
+ *  rings of latitude, top to bottom, with the texture
+ *  wrapped around it once.
+ ***********************************************************/
+void ShapeGeometry::BuildSphere(MESH_DATA& mesh, int stacks, int slices)
+{
+    uint32_t firstVertex = static_cast<uint32_t>(mesh.GetVertexCount());
+    for (int stack = 0; stack <= stacks; stack++)
+    {
+        float polar = g_Pi * stack / stacks;
+        float y = std::cos(polar);
+        float ringRadius = std::sin(polar);
+        for (int i = 0; i <= slices; i++)
+        {
+            float angle = 2.0f * g_Pi * i / slices;
+            float x = ringRadius * std::cos(angle);
+            float z = ringRadius * std::sin(angle);
+            AddVertex(mesh, x, y, z, x, y, z,
+                static_cast<float>(i) / slices, 1.0f - static_cast<float>(stack) / stacks);
+        }
+    }
+
+    uint32_t ringSize = static_cast<uint32_t>(slices + 1);
+    for (uint32_t stack = 0; stack < static_cast<uint32_t>(stacks); stack++)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(slices); i++)
+        {
+            uint32_t upper = firstVertex + stack * ringSize + i;
+            uint32_t lower = upper + ringSize;
+            AddTriangle(mesh, upper, upper + 1, lower + 1);
+            AddTriangle(mesh, upper, lower + 1, lower);
+        }
+    }
+}
+
+/***********************************************************
+ *  BuildTorus()
+ *
+ *  This method is used for building a torus whose ring
+ *  circles the Z axis. Both the ring and the tube repeat
+ *  their first vertex so the texture wraps once each way.
+ ***********************************************************/
+void ShapeGeometry::BuildTorus(MESH_DATA& mesh, float mainRadius, float tubeRadius, int mainSlices, int tubeSlices)
+{
+    uint32_t firstVertex = static_cast<uint32_t>(mesh.GetVertexCount());
+    for (int i = 0; i <= mainSlices; i++)
+    {
+        float mainAngle = 2.0f * g_Pi * i / mainSlices;
+        float mc = std::cos(mainAngle);
+        float ms = std::sin(mainAngle);
+        for (int j = 0; j <= tubeSlices; j++)
+        {
+            float tubeAngle = 2.0f * g_Pi * j / tubeSlices;
+            float nx = std::cos(tubeAngle) * mc;
+            float ny = std::cos(tubeAngle) * ms;
+            float nz = std::sin(tubeAngle);
+            AddVertex(mesh,
+                mainRadius * mc + tubeRadius * nx, mainRadius * ms + tubeRadius * ny, tubeRadius * nz,
+                nx, ny, nz,
+                static_cast<float>(i) / mainSlices, static_cast<float>(j) / tubeSlices);
+        }
+    }
+
+    uint32_t ringSize = static_cast<uint32_t>(tubeSlices + 1);
+    for (uint32_t i = 0; i < static_cast<uint32_t>(mainSlices); i++)
+    {
+        for (uint32_t j = 0; j < static_cast<uint32_t>(tubeSlices); j++)
+        {
+            uint32_t current = firstVertex + i * ringSize + j;
+            uint32_t next = current + ringSize;
+            AddTriangle(mesh, current, next, next + 1);
+            AddTriangle(mesh, current, next + 1, current + 1);
+        }
+    }
+}
+
+/***********************************************************
+ *  BuildPyramid3()
+ *
+ *  This method is used for building a pyramid with a
+ *  triangular base at the bottom of the unit box and its
+ *  apex at the top, every face flat shaded.
+ ***********************************************************/
+void ShapeGeometry::BuildPyramid3(MESH_DATA& mesh)
+{
+    const float left[3] = { -0.5f, -0.5f, 0.5f };
+    const float right[3] = { 0.5f, -0.5f, 0.5f };
+    const float back[3] = { 0.0f, -0.5f, -0.5f };
+    const float apex[3] = { 0.0f, 0.5f, 0.0f };
+
+    AddFlatTriangle(mesh, left, right, apex);
+    AddFlatTriangle(mesh, right, back, apex);
+    AddFlatTriangle(mesh, back, left, apex);
+    AddFlatTriangle(mesh, left, back, right);
+}
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.h
+// ============
+// vertex and index data of the basic shapes, built on the CPU
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  ShapeGeometry
+ *
+ *  These functions build the basic shapes with the vertex
+ *  layout of ShapeMeshes - interleaved position, normal and
+ *  texture coordinate - into plain arrays, so any number of
+ *  shapes can be packed into one shared vertex and index
+ *  buffer. They make no GL calls. The sizes are the ones
+ *  the scene's transforms assume for ShapeMeshes; nothing
+ *  reads them back from it, so a change to its shapes must
+ *  be repeated here and in SceneManager::BuildShapeMesh().
+ ***********************************************************/
+namespace ShapeGeometry
+{
+    // Floats per vertex: position, normal, texture coordinate
+    const int FLOATS_PER_VERTEX = 8;
+
+    // Interleaved vertices, and triangle indices counted from the first vertex
+    struct MESH_DATA
+    {
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+
+        size_t GetVertexCount() const { return vertices.size() / FLOATS_PER_VERTEX; }
+    };
+
+    // Unit box centered on the origin
+    void BuildBox(MESH_DATA& mesh);
+    // 2x2 plane in XZ facing +Y
+    void BuildPlane(MESH_DATA& mesh);
+    // Capped cylinder from y = 0 to 1; a top radius of 0 makes a cone
+    void BuildCylinder(MESH_DATA& mesh, float bottomRadius, float topRadius, int slices);
+    // Unit radius sphere centered on the origin
+    void BuildSphere(MESH_DATA& mesh, int stacks, int slices);
+    // Torus around the Z axis, so the ring stands in the XY plane
+    void BuildTorus(MESH_DATA& mesh, float mainRadius, float tubeRadius, int mainSlices, int tubeSlices);
+    // Three sided pyramid in the unit box
+    void BuildPyramid3(MESH_DATA& mesh);
+}
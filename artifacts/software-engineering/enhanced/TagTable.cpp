@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagtable.cpp
+// ============
+// interning of string tags into small, stable integer IDs
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TagTable.h"
+
+/***********************************************************
+ *  Intern()
+ *
+ *  This method is used for getting the ID of a tag. A new
+ *  tag is copied once into the table and gets the next ID.
+ ***********************************************************/
+uint32_t TagTable::Intern(std::string_view name)
+{
+    auto it = m_ids.find(name);
+    if (it != m_ids.end())
+    {
+        return it->second;
+    }
+
+    uint32_t tagID = static_cast<uint32_t>(m_names.size());
+    m_names.emplace_back(name);
+    m_ids.emplace(std::string_view(m_names.back()), tagID);
+    return tagID;
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for getting the ID of a tag without
+ *  adding it.
+ ***********************************************************/
+uint32_t TagTable::Find(std::string_view name) const
+{
+    auto it = m_ids.find(name);
+    if (it != m_ids.end())
+    {
+        return it->second;
+    }
+    return INVALID_TAG;
+}
@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagtable.h
+// ============
+// interning of string tags into small, stable integer IDs
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// ID returned for a tag that was never interned
+const uint32_t INVALID_TAG = 0xFFFFFFFF;
+
+/***********************************************************
+ *  TagTable
+ *
+ *  This class turns texture and material tags into dense
+ *  32-bit IDs, 0, 1, 2, ... in the order they are first
+ *  seen, so per-tag data can live in plain vectors indexed
+ *  by ID. Lookups take a string_view and never allocate.
+ *  It is meant for the GL thread and is not thread-safe.
+ ***********************************************************/
+class TagTable
+{
+public:
+    // Get the ID of a tag, adding it if it is new
+    uint32_t Intern(std::string_view name);
+    // Get the ID of a tag - INVALID_TAG if it was never interned
+    uint32_t Find(std::string_view name) const;
+
+    // Name of an interned tag
+    const std::string& GetName(uint32_t tagID) const { return m_names[tagID]; }
+    // Number of interned tags
+    size_t GetCount() const { return m_names.size(); }
+
+private:
+    // a deque never moves its elements, so the map keys stay valid
+    std::deque<std::string> m_names;
+    std::unordered_map<std::string_view, uint32_t> m_ids;
+};
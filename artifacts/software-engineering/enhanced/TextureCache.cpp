@@ -0,0 +1,451 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// on-disk cache of decoded texture images with a precomputed mip chain
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+#include "BlockCompression.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace
+{
+    // "TXCK" in little-endian byte order
+    const uint32_t g_CacheMagic = 0x4B435854;
+    // bump whenever the file layout or pixel processing changes
+    const uint32_t g_CacheVersion = 3;
+    // pixel rows are stored bottom-up, as stb_image returns them when flipping
+    const uint32_t g_FlagFlippedVertically = 0x1;
+    // some source pixel is not fully opaque
+    const uint32_t g_FlagTranslucent = 0x2;
+    // every level starts on this boundary inside the file
+    const size_t g_LevelAlignment = 16;
+
+    struct CACHE_HEADER
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t pathHash;
+        uint64_t fileSize;
+        int64_t modifiedTime;
+        uint32_t flags;
+        int32_t width;
+        int32_t height;
+        int32_t colorChannels;
+        uint32_t levelCount;
+        uint32_t format;
+    };
+
+    struct CACHE_LEVEL
+    {
+        int32_t width;
+        int32_t height;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // 64-bit FNV-1a hash of a string
+    uint64_t HashString(const char* text)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (const char* p = text; *p != '\0'; p++)
+        {
+            hash ^= static_cast<unsigned char>(*p);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // true if any pixel of an RGBA image has an alpha below 255
+    bool HasTranslucentPixels(const unsigned char* pixels, int width, int height, int colorChannels)
+    {
+        if (colorChannels != 4)
+        {
+            return false;
+        }
+        size_t pixelCount = static_cast<size_t>(width) * height;
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            if (pixels[i * 4 + 3] < 255)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // 2x2 box filter from one mip level to the next, clamping at odd edges
+    void DownsampleLevel(const unsigned char* src, int srcWidth, int srcHeight,
+        unsigned char* dst, int dstWidth, int dstHeight, int channels)
+    {
+        for (int y = 0; y < dstHeight; y++)
+        {
+            int y0 = y * 2;
+            int y1 = (y0 + 1 < srcHeight) ? y0 + 1 : y0;
+
+            for (int x = 0; x < dstWidth; x++)
+            {
+                int x0 = x * 2;
+                int x1 = (x0 + 1 < srcWidth) ? x0 + 1 : x0;
+
+                const unsigned char* p00 = src + (static_cast<size_t>(y0) * srcWidth + x0) * channels;
+                const unsigned char* p10 = src + (static_cast<size_t>(y0) * srcWidth + x1) * channels;
+                const unsigned char* p01 = src + (static_cast<size_t>(y1) * srcWidth + x0) * channels;
+                const unsigned char* p11 = src + (static_cast<size_t>(y1) * srcWidth + x1) * channels;
+                unsigned char* out = dst + (static_cast<size_t>(y) * dstWidth + x) * channels;
+
+                for (int c = 0; c < channels; c++)
+                {
+                    out[c] = static_cast<unsigned char>((p00[c] + p10[c] + p01[c] + p11[c] + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+/***********************************************************
+ *  TextureCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureCache::TextureCache(const std::string& cacheDirectory, TEXTURE_COMPRESSION compression)
+{
+    m_cacheDirectory = cacheDirectory;
+    m_compression = compression;
+}
+
+/***********************************************************
+ *  SetCompression()
+ *
+ *  This method is used for changing the block compression
+ *  once the supported formats are known. It is not safe to
+ *  call while worker threads use the cache; entries cooked
+ *  to another format are re-cooked when next loaded.
+ ***********************************************************/
+void TextureCache::SetCompression(TEXTURE_COMPRESSION compression)
+{
+    m_compression = compression;
+}
+
+/***********************************************************
+ *  GetCookedFormat()
+ *
+ *  This method is used for choosing the format an image is
+ *  cooked to. Only sizes that are a multiple of the 4x4
+ *  block are compressed, so every level can be uploaded as
+ *  whole blocks; anything else stays uncompressed. The
+ *  result only depends on the image header, which lets the
+ *  texture storage be allocated before the image is decoded.
+ ***********************************************************/
+COOKED_FORMAT TextureCache::GetCookedFormat(int width, int height, int colorChannels) const
+{
+    if (m_compression == TEXTURE_COMPRESSION_NONE || (width % 4) != 0 || (height % 4) != 0)
+    {
+        return COOKED_FORMAT_RAW;
+    }
+
+    if (colorChannels == 3)
+    {
+        return COOKED_FORMAT_BC1;
+    }
+    if (colorChannels == 4)
+    {
+        return (m_compression == TEXTURE_COMPRESSION_BC1_BC7) ? COOKED_FORMAT_BC7 : COOKED_FORMAT_BC3;
+    }
+    return COOKED_FORMAT_RAW;
+}
+
+/***********************************************************
+ *  GetSourceKey()
+ *
+ *  This method is used for reading the path hash, size and
+ *  last write time of a source image.
+ ***********************************************************/
+bool TextureCache::GetSourceKey(const char* sourceFilename, SOURCE_KEY& key)
+{
+    std::error_code error;
+    std::filesystem::path sourcePath(sourceFilename);
+
+    uintmax_t fileSize = std::filesystem::file_size(sourcePath, error);
+    if (error)
+    {
+        return false;
+    }
+
+    std::filesystem::file_time_type modifiedTime = std::filesystem::last_write_time(sourcePath, error);
+    if (error)
+    {
+        return false;
+    }
+
+    key.pathHash = HashString(sourceFilename);
+    key.fileSize = static_cast<uint64_t>(fileSize);
+    key.modifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+    return true;
+}
+
+/***********************************************************
+ *  GetEntryPath()
+ *
+ *  This method is used for building the cache file name of
+ *  a source image. The name only depends on the path, so a
+ *  re-cooked image replaces its stale entry.
+ ***********************************************************/
+std::string TextureCache::GetEntryPath(const SOURCE_KEY& key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tex", static_cast<unsigned long long>(key.pathHash));
+    return (std::filesystem::path(m_cacheDirectory) / name).string();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for mapping the cache entry of the
+ *  passed in source image. The entry is rejected if it is
+ *  truncated, from another version, or if the source image
+ *  changed since it was cooked.
+ ***********************************************************/
+bool TextureCache::Load(const char* sourceFilename, COOKED_TEXTURE& texture) const
+{
+    SOURCE_KEY key;
+    if (!GetSourceKey(sourceFilename, key))
+    {
+        return false;
+    }
+
+    FileMapping mapping;
+    if (!mapping.Open(GetEntryPath(key).c_str(), true) || mapping.GetSize() < sizeof(CACHE_HEADER))
+    {
+        return false;
+    }
+
+    CACHE_HEADER header;
+    std::memcpy(&header, mapping.GetData(), sizeof(header));
+
+    if (header.magic != g_CacheMagic ||
+        header.version != g_CacheVersion ||
+        header.pathHash != key.pathHash ||
+        header.fileSize != key.fileSize ||
+        header.modifiedTime != key.modifiedTime ||
+        (header.flags & ~g_FlagTranslucent) != g_FlagFlippedVertically ||
+        header.format != static_cast<uint32_t>(GetCookedFormat(header.width, header.height, header.colorChannels)) ||
+        header.levelCount == 0 ||
+        mapping.GetSize() < sizeof(CACHE_HEADER) + header.levelCount * sizeof(CACHE_LEVEL))
+    {
+        return false;
+    }
+
+    texture.width = header.width;
+    texture.height = header.height;
+    texture.colorChannels = header.colorChannels;
+    texture.format = static_cast<COOKED_FORMAT>(header.format);
+    texture.bTranslucent = (header.flags & g_FlagTranslucent) != 0;
+    texture.levels.clear();
+    texture.levels.reserve(header.levelCount);
+
+    const unsigned char* pLevelTable = mapping.GetData() + sizeof(CACHE_HEADER);
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+        CACHE_LEVEL level;
+        std::memcpy(&level, pLevelTable + i * sizeof(CACHE_LEVEL), sizeof(level));
+
+        // defensive check: never hand out pixels past the end of the file
+        if (level.offset + level.size > mapping.GetSize())
+        {
+            return false;
+        }
+
+        texture.levels.push_back({ level.width, level.height,
+            static_cast<size_t>(level.offset), static_cast<size_t>(level.size) });
+    }
+
+    texture.storage.clear();
+    texture.mapping = std::move(mapping);
+    texture.bFromCache = true;
+    return true;
+}
+
+/***********************************************************
+ *  Cook()
+ *
+ *  This method is used for generating the complete mip chain
+ *  of freshly decoded pixels on the CPU, block-compressing
+ *  every level when the cache is configured to, and writing
+ *  the result to the cache. The texture is usable even if
+ *  the write fails.
+ ***********************************************************/
+bool TextureCache::Cook(const char* sourceFilename, const unsigned char* pixels,
+    int width, int height, int colorChannels, COOKED_TEXTURE& texture) const
+{
+    if (pixels == NULL || width <= 0 || height <= 0 || colorChannels <= 0)
+    {
+        return false;
+    }
+
+    COOKED_FORMAT format = GetCookedFormat(width, height, colorChannels);
+
+    // lay out every level the way glGenerateMipmap would produce them
+    CACHE_HEADER header = {};
+    header.magic = g_CacheMagic;
+    header.version = g_CacheVersion;
+    header.flags = g_FlagFlippedVertically;
+    if (HasTranslucentPixels(pixels, width, height, colorChannels))
+    {
+        header.flags |= g_FlagTranslucent;
+    }
+    header.width = width;
+    header.height = height;
+    header.colorChannels = colorChannels;
+    header.format = static_cast<uint32_t>(format);
+
+    std::vector<CACHE_LEVEL> rawLevels;
+    std::vector<CACHE_LEVEL> levelTable;
+    size_t rawOffset = 0;
+    int levelWidth = width;
+    int levelHeight = height;
+    while (true)
+    {
+        CACHE_LEVEL level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.offset = rawOffset;
+        level.size = static_cast<uint64_t>(levelWidth) * levelHeight * colorChannels;
+        rawLevels.push_back(level);
+        rawOffset += static_cast<size_t>(level.size);
+
+        switch (format)
+        {
+        case COOKED_FORMAT_BC1:
+            level.size = BlockCompression::GetEncodedSize(levelWidth, levelHeight, BlockCompression::BC1_BLOCK_BYTES);
+            break;
+        case COOKED_FORMAT_BC3:
+            level.size = BlockCompression::GetEncodedSize(levelWidth, levelHeight, BlockCompression::BC3_BLOCK_BYTES);
+            break;
+        case COOKED_FORMAT_BC7:
+            level.size = BlockCompression::GetEncodedSize(levelWidth, levelHeight, BlockCompression::BC7_BLOCK_BYTES);
+            break;
+        default:
+            break;
+        }
+        levelTable.push_back(level);
+
+        if (levelWidth == 1 && levelHeight == 1)
+        {
+            break;
+        }
+        levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+        levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+    }
+    header.levelCount = static_cast<uint32_t>(levelTable.size());
+
+    // the mips are always filtered from uncompressed pixels
+    std::vector<unsigned char> rawPixels(rawOffset);
+    std::memcpy(rawPixels.data(), pixels, static_cast<size_t>(rawLevels[0].size));
+    for (size_t i = 1; i < rawLevels.size(); i++)
+    {
+        DownsampleLevel(
+            rawPixels.data() + rawLevels[i - 1].offset, rawLevels[i - 1].width, rawLevels[i - 1].height,
+            rawPixels.data() + rawLevels[i].offset, rawLevels[i].width, rawLevels[i].height,
+            colorChannels);
+    }
+
+    size_t fileOffset = AlignUp(sizeof(CACHE_HEADER) + levelTable.size() * sizeof(CACHE_LEVEL), g_LevelAlignment);
+    for (CACHE_LEVEL& level : levelTable)
+    {
+        level.offset = fileOffset;
+        fileOffset = AlignUp(fileOffset + static_cast<size_t>(level.size), g_LevelAlignment);
+    }
+
+    // the owned buffer mirrors the file layout so level offsets are shared
+    texture.mapping.Close();
+    texture.storage.assign(fileOffset, 0);
+    texture.width = width;
+    texture.height = height;
+    texture.colorChannels = colorChannels;
+    texture.format = format;
+    texture.bFromCache = false;
+    texture.bTranslucent = (header.flags & g_FlagTranslucent) != 0;
+    texture.levels.clear();
+
+    for (size_t i = 0; i < levelTable.size(); i++)
+    {
+        const unsigned char* pSource = rawPixels.data() + rawLevels[i].offset;
+        unsigned char* pTarget = texture.storage.data() + levelTable[i].offset;
+
+        switch (format)
+        {
+        case COOKED_FORMAT_BC1:
+            BlockCompression::EncodeBC1(pSource, rawLevels[i].width, rawLevels[i].height, colorChannels, pTarget);
+            break;
+        case COOKED_FORMAT_BC3:
+            BlockCompression::EncodeBC3(pSource, rawLevels[i].width, rawLevels[i].height, colorChannels, pTarget);
+            break;
+        case COOKED_FORMAT_BC7:
+            BlockCompression::EncodeBC7(pSource, rawLevels[i].width, rawLevels[i].height, colorChannels, pTarget);
+            break;
+        default:
+            std::memcpy(pTarget, pSource, static_cast<size_t>(levelTable[i].size));
+            break;
+        }
+
+        texture.levels.push_back({ levelTable[i].width, levelTable[i].height,
+            static_cast<size_t>(levelTable[i].offset), static_cast<size_t>(levelTable[i].size) });
+    }
+
+    SOURCE_KEY key;
+    if (!GetSourceKey(sourceFilename, key))
+    {
+        return true;
+    }
+    header.pathHash = key.pathHash;
+    header.fileSize = key.fileSize;
+    header.modifiedTime = key.modifiedTime;
+
+    std::memcpy(texture.storage.data(), &header, sizeof(header));
+    std::memcpy(texture.storage.data() + sizeof(header), levelTable.data(), levelTable.size() * sizeof(CACHE_LEVEL));
+
+    // write to a per-thread temporary file, then rename it into place so a
+    // concurrent reader never maps a half-written entry
+    std::error_code error;
+    std::filesystem::create_directories(m_cacheDirectory, error);
+
+    std::string entryPath = GetEntryPath(key);
+    std::string tempPath = entryPath + "." +
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            return true;
+        }
+        file.write(reinterpret_cast<const char*>(texture.storage.data()), static_cast<std::streamsize>(texture.storage.size()));
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(tempPath, error);
+            return true;
+        }
+    }
+
+    std::filesystem::rename(tempPath, entryPath, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+    }
+
+    return true;
+}
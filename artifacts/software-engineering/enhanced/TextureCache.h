@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// on-disk cache of decoded texture images with a precomputed mip chain
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FileMapping.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Pixel layout of the levels in a cooked texture
+enum COOKED_FORMAT
+{
+    COOKED_FORMAT_RAW = 0,  // uncompressed, colorChannels bytes per pixel
+    COOKED_FORMAT_BC1 = 1,  // opaque color blocks
+    COOKED_FORMAT_BC3 = 2,  // color blocks with interpolated alpha
+    COOKED_FORMAT_BC7 = 3   // high quality color and alpha blocks
+};
+
+// Block compression applied while cooking
+enum TEXTURE_COMPRESSION
+{
+    TEXTURE_COMPRESSION_NONE,      // keep every texture uncompressed
+    TEXTURE_COMPRESSION_BC1_BC3,   // BC1 for RGB, BC3 for RGBA
+    TEXTURE_COMPRESSION_BC1_BC7    // BC1 for RGB, BC7 for RGBA
+};
+
+/***********************************************************
+ *  COOKED_TEXTURE
+ *
+ *  A fully decoded image and all of its mip levels, level 0
+ *  first. The pixels live either in a memory mapping of the
+ *  cache file or in an owned buffer, never both.
+ ***********************************************************/
+struct COOKED_TEXTURE
+{
+    struct MIP_LEVEL
+    {
+        int width;
+        int height;
+        size_t offset;
+        size_t size;
+    };
+
+    int width = 0;
+    int height = 0;
+    int colorChannels = 0;
+    COOKED_FORMAT format = COOKED_FORMAT_RAW;
+    std::vector<MIP_LEVEL> levels;
+    // true when the pixels were read from the cache instead of decoded
+    bool bFromCache = false;
+    // true when some source pixel has an alpha below 255
+    bool bTranslucent = false;
+
+    FileMapping mapping;
+    std::vector<unsigned char> storage;
+
+    // Pixels of a single mip level
+    const unsigned char* GetLevelData(size_t level) const
+    {
+        const unsigned char* pBase = mapping.IsOpen() ? mapping.GetData() : storage.data();
+        return pBase + levels[level].offset;
+    }
+};
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class stores cooked textures in a cache directory,
+ *  one file per source image. Entries are keyed by source
+ *  path, file size and modification time, so editing an
+ *  image invalidates its entry. Cooking optionally encodes
+ *  every level into GPU block-compressed formats. All methods
+ *  are const and safe to call from worker threads.
+ ***********************************************************/
+class TextureCache
+{
+public:
+    // Constructor
+    TextureCache(const std::string& cacheDirectory, TEXTURE_COMPRESSION compression);
+
+    // Change the block compression - only before any image is cooked or loaded
+    void SetCompression(TEXTURE_COMPRESSION compression);
+
+    // Format a source image of this size will be cooked to
+    COOKED_FORMAT GetCookedFormat(int width, int height, int colorChannels) const;
+
+    // Map the cached entry for the source image - false on a miss or stale entry
+    bool Load(const char* sourceFilename, COOKED_TEXTURE& texture) const;
+    // Build the mip chain for decoded pixels and write it to the cache
+    bool Cook(const char* sourceFilename, const unsigned char* pixels,
+        int width, int height, int colorChannels, COOKED_TEXTURE& texture) const;
+
+private:
+    // Identity of a source image on disk
+    struct SOURCE_KEY
+    {
+        uint64_t pathHash;
+        uint64_t fileSize;
+        int64_t modifiedTime;
+    };
+
+    // Read the key of a source image - false if the file is missing
+    static bool GetSourceKey(const char* sourceFilename, SOURCE_KEY& key);
+    // Path of the cache entry for a source image
+    std::string GetEntryPath(const SOURCE_KEY& key) const;
+
+    std::string m_cacheDirectory;
+    TEXTURE_COMPRESSION m_compression;
+};
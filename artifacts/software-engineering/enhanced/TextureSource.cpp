@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturesource.cpp
+// ============
+// where encoded image files are read from - loose files today, archives later
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureSource.h"
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method is used for mapping an image file and hinting
+ *  that it will be read sequentially, which is how every
+ *  image decoder consumes it.
+ ***********************************************************/
+bool FileTextureSource::Read(const char* name, ENCODED_IMAGE& image) const
+{
+    return Map(name, true, image);
+}
+
+/***********************************************************
+ *  ReadHeader()
+ *
+ *  This method is used for mapping an image file whose
+ *  header is all that will be parsed. Without the
+ *  sequential hint only the pages the parser touches are
+ *  read, rather than the whole file being read ahead.
+ ***********************************************************/
+bool FileTextureSource::ReadHeader(const char* name, ENCODED_IMAGE& image) const
+{
+    return Map(name, false, image);
+}
+
+/***********************************************************
+ *  Map()
+ *
+ *  This method is used for opening the read-only mapping
+ *  of an image file, with or without the read-ahead hint,
+ *  and pointing the image at its bytes.
+ ***********************************************************/
+bool FileTextureSource::Map(const char* name, bool bSequential, ENCODED_IMAGE& image) const
+{
+    if (!image.mapping.Open(name, bSequential))
+    {
+        image.pData = NULL;
+        image.size = 0;
+        return false;
+    }
+
+    image.pData = image.mapping.GetData();
+    image.size = image.mapping.GetSize();
+    return true;
+}
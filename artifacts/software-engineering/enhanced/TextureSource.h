@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturesource.h
+// ============
+// where encoded image files are read from - loose files today, archives later
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FileMapping.h"
+#include <cstddef>
+
+/***********************************************************
+ *  ENCODED_IMAGE
+ *
+ *  The still-compressed bytes of one image file (PNG, JPG).
+ *  The bytes are owned by the mapping, or by the source for
+ *  sources that hand out views into a larger mapping.
+ ***********************************************************/
+struct ENCODED_IMAGE
+{
+    const unsigned char* pData = NULL;
+    size_t size = 0;
+
+    FileMapping mapping;
+};
+
+/***********************************************************
+ *  TextureSource
+ *
+ *  This interface hides where image files come from, so
+ *  decoding works on memory no matter how it was read.
+ *  Implementations must be safe to call from several
+ *  worker threads at once.
+ ***********************************************************/
+class TextureSource
+{
+public:
+    virtual ~TextureSource() {}
+
+    // Read the encoded bytes of the named image - false if it does not exist
+    virtual bool Read(const char* name, ENCODED_IMAGE& image) const = 0;
+    // Read the named image for its header only - the bytes past it may never be touched
+    virtual bool ReadHeader(const char* name, ENCODED_IMAGE& image) const = 0;
+};
+
+/***********************************************************
+ *  FileTextureSource
+ *
+ *  This class reads each image straight from its own file
+ *  through a read-only memory mapping, so the decoder reads
+ *  the page cache without buffered stdio copies.
+ ***********************************************************/
+class FileTextureSource : public TextureSource
+{
+public:
+    // Map the image file named by the path
+    bool Read(const char* name, ENCODED_IMAGE& image) const override;
+    // Map the image file without the read-ahead hints
+    bool ReadHeader(const char* name, ENCODED_IMAGE& image) const override;
+
+private:
+    bool Map(const char* name, bool bSequential, ENCODED_IMAGE& image) const;
+};
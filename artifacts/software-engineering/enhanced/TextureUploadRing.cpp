@@ -0,0 +1,232 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureuploadring.cpp
+// ============
+// persistently mapped pixel buffer ring for streaming texture uploads
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureUploadRing.h"
+
+namespace
+{
+    // region offsets are aligned for any pixel format and row alignment
+    const size_t g_RegionAlignment = 16;
+
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+/***********************************************************
+ *  TextureUploadRing()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureUploadRing::TextureUploadRing()
+{
+    m_bufferID = 0;
+    m_pMappedData = NULL;
+    m_capacity = 0;
+    m_head = 0;
+    m_usedBytes = 0;
+    m_unfencedBytes = 0;
+}
+
+/***********************************************************
+ *  ~TextureUploadRing()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureUploadRing::~TextureUploadRing()
+{
+    Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the immutable buffer
+ *  storage and mapping it persistently. glBufferStorage
+ *  needs OpenGL 4.4, so older contexts (e.g. the 3.3 core
+ *  profile on macOS) report the ring as unavailable and the
+ *  caller falls back to uploading from client memory.
+ ***********************************************************/
+bool TextureUploadRing::Initialize(size_t capacity)
+{
+    Destroy();
+
+    GLint majorVersion = 0;
+    GLint minorVersion = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+    if (majorVersion < 4 || (majorVersion == 4 && minorVersion < 4))
+    {
+        return false;
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &m_bufferID);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(capacity), NULL, flags);
+    m_pMappedData = static_cast<unsigned char*>(
+        glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(capacity), flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (m_pMappedData == NULL)
+    {
+        glDeleteBuffers(1, &m_bufferID);
+        m_bufferID = 0;
+        return false;
+    }
+
+    m_capacity = capacity;
+    m_head = 0;
+    m_usedBytes = 0;
+    m_unfencedBytes = 0;
+    return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for waiting on every outstanding
+ *  fence and releasing the buffer.
+ ***********************************************************/
+void TextureUploadRing::Destroy()
+{
+    for (FENCED_REGION& region : m_fences)
+    {
+        glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(region.fence);
+    }
+    m_fences.clear();
+
+    if (m_bufferID != 0)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &m_bufferID);
+        m_bufferID = 0;
+    }
+
+    m_pMappedData = NULL;
+    m_capacity = 0;
+    m_head = 0;
+    m_usedBytes = 0;
+    m_unfencedBytes = 0;
+}
+
+/***********************************************************
+ *  RetireFences()
+ *
+ *  This method is used for polling the fences in the order
+ *  they were issued and freeing the ring space of every
+ *  batch the GPU has finished reading. It never blocks.
+ ***********************************************************/
+void TextureUploadRing::RetireFences()
+{
+    while (!m_fences.empty())
+    {
+        GLenum result = glClientWaitSync(m_fences.front().fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+
+        glDeleteSync(m_fences.front().fence);
+        m_usedBytes -= m_fences.front().byteCount;
+        m_fences.pop_front();
+    }
+
+    // an idle ring starts over at the beginning, which avoids wrap-around waste
+    if (m_usedBytes == 0)
+    {
+        m_head = 0;
+    }
+}
+
+/***********************************************************
+ *  GetRequiredBytes()
+ *
+ *  This method is used for computing where the next region
+ *  would start and how much ring space it would consume. A
+ *  region never straddles the end of the ring, so the tail
+ *  end is skipped (and counted as used) when it is too short.
+ ***********************************************************/
+size_t TextureUploadRing::GetRequiredBytes(size_t size, size_t& offset) const
+{
+    offset = AlignUp(m_head, g_RegionAlignment);
+    if (offset + size > m_capacity)
+    {
+        offset = 0;
+        return (m_capacity - m_head) + size;
+    }
+    return (offset - m_head) + size;
+}
+
+/***********************************************************
+ *  HasSpace()
+ *
+ *  This method is used for checking if a region of the passed
+ *  in size could be allocated right now.
+ ***********************************************************/
+bool TextureUploadRing::HasSpace(size_t size)
+{
+    if (!IsAvailable() || size > m_capacity)
+    {
+        return false;
+    }
+
+    RetireFences();
+
+    size_t offset = 0;
+    return m_usedBytes + GetRequiredBytes(size, offset) <= m_capacity;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for reserving a region of the ring
+ *  and returning its mapped address. The offset is relative
+ *  to the start of the buffer, for use as the pixel pointer
+ *  while the buffer is bound to GL_PIXEL_UNPACK_BUFFER.
+ ***********************************************************/
+unsigned char* TextureUploadRing::Allocate(size_t size, size_t& offset)
+{
+    if (!HasSpace(size))
+    {
+        return NULL;
+    }
+
+    size_t requiredBytes = GetRequiredBytes(size, offset);
+    m_usedBytes += requiredBytes;
+    m_unfencedBytes += requiredBytes;
+    m_head = offset + size;
+
+    return m_pMappedData + offset;
+}
+
+/***********************************************************
+ *  Fence()
+ *
+ *  This method is used for inserting a fence after the
+ *  uploads that read the regions allocated since the last
+ *  fence, so that space is only reused once they finished.
+ ***********************************************************/
+void TextureUploadRing::Fence()
+{
+    if (m_unfencedBytes == 0)
+    {
+        return;
+    }
+
+    FENCED_REGION region;
+    region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region.byteCount = m_unfencedBytes;
+    m_fences.push_back(region);
+    m_unfencedBytes = 0;
+}
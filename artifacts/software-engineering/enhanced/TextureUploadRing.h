@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureuploadring.h
+// ============
+// persistently mapped pixel buffer ring for streaming texture uploads
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <deque>
+
+/***********************************************************
+ *  TextureUploadRing
+ *
+ *  This class owns one GL_PIXEL_UNPACK_BUFFER that stays
+ *  mapped for its whole lifetime. Pixels are copied into
+ *  the next free region and uploaded from there, so the
+ *  driver can transfer them asynchronously. Every batch of
+ *  regions is protected by a fence and only reused once the
+ *  GPU has signalled it. GL thread only.
+ ***********************************************************/
+class TextureUploadRing
+{
+public:
+    // Constructor
+    TextureUploadRing();
+    // Destructor
+    ~TextureUploadRing();
+
+    // Create and map the buffer - false if persistent mapping is unsupported
+    bool Initialize(size_t capacity);
+    // Wait for outstanding uploads, unmap and delete the buffer
+    void Destroy();
+
+    // Check if the ring can be used at all
+    bool IsAvailable() const { return m_pMappedData != NULL; }
+    // Size of the whole ring in bytes
+    size_t GetCapacity() const { return m_capacity; }
+    // OpenGL buffer to bind as GL_PIXEL_UNPACK_BUFFER
+    GLuint GetBufferID() const { return m_bufferID; }
+
+    // Check, without blocking, if a region of the given size is free
+    bool HasSpace(size_t size);
+    // Reserve a region - returns NULL if it is still in use by the GPU
+    unsigned char* Allocate(size_t size, size_t& offset);
+    // Fence every region allocated since the last call
+    void Fence();
+
+private:
+    // Uploads covered by one fence
+    struct FENCED_REGION
+    {
+        GLsync fence;
+        size_t byteCount;
+    };
+
+    // Release regions whose fence has been signalled
+    void RetireFences();
+    // Bytes needed to place a region at the head, including wrap-around waste
+    size_t GetRequiredBytes(size_t size, size_t& offset) const;
+
+    GLuint m_bufferID;
+    unsigned char* m_pMappedData;
+    size_t m_capacity;
+    size_t m_head;
+    size_t m_usedBytes;
+    size_t m_unfencedBytes;
+    std::deque<FENCED_REGION> m_fences;
+};
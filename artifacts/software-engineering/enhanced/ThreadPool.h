@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ============
+// fixed-size pool of worker threads for CPU-side work that must stay off
+// the OpenGL thread - image decoding, texture cooking, etc.
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/***********************************************************
+ *  ThreadPool
+ *
+ *  This class owns a set of worker threads that pull tasks
+ *  from a shared FIFO queue. Tasks must never call into
+ *  OpenGL, since the GL context is only current on the
+ *  main thread.
+ ***********************************************************/
+class ThreadPool
+{
+public:
+    // Constructor - a thread count of 0 uses the hardware concurrency
+    explicit ThreadPool(unsigned int threadCount = 0);
+    // Destructor - finishes queued tasks and joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task and get a future for its result
+    template <typename Task>
+    std::future<typename std::invoke_result<Task>::type> Submit(Task task);
+
+    // Number of worker threads in the pool
+    unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+private:
+    // Main loop run by every worker thread
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_bStopping;
+};
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for queueing a task on the pool.
+ *  The packaged task is kept in a shared_ptr because
+ *  std::function requires a copyable target.
+ ***********************************************************/
+template <typename Task>
+std::future<typename std::invoke_result<Task>::type> ThreadPool::Submit(Task task)
+{
+    using Result = typename std::invoke_result<Task>::type;
+
+    auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    std::future<Result> result = packagedTask->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.emplace([packagedTask]() { (*packagedTask)(); });
+    }
+    m_condition.notify_one();
+
+    return result;
+}
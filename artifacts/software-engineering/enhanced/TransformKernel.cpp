@@ -0,0 +1,486 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformkernel.cpp
+// ============
+// closed-form scale, rotation and translation composition for model matrices
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformKernel.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#if defined(__AVX2__)
+#define TRANSFORM_KERNEL_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_KERNEL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float g_DegreesToRadians = 3.14159265358979f / 180.0f;
+
+    /***********************************************************
+     *  ComposeScalar()
+     *
+     *  Writes the model matrix, and the normal matrix if asked,
+     *  of one object. With R = Rz * Ry * Rx, column j of the
+     *  model is column j of R times scale j, and column j of
+     *  the normal matrix is column j of R divided by scale j.
+     ***********************************************************/
+    void ComposeScalar(
+        float scaleX, float scaleY, float scaleZ,
+        float rotationX, float rotationY, float rotationZ,
+        float positionX, float positionY, float positionZ,
+        float* pModel, float* pNormal)
+    {
+        float sx = std::sin(rotationX * g_DegreesToRadians);
+        float cx = std::cos(rotationX * g_DegreesToRadians);
+        float sy = std::sin(rotationY * g_DegreesToRadians);
+        float cy = std::cos(rotationY * g_DegreesToRadians);
+        float sz = std::sin(rotationZ * g_DegreesToRadians);
+        float cz = std::cos(rotationZ * g_DegreesToRadians);
+
+        // rotation columns
+        float r00 = cz * cy;
+        float r10 = sz * cy;
+        float r20 = -sy;
+        float r01 = cz * sy * sx - sz * cx;
+        float r11 = sz * sy * sx + cz * cx;
+        float r21 = cy * sx;
+        float r02 = cz * sy * cx + sz * sx;
+        float r12 = sz * sy * cx - cz * sx;
+        float r22 = cy * cx;
+
+        pModel[0] = r00 * scaleX; pModel[1] = r10 * scaleX; pModel[2] = r20 * scaleX; pModel[3] = 0.0f;
+        pModel[4] = r01 * scaleY; pModel[5] = r11 * scaleY; pModel[6] = r21 * scaleY; pModel[7] = 0.0f;
+        pModel[8] = r02 * scaleZ; pModel[9] = r12 * scaleZ; pModel[10] = r22 * scaleZ; pModel[11] = 0.0f;
+        pModel[12] = positionX; pModel[13] = positionY; pModel[14] = positionZ; pModel[15] = 1.0f;
+
+        if (pNormal != NULL)
+        {
+            float inverseX = 1.0f / scaleX;
+            float inverseY = 1.0f / scaleY;
+            float inverseZ = 1.0f / scaleZ;
+            pNormal[0] = r00 * inverseX; pNormal[1] = r10 * inverseX; pNormal[2] = r20 * inverseX; pNormal[3] = 0.0f;
+            pNormal[4] = r01 * inverseY; pNormal[5] = r11 * inverseY; pNormal[6] = r21 * inverseY; pNormal[7] = 0.0f;
+            pNormal[8] = r02 * inverseZ; pNormal[9] = r12 * inverseZ; pNormal[10] = r22 * inverseZ; pNormal[11] = 0.0f;
+            pNormal[12] = 0.0f; pNormal[13] = 0.0f; pNormal[14] = 0.0f; pNormal[15] = 1.0f;
+        }
+    }
+
+    // sin/cos minimax coefficients on [-pi/4, pi/4], and pi/2 split in three
+    // parts so the range reduction stays exact for large angles
+    const float g_SinC1 = -1.6666654611e-1f;
+    const float g_SinC2 = 8.3321608736e-3f;
+    const float g_SinC3 = -1.9515295891e-4f;
+    const float g_CosC1 = 4.166664568298827e-2f;
+    const float g_CosC2 = -1.388731625493765e-3f;
+    const float g_CosC3 = 2.443315711809948e-5f;
+    const float g_TwoOverPi = 0.636619772367581f;
+    const float g_HalfPi1 = 1.5703125f;
+    const float g_HalfPi2 = 4.837512969970703125e-4f;
+    const float g_HalfPi3 = 7.54978995489188216e-8f;
+
+#ifdef TRANSFORM_KERNEL_SSE2
+    /***********************************************************
+     *  SinCos4()
+     *
+     *  Sine and cosine of 4 angles in radians. The angle is
+     *  reduced to a quarter turn plus a remainder in
+     *  [-pi/4, pi/4]; the quadrant swaps and negates the two
+     *  polynomials.
+     ***********************************************************/
+    void SinCos4(__m128 angle, __m128& sine, __m128& cosine)
+    {
+        __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(g_TwoOverPi)));
+        __m128 turns = _mm_cvtepi32_ps(quadrant);
+
+        __m128 r = _mm_sub_ps(angle, _mm_mul_ps(turns, _mm_set1_ps(g_HalfPi1)));
+        r = _mm_sub_ps(r, _mm_mul_ps(turns, _mm_set1_ps(g_HalfPi2)));
+        r = _mm_sub_ps(r, _mm_mul_ps(turns, _mm_set1_ps(g_HalfPi3)));
+        __m128 z = _mm_mul_ps(r, r);
+
+        __m128 sinPoly = _mm_add_ps(_mm_set1_ps(g_SinC2), _mm_mul_ps(z, _mm_set1_ps(g_SinC3)));
+        sinPoly = _mm_add_ps(_mm_set1_ps(g_SinC1), _mm_mul_ps(z, sinPoly));
+        sinPoly = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sinPoly));
+
+        __m128 cosPoly = _mm_add_ps(_mm_set1_ps(g_CosC2), _mm_mul_ps(z, _mm_set1_ps(g_CosC3)));
+        cosPoly = _mm_add_ps(_mm_set1_ps(g_CosC1), _mm_mul_ps(z, cosPoly));
+        cosPoly = _mm_mul_ps(_mm_mul_ps(z, z), cosPoly);
+        cosPoly = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(z, _mm_set1_ps(0.5f))), cosPoly);
+
+        // odd quadrants swap sine and cosine
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+            _mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+        __m128 sinResult = _mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly));
+        __m128 cosResult = _mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly));
+
+        // bit 1 of the quadrant (and of quadrant + 1 for cosine) is the sign
+        __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+        __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+            _mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+        sine = _mm_xor_ps(sinResult, sinSign);
+        cosine = _mm_xor_ps(cosResult, cosSign);
+    }
+
+    /***********************************************************
+     *  StoreColumn4()
+     *
+     *  Writes one matrix column of 4 objects. Each register
+     *  holds one element of the column for all 4 objects, so
+     *  a 4x4 transpose turns them into one column per object.
+     ***********************************************************/
+    void StoreColumn4(__m128 e0, __m128 e1, __m128 e2, __m128 e3, float* pMatrices, int column)
+    {
+        _MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+        _mm_storeu_ps(pMatrices + 0 * 16 + column * 4, e0);
+        _mm_storeu_ps(pMatrices + 1 * 16 + column * 4, e1);
+        _mm_storeu_ps(pMatrices + 2 * 16 + column * 4, e2);
+        _mm_storeu_ps(pMatrices + 3 * 16 + column * 4, e3);
+    }
+
+    /***********************************************************
+     *  Compose4()
+     *
+     *  SSE2 version of ComposeScalar() for 4 objects.
+     ***********************************************************/
+    void Compose4(const TransformKernel::TRANSFORM_BATCH& batch, size_t first, float* pModels, float* pNormals)
+    {
+        __m128 toRadians = _mm_set1_ps(g_DegreesToRadians);
+        __m128 sx, cx, sy, cy, sz, cz;
+        SinCos4(_mm_mul_ps(_mm_loadu_ps(batch.rotationX + first), toRadians), sx, cx);
+        SinCos4(_mm_mul_ps(_mm_loadu_ps(batch.rotationY + first), toRadians), sy, cy);
+        SinCos4(_mm_mul_ps(_mm_loadu_ps(batch.rotationZ + first), toRadians), sz, cz);
+
+        __m128 r00 = _mm_mul_ps(cz, cy);
+        __m128 r10 = _mm_mul_ps(sz, cy);
+        __m128 r20 = _mm_sub_ps(_mm_setzero_ps(), sy);
+        __m128 czsy = _mm_mul_ps(cz, sy);
+        __m128 szsy = _mm_mul_ps(sz, sy);
+        __m128 r01 = _mm_sub_ps(_mm_mul_ps(czsy, sx), _mm_mul_ps(sz, cx));
+        __m128 r11 = _mm_add_ps(_mm_mul_ps(szsy, sx), _mm_mul_ps(cz, cx));
+        __m128 r21 = _mm_mul_ps(cy, sx);
+        __m128 r02 = _mm_add_ps(_mm_mul_ps(czsy, cx), _mm_mul_ps(sz, sx));
+        __m128 r12 = _mm_sub_ps(_mm_mul_ps(szsy, cx), _mm_mul_ps(cz, sx));
+        __m128 r22 = _mm_mul_ps(cy, cx);
+
+        __m128 scaleX = _mm_loadu_ps(batch.scaleX + first);
+        __m128 scaleY = _mm_loadu_ps(batch.scaleY + first);
+        __m128 scaleZ = _mm_loadu_ps(batch.scaleZ + first);
+        __m128 zero = _mm_setzero_ps();
+        __m128 one = _mm_set1_ps(1.0f);
+
+        StoreColumn4(_mm_mul_ps(r00, scaleX), _mm_mul_ps(r10, scaleX), _mm_mul_ps(r20, scaleX), zero, pModels, 0);
+        StoreColumn4(_mm_mul_ps(r01, scaleY), _mm_mul_ps(r11, scaleY), _mm_mul_ps(r21, scaleY), zero, pModels, 1);
+        StoreColumn4(_mm_mul_ps(r02, scaleZ), _mm_mul_ps(r12, scaleZ), _mm_mul_ps(r22, scaleZ), zero, pModels, 2);
+        StoreColumn4(_mm_loadu_ps(batch.positionX + first), _mm_loadu_ps(batch.positionY + first),
+            _mm_loadu_ps(batch.positionZ + first), one, pModels, 3);
+
+        if (pNormals != NULL)
+        {
+            __m128 inverseX = _mm_div_ps(one, scaleX);
+            __m128 inverseY = _mm_div_ps(one, scaleY);
+            __m128 inverseZ = _mm_div_ps(one, scaleZ);
+            StoreColumn4(_mm_mul_ps(r00, inverseX), _mm_mul_ps(r10, inverseX), _mm_mul_ps(r20, inverseX), zero, pNormals, 0);
+            StoreColumn4(_mm_mul_ps(r01, inverseY), _mm_mul_ps(r11, inverseY), _mm_mul_ps(r21, inverseY), zero, pNormals, 1);
+            StoreColumn4(_mm_mul_ps(r02, inverseZ), _mm_mul_ps(r12, inverseZ), _mm_mul_ps(r22, inverseZ), zero, pNormals, 2);
+            StoreColumn4(zero, zero, zero, one, pNormals, 3);
+        }
+    }
+#endif
+
+#ifdef TRANSFORM_KERNEL_AVX2
+    /***********************************************************
+     *  SinCos8()
+     *
+     *  AVX2 version of SinCos4() for 8 angles.
+     ***********************************************************/
+    void SinCos8(__m256 angle, __m256& sine, __m256& cosine)
+    {
+        __m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(angle, _mm256_set1_ps(g_TwoOverPi)));
+        __m256 turns = _mm256_cvtepi32_ps(quadrant);
+
+        __m256 r = _mm256_sub_ps(angle, _mm256_mul_ps(turns, _mm256_set1_ps(g_HalfPi1)));
+        r = _mm256_sub_ps(r, _mm256_mul_ps(turns, _mm256_set1_ps(g_HalfPi2)));
+        r = _mm256_sub_ps(r, _mm256_mul_ps(turns, _mm256_set1_ps(g_HalfPi3)));
+        __m256 z = _mm256_mul_ps(r, r);
+
+        __m256 sinPoly = _mm256_add_ps(_mm256_set1_ps(g_SinC2), _mm256_mul_ps(z, _mm256_set1_ps(g_SinC3)));
+        sinPoly = _mm256_add_ps(_mm256_set1_ps(g_SinC1), _mm256_mul_ps(z, sinPoly));
+        sinPoly = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, z), sinPoly));
+
+        __m256 cosPoly = _mm256_add_ps(_mm256_set1_ps(g_CosC2), _mm256_mul_ps(z, _mm256_set1_ps(g_CosC3)));
+        cosPoly = _mm256_add_ps(_mm256_set1_ps(g_CosC1), _mm256_mul_ps(z, cosPoly));
+        cosPoly = _mm256_mul_ps(_mm256_mul_ps(z, z), cosPoly);
+        cosPoly = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(z, _mm256_set1_ps(0.5f))), cosPoly);
+
+        __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+        __m256 sinResult = _mm256_blendv_ps(sinPoly, cosPoly, swap);
+        __m256 cosResult = _mm256_blendv_ps(cosPoly, sinPoly, swap);
+
+        __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+        __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+            _mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+        sine = _mm256_xor_ps(sinResult, sinSign);
+        cosine = _mm256_xor_ps(cosResult, cosSign);
+    }
+
+    /***********************************************************
+     *  StoreColumn8()
+     *
+     *  Writes one matrix column of 8 objects, as two 4x4
+     *  transposes of the low and high halves.
+     ***********************************************************/
+    void StoreColumn8(__m256 e0, __m256 e1, __m256 e2, __m256 e3, float* pMatrices, int column)
+    {
+        StoreColumn4(_mm256_castps256_ps128(e0), _mm256_castps256_ps128(e1),
+            _mm256_castps256_ps128(e2), _mm256_castps256_ps128(e3), pMatrices, column);
+        StoreColumn4(_mm256_extractf128_ps(e0, 1), _mm256_extractf128_ps(e1, 1),
+            _mm256_extractf128_ps(e2, 1), _mm256_extractf128_ps(e3, 1), pMatrices + 4 * 16, column);
+    }
+
+    /***********************************************************
+     *  Compose8()
+     *
+     *  AVX2 version of ComposeScalar() for 8 objects.
+     ***********************************************************/
+    void Compose8(const TransformKernel::TRANSFORM_BATCH& batch, size_t first, float* pModels, float* pNormals)
+    {
+        __m256 toRadians = _mm256_set1_ps(g_DegreesToRadians);
+        __m256 sx, cx, sy, cy, sz, cz;
+        SinCos8(_mm256_mul_ps(_mm256_loadu_ps(batch.rotationX + first), toRadians), sx, cx);
+        SinCos8(_mm256_mul_ps(_mm256_loadu_ps(batch.rotationY + first), toRadians), sy, cy);
+        SinCos8(_mm256_mul_ps(_mm256_loadu_ps(batch.rotationZ + first), toRadians), sz, cz);
+
+        __m256 r00 = _mm256_mul_ps(cz, cy);
+        __m256 r10 = _mm256_mul_ps(sz, cy);
+        __m256 r20 = _mm256_sub_ps(_mm256_setzero_ps(), sy);
+        __m256 czsy = _mm256_mul_ps(cz, sy);
+        __m256 szsy = _mm256_mul_ps(sz, sy);
+        __m256 r01 = _mm256_sub_ps(_mm256_mul_ps(czsy, sx), _mm256_mul_ps(sz, cx));
+        __m256 r11 = _mm256_add_ps(_mm256_mul_ps(szsy, sx), _mm256_mul_ps(cz, cx));
+        __m256 r21 = _mm256_mul_ps(cy, sx);
+        __m256 r02 = _mm256_add_ps(_mm256_mul_ps(czsy, cx), _mm256_mul_ps(sz, sx));
+        __m256 r12 = _mm256_sub_ps(_mm256_mul_ps(szsy, cx), _mm256_mul_ps(cz, sx));
+        __m256 r22 = _mm256_mul_ps(cy, cx);
+
+        __m256 scaleX = _mm256_loadu_ps(batch.scaleX + first);
+        __m256 scaleY = _mm256_loadu_ps(batch.scaleY + first);
+        __m256 scaleZ = _mm256_loadu_ps(batch.scaleZ + first);
+        __m256 zero = _mm256_setzero_ps();
+        __m256 one = _mm256_set1_ps(1.0f);
+
+        StoreColumn8(_mm256_mul_ps(r00, scaleX), _mm256_mul_ps(r10, scaleX), _mm256_mul_ps(r20, scaleX), zero, pModels, 0);
+        StoreColumn8(_mm256_mul_ps(r01, scaleY), _mm256_mul_ps(r11, scaleY), _mm256_mul_ps(r21, scaleY), zero, pModels, 1);
+        StoreColumn8(_mm256_mul_ps(r02, scaleZ), _mm256_mul_ps(r12, scaleZ), _mm256_mul_ps(r22, scaleZ), zero, pModels, 2);
+        StoreColumn8(_mm256_loadu_ps(batch.positionX + first), _mm256_loadu_ps(batch.positionY + first),
+            _mm256_loadu_ps(batch.positionZ + first), one, pModels, 3);
+
+        if (pNormals != NULL)
+        {
+            __m256 inverseX = _mm256_div_ps(one, scaleX);
+            __m256 inverseY = _mm256_div_ps(one, scaleY);
+            __m256 inverseZ = _mm256_div_ps(one, scaleZ);
+            StoreColumn8(_mm256_mul_ps(r00, inverseX), _mm256_mul_ps(r10, inverseX), _mm256_mul_ps(r20, inverseX), zero, pNormals, 0);
+            StoreColumn8(_mm256_mul_ps(r01, inverseY), _mm256_mul_ps(r11, inverseY), _mm256_mul_ps(r21, inverseY), zero, pNormals, 1);
+            StoreColumn8(_mm256_mul_ps(r02, inverseZ), _mm256_mul_ps(r12, inverseZ), _mm256_mul_ps(r22, inverseZ), zero, pNormals, 2);
+            StoreColumn8(zero, zero, zero, one, pNormals, 3);
+        }
+    }
+#endif
+
+    /***********************************************************
+     *  ComposeReference()
+     *
+     *  The matrix chain SetTransformations() used before the
+     *  closed form, kept as the benchmark baseline.
+     ***********************************************************/
+    glm::mat4 ComposeReference(
+        const glm::vec3& scaleXYZ,
+        float XrotationDegrees,
+        float YrotationDegrees,
+        float ZrotationDegrees,
+        const glm::vec3& positionXYZ)
+    {
+        glm::mat4 scale = glm::scale(scaleXYZ);
+        glm::mat4 rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+        glm::mat4 rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+        glm::mat4 translation = glm::translate(positionXYZ);
+
+        return translation * rotationZ * rotationY * rotationX * scale;
+    }
+}
+
+/***********************************************************
+ *  ComposeTransform()
+ *
+ *  Builds the model matrix of a single object from its
+ *  closed form.
+ ***********************************************************/
+glm::mat4 TransformKernel::ComposeTransform(
+    const glm::vec3& scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    const glm::vec3& positionXYZ)
+{
+    glm::mat4 model;
+    ComposeScalar(scaleXYZ.x, scaleXYZ.y, scaleXYZ.z,
+        XrotationDegrees, YrotationDegrees, ZrotationDegrees,
+        positionXYZ.x, positionXYZ.y, positionXYZ.z,
+        &model[0][0], NULL);
+    return model;
+}
+
+/***********************************************************
+ *  ComposeTransforms()
+ *
+ *  Builds the model and normal matrices of a batch, in wide
+ *  groups first and the remaining objects one at a time.
+ ***********************************************************/
+void TransformKernel::ComposeTransforms(const TRANSFORM_BATCH& batch, glm::mat4* pModelMatrices, glm::mat4* pNormalMatrices)
+{
+    // an empty batch may come with no matrices to point into
+    if (batch.count == 0 || pModelMatrices == NULL)
+        return;
+
+    float* pModels = &pModelMatrices[0][0][0];
+    float* pNormals = (pNormalMatrices != NULL) ? &pNormalMatrices[0][0][0] : NULL;
+    size_t i = 0;
+
+#ifdef TRANSFORM_KERNEL_AVX2
+    for (; i + 8 <= batch.count; i += 8)
+    {
+        Compose8(batch, i, pModels + i * 16, (pNormals != NULL) ? pNormals + i * 16 : NULL);
+    }
+#endif
+#ifdef TRANSFORM_KERNEL_SSE2
+    for (; i + 4 <= batch.count; i += 4)
+    {
+        Compose4(batch, i, pModels + i * 16, (pNormals != NULL) ? pNormals + i * 16 : NULL);
+    }
+#endif
+    for (; i < batch.count; i++)
+    {
+        ComposeScalar(batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i],
+            batch.rotationX[i], batch.rotationY[i], batch.rotationZ[i],
+            batch.positionX[i], batch.positionY[i], batch.positionZ[i],
+            pModels + i * 16, (pNormals != NULL) ? pNormals + i * 16 : NULL);
+    }
+}
+
+/***********************************************************
+ *  RunBenchmark()
+ *
+ *  Builds the model matrices of random transforms with the
+ *  glm matrix chain, the scalar closed form and the batch
+ *  kernel, and prints the time per object of each along
+ *  with the largest difference from the matrix chain.
+ ***********************************************************/
+void TransformKernel::RunBenchmark(size_t objectCount)
+{
+    const int repeatCount = 20;
+
+    std::mt19937 random(499);
+    std::uniform_real_distribution<float> scaleRange(0.1f, 4.0f);
+    std::uniform_real_distribution<float> angleRange(-360.0f, 360.0f);
+    std::uniform_real_distribution<float> positionRange(-50.0f, 50.0f);
+
+    std::vector<float> components[9];
+    for (int c = 0; c < 9; c++)
+    {
+        components[c].resize(objectCount);
+        for (size_t i = 0; i < objectCount; i++)
+        {
+            components[c][i] = (c < 3) ? scaleRange(random) : (c < 6) ? angleRange(random) : positionRange(random);
+        }
+    }
+
+    TRANSFORM_BATCH batch = {
+        components[0].data(), components[1].data(), components[2].data(),
+        components[3].data(), components[4].data(), components[5].data(),
+        components[6].data(), components[7].data(), components[8].data(),
+        objectCount };
+
+    std::vector<glm::mat4> reference(objectCount);
+    std::vector<glm::mat4> closedForm(objectCount);
+    std::vector<glm::mat4> batched(objectCount);
+    std::vector<glm::mat4> normals(objectCount);
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < repeatCount; repeat++)
+    {
+        for (size_t i = 0; i < objectCount; i++)
+        {
+            reference[i] = ComposeReference(
+                glm::vec3(batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i]),
+                batch.rotationX[i], batch.rotationY[i], batch.rotationZ[i],
+                glm::vec3(batch.positionX[i], batch.positionY[i], batch.positionZ[i]));
+        }
+    }
+    auto referenceTime = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < repeatCount; repeat++)
+    {
+        for (size_t i = 0; i < objectCount; i++)
+        {
+            closedForm[i] = ComposeTransform(
+                glm::vec3(batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i]),
+                batch.rotationX[i], batch.rotationY[i], batch.rotationZ[i],
+                glm::vec3(batch.positionX[i], batch.positionY[i], batch.positionZ[i]));
+        }
+    }
+    auto closedFormTime = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < repeatCount; repeat++)
+    {
+        ComposeTransforms(batch, batched.data(), normals.data());
+    }
+    auto batchTime = std::chrono::steady_clock::now();
+
+    float closedFormError = 0.0f;
+    float batchError = 0.0f;
+    for (size_t i = 0; i < objectCount; i++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            for (int row = 0; row < 4; row++)
+            {
+                closedFormError = std::max(closedFormError, std::fabs(closedForm[i][column][row] - reference[i][column][row]));
+                batchError = std::max(batchError, std::fabs(batched[i][column][row] - reference[i][column][row]));
+            }
+        }
+    }
+
+    double objects = static_cast<double>(objectCount) * repeatCount;
+    auto nanosecondsPerObject = [objects](std::chrono::steady_clock::duration elapsed)
+    {
+        return std::chrono::duration<double, std::nano>(elapsed).count() / objects;
+    };
+
+#if defined(TRANSFORM_KERNEL_AVX2)
+    const char* kernelName = "AVX2";
+#elif defined(TRANSFORM_KERNEL_SSE2)
+    const char* kernelName = "SSE2";
+#else
+    const char* kernelName = "scalar";
+#endif
+
+    std::cout << "INFO: Transform benchmark, " << objectCount << " objects x " << repeatCount << " runs" << std::endl;
+    std::cout << "INFO:   glm matrix chain     " << nanosecondsPerObject(referenceTime - startTime) << " ns/object" << std::endl;
+    std::cout << "INFO:   closed form          " << nanosecondsPerObject(closedFormTime - referenceTime)
+        << " ns/object, max error " << closedFormError << std::endl;
+    std::cout << "INFO:   " << kernelName << " batch + normals " << nanosecondsPerObject(batchTime - closedFormTime)
+        << " ns/object, max error " << batchError << std::endl;
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformkernel.h
+// ============
+// closed-form scale, rotation and translation composition for model matrices
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  TransformKernel
+ *
+ *  These functions build model matrices the same way as
+ *  translate * rotateZ * rotateY * rotateX * scale, but
+ *  write each element from its closed form instead of
+ *  multiplying five 4x4 matrices. The batch version reads
+ *  structure-of-arrays input and runs 8 objects at a time
+ *  with AVX2, or 4 with SSE2, where the compiler targets
+ *  them. The functions keep no state and are safe to call
+ *  from several threads at once.
+ ***********************************************************/
+namespace TransformKernel
+{
+    // One array per component, count entries each; rotations in degrees
+    struct TRANSFORM_BATCH
+    {
+        const float* scaleX;
+        const float* scaleY;
+        const float* scaleZ;
+        const float* rotationX;
+        const float* rotationY;
+        const float* rotationZ;
+        const float* positionX;
+        const float* positionY;
+        const float* positionZ;
+        size_t count;
+    };
+
+    // Model matrix of a single object
+    glm::mat4 ComposeTransform(
+        const glm::vec3& scaleXYZ,
+        float XrotationDegrees,
+        float YrotationDegrees,
+        float ZrotationDegrees,
+        const glm::vec3& positionXYZ);
+
+    // Model matrices, and optionally normal matrices, of a batch of objects.
+    // The upper 3x3 of a normal matrix is the inverse transpose of the model's
+    void ComposeTransforms(const TRANSFORM_BATCH& batch, glm::mat4* pModelMatrices, glm::mat4* pNormalMatrices);
+
+    // Time the batch kernel against the glm matrix chain and print the results
+    void RunBenchmark(size_t objectCount);
+}
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.cpp
+// ============
+// uniform locations resolved once per shader program, behind typed handles
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformCache.h"
+
+#include <vector>
+
+/***********************************************************
+ *  Uniform<T>::Set()
+ *
+ *  One specialization per uniform type used by the scene.
+ *  A location of -1 is ignored by OpenGL, so the calls need
+ *  no check of their own.
+ ***********************************************************/
+template <>
+void Uniform<float>::Set(const float& value) const
+{
+    glUniform1f(m_location, value);
+}
+
+template <>
+void Uniform<int>::Set(const int& value) const
+{
+    glUniform1i(m_location, value);
+}
+
+template <>
+void Uniform<bool>::Set(const bool& value) const
+{
+    glUniform1i(m_location, value ? 1 : 0);
+}
+
+template <>
+void Uniform<glm::vec2>::Set(const glm::vec2& value) const
+{
+    glUniform2f(m_location, value.x, value.y);
+}
+
+template <>
+void Uniform<glm::vec3>::Set(const glm::vec3& value) const
+{
+    glUniform3f(m_location, value.x, value.y, value.z);
+}
+
+template <>
+void Uniform<glm::vec4>::Set(const glm::vec4& value) const
+{
+    glUniform4f(m_location, value.x, value.y, value.z, value.w);
+}
+
+template <>
+void Uniform<glm::mat4>::Set(const glm::mat4& value) const
+{
+    glUniformMatrix4fv(m_location, 1, GL_FALSE, &value[0][0]);
+}
+
+/***********************************************************
+ *  UniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformCache::UniformCache()
+{
+    m_programID = 0;
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading the name and location of
+ *  every active uniform in a linked program. Uniforms inside
+ *  a uniform block have no location and are skipped. OpenGL
+ *  reports an array once, as "name[0]", so the location of
+ *  each element is queried here, once, instead of per frame.
+ ***********************************************************/
+void UniformCache::Load(GLuint programID)
+{
+    m_locations.clear();
+    m_programID = programID;
+
+    if (programID == 0)
+    {
+        return;
+    }
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> nameBuffer(static_cast<size_t>(maxNameLength) + 1);
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programID, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()),
+            &nameLength, &arraySize, &type, nameBuffer.data());
+
+        std::string name(nameBuffer.data(), static_cast<size_t>(nameLength));
+        GLint location = glGetUniformLocation(programID, name.c_str());
+        if (location < 0)
+        {
+            continue;
+        }
+
+        m_locations[name] = location;
+
+        // "name[0]" stands for the whole array; add the bare name and every element
+        size_t suffix = name.rfind("[0]");
+        if (suffix != std::string::npos && suffix + 3 == name.size())
+        {
+            std::string baseName = name.substr(0, suffix);
+            m_locations[baseName] = location;
+            for (GLint element = 1; element < arraySize; element++)
+            {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                m_locations[elementName] = glGetUniformLocation(programID, elementName.c_str());
+            }
+        }
+    }
+}
+
+/***********************************************************
+ *  GetLocation()
+ *
+ *  This method is used for looking up a cached location.
+ *  It is meant for resolving handles, not for per-draw use.
+ ***********************************************************/
+GLint UniformCache::GetLocation(const std::string& name) const
+{
+    auto it = m_locations.find(name);
+    if (it == m_locations.end())
+    {
+        return -1;
+    }
+    return it->second;
+}
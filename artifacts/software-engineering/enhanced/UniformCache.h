@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.h
+// ============
+// uniform locations resolved once per shader program, behind typed handles
+//
+//  Rafael V. Canseco - CS-499
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+
+/***********************************************************
+ *  Uniform
+ *
+ *  A handle to one uniform of a known type. It only holds
+ *  the location, so setting a value is a single glUniform
+ *  call with no name lookup. Values go to the program that
+ *  is currently in use, like the ShaderManager setters. A
+ *  handle for a uniform the shader does not have is valid
+ *  to set and does nothing.
+ ***********************************************************/
+template <typename T>
+class Uniform
+{
+public:
+    Uniform() : m_location(-1) {}
+    explicit Uniform(GLint location) : m_location(location) {}
+
+    // Set the value into the program in use
+    void Set(const T& value) const;
+    // True if the shader has this uniform
+    bool IsValid() const { return m_location >= 0; }
+    GLint GetLocation() const { return m_location; }
+
+private:
+    GLint m_location;
+};
+
+template <> void Uniform<float>::Set(const float& value) const;
+template <> void Uniform<int>::Set(const int& value) const;
+template <> void Uniform<bool>::Set(const bool& value) const;
+template <> void Uniform<glm::vec2>::Set(const glm::vec2& value) const;
+template <> void Uniform<glm::vec3>::Set(const glm::vec3& value) const;
+template <> void Uniform<glm::vec4>::Set(const glm::vec4& value) const;
+template <> void Uniform<glm::mat4>::Set(const glm::mat4& value) const;
+
+/***********************************************************
+ *  UniformCache
+ *
+ *  This class reads every active uniform of a linked shader
+ *  program once, after the shaders are loaded, and hands out
+ *  typed handles for them. Array uniforms are stored per
+ *  element, as "name[0]", "name[1]", ... Callers keep the
+ *  handles and compare GetProgramID() with the program in
+ *  use to know when they must be fetched again.
+ ***********************************************************/
+class UniformCache
+{
+public:
+    // Constructor
+    UniformCache();
+
+    // Read the active uniforms of a linked program
+    void Load(GLuint programID);
+    // Program the locations were read from, 0 before Load()
+    GLuint GetProgramID() const { return m_programID; }
+
+    // Location of a uniform by name - -1 if the program does not have it
+    GLint GetLocation(const std::string& name) const;
+
+    // Typed handle for a uniform by name
+    template <typename T>
+    Uniform<T> Get(const std::string& name) const
+    {
+        return Uniform<T>(GetLocation(name));
+    }
+
+private:
+    GLuint m_programID;
+    std::unordered_map<std::string, GLint> m_locations;
+};
+
+/***********************************************************
+ *  ShadowedUniform
+ *
+ *  A uniform handle that remembers the last value it sent.
+ *  Setting the value the program already holds is skipped,
+ *  and Set() returns false so callers can count the elided
+ *  upload. Assigning a new handle forgets the value, since
+ *  a new program starts with its own defaults.
+ ***********************************************************/
+template <typename T>
+class ShadowedUniform
+{
+public:
+    ShadowedUniform() : m_value(), m_bKnown(false) {}
+
+    ShadowedUniform& operator=(const Uniform<T>& uniform)
+    {
+        m_uniform = uniform;
+        m_bKnown = false;
+        return *this;
+    }
+
+    // Send the value if it differs from the last one - false if skipped
+    bool Set(const T& value)
+    {
+        if (m_bKnown && m_value == value)
+        {
+            return false;
+        }
+        m_uniform.Set(value);
+        m_value = value;
+        m_bKnown = true;
+        return true;
+    }
+    // Forget the last value, when something else may have set the uniform
+    void Invalidate() { m_bKnown = false; }
+    bool IsValid() const { return m_uniform.IsValid(); }
+
+private:
+    Uniform<T> m_uniform;
+    T m_value;
+    bool m_bKnown;
+};
@@ -24,6 +24,9 @@ namespace
 	const int WINDOW_HEIGHT = 800;
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
+	const char* g_ViewPositionName = "viewPosition";
+	const char* g_SpotLightPositionName = "spotLight.position";
+	const char* g_SpotLightDirectionName = "spotLight.direction";
 
 	// Camera object used for viewing and interacting with the 3D scene
 	Camera* g_pCamera = nullptr;
@@ -49,6 +52,10 @@ ViewManager::ViewManager(ShaderManager* pShaderManager)
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
 
+	// the shaders are not loaded yet, so the handles are resolved on the first frame
+	m_pUniformCache = new UniformCache();
+	m_viewProjection = glm::mat4(1.0f);
+
 	g_pCamera = new Camera();
 
 	// Default camera parameters
@@ -72,6 +79,44 @@ ViewManager::~ViewManager()
 		delete g_pCamera;
 		g_pCamera = NULL;
 	}
+
+	if (m_pUniformCache != NULL)
+	{
+		delete m_pUniformCache;
+		m_pUniformCache = NULL;
+	}
+}
+
+/***********************************************************
+ *  ResolveUniforms()
+ *
+ *  Reads the uniform locations of the shader program in use
+ *  when it differs from the one the handles were made for,
+ *  so the per-frame updates never look a uniform up by name.
+ ***********************************************************/
+void ViewManager::ResolveUniforms()
+{
+	if (m_pUniformCache->GetProgramID() == m_pShaderManager->m_programID)
+		return;
+
+	m_pUniformCache->Load(m_pShaderManager->m_programID);
+	m_viewUniform = m_pUniformCache->Get<glm::mat4>(g_ViewName);
+	m_projectionUniform = m_pUniformCache->Get<glm::mat4>(g_ProjectionName);
+	m_viewPositionUniform = m_pUniformCache->Get<glm::vec3>(g_ViewPositionName);
+	m_spotLightPositionUniform = m_pUniformCache->Get<glm::vec3>(g_SpotLightPositionName);
+	m_spotLightDirectionUniform = m_pUniformCache->Get<glm::vec3>(g_SpotLightDirectionName);
+}
+
+/***********************************************************
+ *  GetCameraPosition()
+ ***********************************************************/
+glm::vec3 ViewManager::GetCameraPosition() const
+{
+	if (g_pCamera == NULL)
+	{
+		return glm::vec3(0.0f, 0.0f, 0.0f);
+	}
+	return g_pCamera->Position;
 }
 
 /***********************************************************
@@ -229,6 +274,8 @@ void ViewManager::PrepareSceneView()
 		return;
 	}
 
+	ResolveUniforms();
+
 	// Frame timing
 	float currentFrame = glfwGetTime();
 	gDeltaTime = currentFrame - gLastFrame;
@@ -273,12 +320,13 @@ void ViewManager::PrepareSceneView()
 	}
 
 	// Load view/projection matrices to shader
-	m_pShaderManager->setMat4Value(g_ViewName, view);
-	m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+	m_viewUniform.Set(view);
+	m_projectionUniform.Set(projection);
+	m_viewProjection = projection * view;
 
 	// Update lighting with camera position & direction
-	m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
-	m_pShaderManager->setVec3Value("spotLight.position", g_pCamera->Position);
-	m_pShaderManager->setVec3Value("spotLight.direction", g_pCamera->Front);
+	m_viewPositionUniform.Set(g_pCamera->Position);
+	m_spotLightPositionUniform.Set(g_pCamera->Position);
+	m_spotLightDirectionUniform.Set(g_pCamera->Front);
 }
 
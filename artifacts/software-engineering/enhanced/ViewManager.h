@@ -16,6 +16,7 @@
 
 #include "ShaderManager.h"
 #include "camera.h"
+#include "UniformCache.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
@@ -41,6 +42,20 @@ private:
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
 
+	// uniform locations of the shader program, read on the first frame
+	UniformCache* m_pUniformCache;
+	Uniform<glm::mat4> m_viewUniform;
+	Uniform<glm::mat4> m_projectionUniform;
+	Uniform<glm::vec3> m_viewPositionUniform;
+	Uniform<glm::vec3> m_spotLightPositionUniform;
+	Uniform<glm::vec3> m_spotLightDirectionUniform;
+
+	// projection times view of the last prepared frame
+	glm::mat4 m_viewProjection;
+
+	// resolve the uniform handles when the shader program has changed
+	void ResolveUniforms();
+
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
 
@@ -50,4 +65,9 @@ public:
 
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// current camera position in world space
+	glm::vec3 GetCameraPosition() const;
+	// view-projection matrix set by the last PrepareSceneView()
+	const glm::mat4& GetViewProjection() const { return m_viewProjection; }
 };
\ No newline at end of file